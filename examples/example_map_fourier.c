@@ -0,0 +1,80 @@
+/*! [compile] */
+/* export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:../ */
+/* gcc --std=gnu99 -I../include -o example_map_fourier example_map_fourier.c -L.. -lhmpdf -lm */
+/*! [compile] */
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+#include "hmpdf.h"
+
+/* Computes the map power spectrum once with all halos painted individually
+ * and once with all of them painted in Fourier space (hmpdf_map_fourier_min_N),
+ * and checks that they agree, including at high ell where the pixel window matters. */
+
+#define NBINS 6
+#define TOL 5e-2
+
+int map_ps(int fourier_min_N, double ps[NBINS])
+{
+    /* logarithmic bins up to close to the Nyquist frequency of 1 arcmin pixels */
+    double binedges[NBINS+1];
+    for (int ii=0; ii<=NBINS; ii++)
+        binedges[ii] = 500.0 * pow(20.0, (double)(ii)/(double)(NBINS));
+
+    hmpdf_obj *d = hmpdf_new();
+    if (!(d))
+        return -1;
+
+    if (hmpdf_init(d, "example.ini", hmpdf_tsz,
+                   hmpdf_map_fsky, 0.01,
+                   hmpdf_pixel_side, 1.0,
+                   hmpdf_N_M, 20, hmpdf_N_z, 20,
+                   /* many halos per bin, so the realizations are comparable */
+                   hmpdf_M_min, 1.0e12, hmpdf_M_max, 1.0e14,
+                   hmpdf_map_poisson, 0,
+                   hmpdf_map_fourier_min_N, fourier_min_N))
+        return -1;
+
+    if (hmpdf_get_map_ps(d, NBINS, binedges, ps, 1))
+        return -1;
+
+    if (hmpdf_delete(d))
+        return -1;
+    return 0;
+}
+
+int example_map_fourier(void)
+{
+    double ps_direct[NBINS], ps_fourier[NBINS];
+
+    if (map_ps(0, ps_direct))
+        return -1;
+    /* every bin with at least one halo */
+    if (map_ps(1, ps_fourier))
+        return -1;
+
+    int ok = 1;
+    for (int ii=0; ii<NBINS; ii++)
+    {
+        double err = fabs(ps_fourier[ii]/ps_direct[ii] - 1.0);
+        printf("bin %d : direct = %.8e, fourier = %.8e, relative difference = %.2e\n",
+               ii, ps_direct[ii], ps_fourier[ii], err);
+        if (err > TOL)
+            ok = 0;
+    }
+
+    return (ok) ? 0 : -1;
+}
+
+int main(void)
+{
+    if (example_map_fourier())
+    {
+        fprintf(stderr, "failed\n");
+        return -1;
+    }
+    else
+    {
+        return 0;
+    }
+}
@@ -0,0 +1,81 @@
+/*! [compile] */
+/* export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:../ */
+/* gcc --std=gnu99 -I../include -o example_map_pixelavg example_map_pixelavg.c -L.. -lhmpdf -lm */
+/*! [compile] */
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+#include "hmpdf.h"
+
+/* Paints the same halos once with the supersampled pixel average
+ * and once with the pixel-averaged profiles (hmpdf_map_pixelavg),
+ * and checks that the total flux agrees.
+ * The pixels are large enough that most halos are smaller than a pixel. */
+
+#define CATALOG "example_map_pixelavg.cat"
+#define TOL 2e-2
+
+int map_mean(int pixelavg, double *mean)
+{
+    hmpdf_obj *d = hmpdf_new();
+    if (!(d))
+        return -1;
+
+    if (hmpdf_init(d, "example.ini", hmpdf_tsz,
+                   hmpdf_map_fsky, 0.01,
+                   hmpdf_pixel_side, 2.0,
+                   hmpdf_N_M, 20, hmpdf_N_z, 20,
+                   hmpdf_M_min, 1.0e12,
+                   hmpdf_map_seed, 1,
+                   hmpdf_map_pixelgrid, 10,
+                   hmpdf_map_pixelavg, pixelavg,
+                   /* the first map records the halos, the second one paints them */
+                   (pixelavg) ? hmpdf_map_catalog_in : hmpdf_map_catalog_out, CATALOG))
+        return -1;
+
+    double *map;
+    long Nside;
+    if (hmpdf_get_map(d, &map, &Nside, 1))
+        return -1;
+
+    *mean = 0.0;
+    for (long ii=0; ii<Nside*Nside; ii++)
+        *mean += map[ii];
+    *mean /= (double)(Nside*Nside);
+
+    free(map);
+
+    if (hmpdf_delete(d))
+        return -1;
+    return 0;
+}
+
+int example_map_pixelavg(void)
+{
+    double mean_supersampled, mean_pixelavg;
+
+    if (map_mean(0, &mean_supersampled))
+        return -1;
+    if (map_mean(1, &mean_pixelavg))
+        return -1;
+
+    double err = fabs(mean_pixelavg/mean_supersampled - 1.0);
+    printf("mean (supersampled) = %.8e\n", mean_supersampled);
+    printf("mean (pixelavg)     = %.8e\n", mean_pixelavg);
+    printf("relative difference = %.2e\n", err);
+
+    return (err < TOL) ? 0 : -1;
+}
+
+int main(void)
+{
+    if (example_map_pixelavg())
+    {
+        fprintf(stderr, "failed\n");
+        return -1;
+    }
+    else
+    {
+        return 0;
+    }
+}
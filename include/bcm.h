@@ -25,6 +25,7 @@ typedef struct//{{{
            bg_Gamma;
 #endif
     gsl_integration_workspace *bg_integr_ws;
+    double *bg_M; // [Nradii], enclosed bound gas mass at radii*R200c
 
     // central galaxy properties
     double cg_y0,
@@ -63,6 +64,7 @@ typedef struct//{{{
     int R200c_idx; // the index closest to R200c in the array
     double rmin, rmax; // in units of R200c
     double *radii; // where xi(r) will be evaluated
+    gsl_integration_glfixed_table *bg_gl; // for the tabulation of the bound gas mass
 
     // for printing profiles to file
     int profiles_N;
@@ -94,6 +96,10 @@ int bcm_delete_ws(bcm_ws *ws);
 
 int bcm_density_profile(hmpdf_obj *d, bcm_ws *ws, double r, double *out);
 
+// same for an array of radii, with the halo-dependent setup shared
+//     (sorted radii are cheapest; out may alias r)
+int bcm_density_profile_batch(hmpdf_obj *d, bcm_ws *ws, long N, double *r, double *out);
+
 int bcm_profiles_to_file(hmpdf_obj *d, int z_index, int M_index, bcm_ws *ws, char *fname);
 
 
@@ -0,0 +1,11 @@
+#ifndef CLASS_CACHE_H
+#define CLASS_CACHE_H
+
+#include "hmpdf.h"
+
+int class_cache_load(hmpdf_obj *d, int *found);
+int class_cache_background(hmpdf_obj *d);
+int class_cache_power(hmpdf_obj *d);
+int class_cache_save(hmpdf_obj *d);
+
+#endif
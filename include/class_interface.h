@@ -10,6 +10,31 @@ typedef struct//{{{
     char *class_ini;
     char *class_pre;
 
+    // if the user passes background and power spectrum tables,
+    //     CLASS is not run and the pointers below remain NULL
+    int use_tables;
+    int bg_N;
+    double *bg_z;
+    double *bg_H;   // 1/Mpc
+    double *bg_chi; // comoving distance, Mpc
+    double *bg_D;   // linear growth factor, D(z=0)=1
+    char *bg_file;
+    int Pk_N;
+    double *Pk_k; // 1/Mpc
+    double *Pk_P; // linear, z=0, Mpc^3
+    char *Pk_file;
+    double h;
+    double Om_0;
+    double Ob_0;
+    double *EH98_params; // if passed, the tables are computed internally
+
+    char *cache_dir;
+    int from_cache; // CLASS results were loaded, CLASS was not run
+    double *cache_buf;
+
+    double *bg_buf; // owned memory if tables were read from file or computed
+    double *Pk_buf;
+
     void /*struct precision*/ *pr;
     void /*struct background*/ *ba;
     void /*struct thermodynamics*/ *th;
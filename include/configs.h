@@ -13,8 +13,34 @@
 #define PKINTERP_KMIN 1e-10
 #define PKINTERP_KMAX 1e2
 #define PKINTERP_TYPE interp_cspline
+#define PKTAB_N 4096 // number of log-spaced samples of the linear power spectrum
+#define PKTAB_EDGE_EPS 1e-8 // distance of the last sample from the CLASS k_max in log(k)
+
+// user-supplied cosmology tables (instead of CLASS)
+#define TABLE_LINELEN 1024 // maximum line length in table files
+#define BGTAB_INTERP_TYPE interp_cspline
+
+// multiple source redshift bins (hmpdf_source_N)
+#define SOURCE_ZERO_SCALE 0x1p-60 // relative normalization of profiles behind the source
+                                  //     (they cannot be zeroed, since we need to scale back)
+
+// Eisenstein & Hu backend (hmpdf_EH98_params)
+#define EH98_NZ 256 // background samples, uniform in log(1+z)
+#define EH98_NK 1024 // power spectrum samples, uniform in log(k)
+#define EH98_KMIN 1e-5 // 1/Mpc
+#define EH98_KMAX 1e2 // 1/Mpc
+#define EH98_GLN 8 // Gauss-Legendre points per background interval
+#define EH98_ORH2 4.15e-5 // Omega_r h^2 at T_cmb=2.7255K (photons and 3.046 massless neutrinos)
 
 #define PKINTEGR_KMIN 1e-4
+
+// FFTLog computation of sigma^2(M) (hmpdf_ssq_fftlog)
+#define SSQFFTLOG_DLNK 0.02 // maximum spacing of the log(k) grid
+#define SSQFFTLOG_PAD 3.0 // padding of the log(k) range on both sides
+#define SSQFFTLOG_Q 1.5 // power law bias, needs to be in (0, 4)
+#define SSQFFTLOG_NCHECK 3 // number of masses compared against direct integration
+#define SSQFFTLOG_TOL 1e-3 // maximum relative error
+#define SSQINTERP_TYPE interp_cspline
 #define PKINTEGR_LIMIT 10000
 #define PKINTEGR_KEY 6
 #define PKINTEGR_EPSABS 0.0
@@ -32,8 +58,12 @@
 #define PRINTERP_TYPE    interp_steffen
 #define INVPRINTERP_TYPE interp_steffen // ensure monotonicity is preserved
 
-#define CORRINTERP_N 1000
-#define CORRINTERP_TYPE interp_cspline
+// FFTLog for the matter correlation function
+#define CORRFFTLOG_DLNK 0.01 // maximum spacing of the log(k) grid
+#define CORRFFTLOG_PAD 3.0 // padding of the log(k) range on both sides
+#define CORRFFTLOG_Q 1.0 // power law bias, needs to be in (0, 3/2)
+#define CORRFFTLOG_TAPER 0.5 // width in log(k) of the cosine taper below k_max
+#define CORRINTERP_TYPE interp_cspline // in log(r)
 
 #define PRWINDOW_INTERP_ELLMIN 1e-2
 #define PRWINDOW_INTERP_ELLMAX 1e3
@@ -61,6 +91,51 @@
 #define BATTINTEGR_EPSABS 1e-1 // in units of the signal grid spacing
 #define BATTINTEGR_EPSREL 1e-4
 
+// fixed-order line-of-sight quadrature (hmpdf_los_fixed_order)
+#define LOSQUAD_N 32 // order of the Gauss-Legendre rule, error estimate from LOSQUAD_N/2
+
+// FFTLog Hankel transforms (hmpdf_fftlog)
+#define FFTLOG_PAD 4.0 // padding of the theta range on both sides
+#define FFTLOG_OVERSAMPLING 2.0 // minimum number of points per theta_out * dlnx
+#define FFTLOG_Q 1.0 // power law bias
+
+#define PRSLAB_ALIGN 64 // alignment of the profile slabs [bytes]
+
+// on-disk profile cache (hmpdf_profile_cache)
+#define PROFCACHE_VERSION 1 // increment if the profile computation changes
+#define PROFCACHE_NPK 32 // number of linear power spectrum samples hashed (for BCM)
+#define PROFCACHE_KMIN 1e-3 // range of these samples [1/Mpc]
+#define PROFCACHE_KMAX 1e2
+
+#define CLASSCACHE_VERSION 1 // increment if the extracted CLASS quantities change
+#define CLASSCACHE_BUFLEN 4096 // chunk size when hashing the .ini files
+
+// Abel projection of the tabulated BCM density (hmpdf_bcm_abel)
+#define BCMABEL_NR 256 // number of logarithmic radii
+#define BCMABEL_NMIN 8 // minimum number on either side of R200c
+#define BCMABEL_INTERP_TYPE interp_steffen // monotonic, since the density is steep
+#define BCMABEL_SPLIT_EPS 1e-8 // relative offset from R200c, where the density jumps
+#define BCMABEL_NCHECK 3 // number of halos compared against direct integration
+#define BCMABEL_TOL 1e-3 // maximum error, relative to the maximum of the profile
+
+// mass-interpolated profiles (hmpdf_profile_Mstride)
+#define PRMINTERP_ORDER 4 // number of coarse masses used for the Lagrange interpolation
+#define PRMINTERP_NCHECK 4 // number of held-out masses compared against exact profiles
+#define PRMINTERP_TOL 1e-3 // maximum error, relative to the maximum of the profile
+
+// adaptive angular sampling of the profiles (hmpdf_theta_adaptive)
+#define PRADAPT_STRIDE 16 // initial sampling of every n-th angle
+#define PRADAPT_EPSABS 1e-1 // in units of the signal grid spacing
+#define PRADAPT_EPSREL 1e-4
+
+// tabulated tSZ profiles (hmpdf_tsz_table)
+#define GNFWTAB_NR 65 // initial number of log(rproj) nodes
+#define GNFWTAB_NL 65 // initial number of log(l) nodes
+#define GNFWTAB_DBETA 0.1 // initial spacing of beta nodes
+#define GNFWTAB_TOL 1e-3 // required maximum relative error of the interpolation
+#define GNFWTAB_MAXREFINE 2 // maximum number of grid refinements
+#define GNFWTAB_CHECK_STRIDE 4 // accuracy is checked in every n-th cell
+
 #define TP_PHI_EQ_TOL 1e-10
 
 #define PU_R2C_MODE FFTW_MEASURE
@@ -79,6 +154,8 @@
 #define MAPNOZ_STATUS_PERIOD 400
 #define MAPWZ_STATUS_PERIOD  8
 
+#define MAPCAT_CHUNK 4096 // initial length of the per-thread halo catalogs
+
 #define NOISE_ELLMIN 1e-2
 #define NOISE_ELLMAX 1e12
 #define NOISE_LIMIT  1000
@@ -93,11 +170,16 @@
 #define BCM_BGINTEGR_KEY 6
 #define BCM_BGINTEGR_EPSABS 1e-3 // in units of remaining baryonic mass
 #define BCM_BGINTEGR_EPSREL 1e-4
+#define BCM_BGTAB_GLN 4 // order of the Gauss-Legendre rule between adjacent radii
+                        //    when tabulating the bound gas mass
 
 #define DNDZ_INTEGR_LIMIT 1000
 #define DNDZ_INTEGR_KEY 6
-#define DNDZ_INTEGR_EPSABS 0.0 // in units of the normalization
 #define DNDZ_INTEGR_EPSREL 1e-6
+#define DNDZ_CUMUL_DZ 0.01 // maximum width of the lensing efficiency sub-intervals
+#define DNDZ_CUMUL_GLN 8 // Gauss-Legendre points per sub-interval
+#define DNDZ_CHI_DZ 0.005 // spacing of the chi(z) table the sub-intervals are evaluated with
+#define DNDZ_CHI_INTERP_TYPE interp_cspline
 //}}}
 
 struct DEFAULTS {int Ncores[3]; int verbosity; int warn_is_err;
@@ -125,7 +207,18 @@ struct DEFAULTS {int Ncores[3]; int verbosity; int warn_is_err;
                  hmpdf_integr_mode_e Mintegr_type[3]; double Mintegr_alpha; double Mintegr_beta;
                  double *Duffy08_p; double *Tinker10_p; double *Battaglia12_p;
                  hmpdf_noise_pwr_f noise_pwr; void *noise_pwr_params;
-                 double fsky[3]; int pxlgrid[3]; int mappoisson; int mapseed; int mass_z_fix_prof; double min_mass_fix_prof; double max_z_fix_prof};
+                 double fsky[3]; int pxlgrid[3]; int mappoisson; int mapseed;
+                 int map_pixelavg; int map_subpixel_K[3]; int map_fourier_min_N; char *map_catalog_out; char *map_catalog_in;
+                 int tsz_table; int los_fixed_order; int fftlog;
+                 char *profile_cache; int profile_Mstride; int theta_adaptive;
+                 int bcm_abel; int ssq_fftlog;
+                 int bg_table_N; double *bg_table_z; double *bg_table_H; double *bg_table_chi; double *bg_table_D;
+                 char *bg_table_file;
+                 int Pk_table_N; double *Pk_table_k; double *Pk_table_P; char *Pk_table_file;
+                 double cosmo_h; double cosmo_Omega_m; double cosmo_Omega_b;
+                 double *EH98_params; char *class_cache;
+                 int source_N; double *source_z; void **source_dndz_params;
+                 int mass_z_fix_prof; double min_mass_fix_prof; double max_z_fix_prof};
 
 extern
 struct DEFAULTS def;
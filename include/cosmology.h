@@ -10,7 +10,8 @@ typedef struct//{{{
     double *hubble;
     double *comoving;
     double *angular_diameter;
-    double *invScrit;
+    double *invScrit; // what the profiles are currently normalized with
+    double *invScrit_bins; // [source_N*Nz], for the multiple source bins
     double *Dsq;
     // simple quantities
     double h;
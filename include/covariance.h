@@ -26,6 +26,7 @@ covariance_t;
 int null_covariance(hmpdf_obj *d);
 int reset_covariance(hmpdf_obj *d);
 int hmpdf_get_cov(hmpdf_obj *d, int Nbins, double binedges[Nbins+1], double cov[Nbins*Nbins], int noisy);
+int hmpdf_get_cov_cross(hmpdf_obj *d, int bin2, int Nbins, double binedges[Nbins+1], double cov[Nbins*Nbins]);
 int hmpdf_get_cov_diagnostics(hmpdf_obj *d, int *Nphi, double **phi,
                               double **phiweights, double **corr_diagn);
 
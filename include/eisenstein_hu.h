@@ -0,0 +1,8 @@
+#ifndef EISENSTEIN_HU_H
+#define EISENSTEIN_HU_H
+
+#include "hmpdf.h"
+
+int EH98_tables(hmpdf_obj *d);
+
+#endif
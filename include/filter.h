@@ -51,6 +51,8 @@ int reset_filters(hmpdf_obj *d);
 int apply_filters(hmpdf_obj *d, int N, double *ell,
                   double *in, double *out, int stride,
                   filter_mode mode, int *z_index);
+int apply_pixelfilter(hmpdf_obj *d, int N, double *ell,
+                      double *in, double *out);
 int apply_filters_map(hmpdf_obj *d, long N, double *ell,
                       double complex *in, double complex *out,
                       int *z_index);
@@ -71,7 +71,8 @@
  *      3. get your output [hmpdf_get_op(), hmpdf_get_tp(), hmpdf_get_cov(),
  *                          hmpdf_get_Cell(), hmpdf_get_Cphi(),
  *                          hmpdf_get_map(), hmpdf_get_map_op()].
- *      4. go to (3.) if you require any other outputs;
+ *      4. go to (3.) if you require any other outputs
+ *         [after hmpdf_set_source_bin() if you passed several source redshifts];
  *         go to (2.) if you want to re-run the code with different options.
  *      5. free the memory associated with the #hmpdf_obj with hmpdf_delete().
  *
@@ -67,6 +67,18 @@ typedef enum
     hmpdf_Arico20_Nparams, /*!<. Internal use only. */
 } hmpdf_Arico20_params_e;
 
+/*! Ordering of the cosmological parameters for the Eisenstein & Hu (1998) backend */
+typedef enum
+{
+    hmpdf_EH98_h, /*!< dimensionless Hubble constant.*/
+    hmpdf_EH98_Omega_m, /*!< total matter density parameter today.*/
+    hmpdf_EH98_Omega_b, /*!< baryon density parameter today.*/
+    hmpdf_EH98_n_s, /*!< spectral index.*/
+    hmpdf_EH98_sigma8, /*!< normalization of the linear power spectrum at z=0.*/
+    hmpdf_EH98_T_cmb, /*!< CMB temperature in K.*/
+    hmpdf_EH98_Nparams, /*!<. Internal use only. */
+} hmpdf_EH98_params_e;
+
 /*! Options to hmpdf_init().
  *
  *  The variadic argument list in hmpdf_init() can be used to pass non-default options.
@@ -85,21 +97,40 @@ typedef enum
  *  Less frequently used options:
  *      + verbosity: #hmpdf_verbosity
  *      + behaviour when unusual states are encountered: #hmpdf_warn_is_err
+ *      + cosmology from tables instead of CLASS: #hmpdf_bg_table_N, #hmpdf_bg_table_z,
+ *                                                #hmpdf_bg_table_H, #hmpdf_bg_table_chi,
+ *                                                #hmpdf_bg_table_D, #hmpdf_bg_table_file,
+ *                                                #hmpdf_Pk_table_N, #hmpdf_Pk_table_k,
+ *                                                #hmpdf_Pk_table_P, #hmpdf_Pk_table_file,
+ *                                                #hmpdf_cosmo_h, #hmpdf_cosmo_Omega_m,
+ *                                                #hmpdf_cosmo_Omega_b
+ *      + fast approximate cosmology instead of CLASS: #hmpdf_EH98_params
+ *      + re-use CLASS results from previous runs: #hmpdf_class_cache
+ *      + several source redshift bins sharing one profile set: #hmpdf_source_N,
+ *                                                              #hmpdf_source_z,
+ *                                                              #hmpdf_source_dndz_params
  *      + halo model fit parameters: #hmpdf_Duffy08_conc_params,
  *                                   #hmpdf_Tinker10_hmf_params,
  *                                   #hmpdf_Battaglia12_tsz_params
  *      + k space filter: #hmpdf_custom_k_filter (and #hmpdf_custom_k_filter_params)
  *      + PDF internal sampling points: #hmpdf_N_signal, #hmpdf_signal_min, #hmpdf_signal_max
  *      + settings for simplified simulations: #hmpdf_map_fsky,
- *                                             #hmpdf_map_pixelgrid,
- *                                             #hmpdf_map_poisson
+ *                                             #hmpdf_map_pixelgrid, #hmpdf_map_pixelavg,
+ *                                             #hmpdf_map_poisson, #hmpdf_map_subpixel_K,
+ *                                             #hmpdf_map_fourier_min_N,
+ *                                             #hmpdf_map_catalog_out, #hmpdf_map_catalog_in
  *  
  *  Integration grids:
  *      + redshift integration: #hmpdf_N_z, #hmpdf_z_min, #hmpdf_z_max,
  *                              #hmpdf_zintegr_type, #hmpdf_zintegr_alpha, #hmpdf_zintegr_beta
  *      + halo mass integration: #hmpdf_N_M, #hmpdf_M_min, #hmpdf_M_max,
- *                               #hmpdf_Mintegr_type, #hmpdf_Mintegr_alpha, #hmpdf_Mintegr_beta
- *      + halo profile angular integration: #hmpdf_N_theta, #hmpdf_rout_scale, #hmpdf_rout_rdef
+ *                               #hmpdf_Mintegr_type, #hmpdf_Mintegr_alpha, #hmpdf_Mintegr_beta,
+ *                               #hmpdf_ssq_fftlog
+ *      + halo profile angular integration: #hmpdf_N_theta, #hmpdf_rout_scale, #hmpdf_rout_rdef,
+ *                                          #hmpdf_tsz_table, #hmpdf_los_fixed_order,
+ *                                          #hmpdf_fftlog, #hmpdf_profile_cache,
+ *                                          #hmpdf_profile_Mstride, #hmpdf_theta_adaptive,
+ *                                          #hmpdf_bcm_abel
  *
  *  Covariance matrix calculation:
  *      + useful to improve numerical stability: #hmpdf_N_phi
@@ -497,6 +528,268 @@ typedef enum
                      *   \par
                      *   Type: int. Default: None.
                      */
+    hmpdf_map_pixelavg, /*!< If set to non-zero, the signal profiles are averaged over the pixel area
+                         *   in Hankel space (with the azimuthally averaged pixel window,
+                         *   as in the one-point PDF computation),
+                         *   so the maps require only one profile evaluation per pixel.
+                         *   #hmpdf_map_pixelgrid is then ignored.
+                         *   \par
+                         *   Type: int. Default: 0.
+                         */
+    hmpdf_map_subpixel_K, /*!< If positive, each halo in the simplified simulations is placed at one of
+                           *   K x K sub-pixel offsets, drawn independently for each halo.
+                           *   The corresponding stamps are computed (at most once per (z, M) bin)
+                           *   when they are first needed.
+                           *   If zero, all halos in a (z, M) bin share a single random sub-pixel offset.
+                           *   \par
+                           *   Type: int. Default: 0.
+                           *   \remark requires memory for K^2 stamps of the largest halo per thread.
+                           *   \remark does not apply to bins painted in Fourier space
+                           *           (see #hmpdf_map_fourier_min_N).
+                           */
+    hmpdf_map_fourier_min_N, /*!< In the simplified simulations, (z, M) bins in which at least this many
+                              *   halos are drawn are not painted individually.
+                              *   Instead, their centers are deposited on a grid which is convolved with the
+                              *   conjugate space profile and the pixel window
+                              *   (the same one the individually painted halos have,
+                              *   see #hmpdf_map_pixelgrid and #hmpdf_map_pixelavg).
+                              *   This is much faster for the numerous small halos, set to zero to disable.
+                              *   \par
+                              *   Type: int. Default: 0.
+                              *   \remark the halos in such a bin all sit at the same sub-pixel offset,
+                              *           as is the case for the individually painted ones.
+                              *   \remark this requires two additional Nside x Nside maps per thread.
+                              */
+    hmpdf_map_catalog_out, /*!< If this option is set, the halos drawn in the simplified simulations
+                            *   (position, redshift and mass bin, sub-pixel offset)
+                            *   are written to this file whenever a new map is generated.
+                            *   The format is described in #hmpdf_catalog_halo_t.
+                            *   \par
+                            *   Type: char *. Default: None.
+                            */
+    hmpdf_map_catalog_in, /*!< If this option is set, the simplified simulations are not sampled
+                           *   but the halos in this catalog are painted instead.
+                           *   This can be a catalog written previously (#hmpdf_map_catalog_out),
+                           *   for example to repaint the same halos with different profiles or filters,
+                           *   or an external one (e.g. from an N-body light cone).
+                           *   The format is described in #hmpdf_catalog_halo_t.
+                           *   \par
+                           *   Type: char *. Default: None.
+                           *   \remark #hmpdf_map_poisson and #hmpdf_map_seed have no effect
+                           *           (except for a Gaussian noise realization).
+                           */
+    hmpdf_tsz_table, /*!< If set to non-zero, the line-of-sight integrals of the tSZ profiles
+                      *   are not computed for each halo but interpolated from tables.
+                      *   The dimensionless projected GNFW profile is tabulated once
+                      *   for each unique (alpha, gamma), on a grid in beta, projected radius
+                      *   and line-of-sight extent.
+                      *   The grid is refined until the relative interpolation error
+                      *   (checked against direct integration) is below 1e-3.
+                      *   \par
+                      *   Type: int. Default: 0.
+                      *   \remark speeds up hmpdf_init() considerably for tSZ,
+                      *           in particular for large #hmpdf_N_theta.
+                      */
+    hmpdf_los_fixed_order, /*!< If set to non-zero, the line-of-sight integrals of the tSZ and
+                            *   baryonified convergence profiles are computed with a fixed-order
+                            *   Gauss-Legendre rule for all angles of a profile at once
+                            *   (after a substitution that removes the central cusp).
+                            *   Only where the error estimate is too large,
+                            *   adaptive integration is used.
+                            *   \par
+                            *   Type: int. Default: 0.
+                            *   \remark has no effect on tSZ profiles if #hmpdf_tsz_table is set.
+                            */
+    hmpdf_fftlog, /*!< If set to non-zero, the Hankel transforms of the profiles
+                   *   (to conjugate space and back after filtering)
+                   *   are computed with FFTLog instead of the discrete Hankel transform.
+                   *   This scales as N log N instead of N^2 with #hmpdf_N_theta.
+                   *   The results are interpolated to the usual sampling points.
+                   *   \par
+                   *   Type: int. Default: 0.
+                   *   \remark useful for large #hmpdf_N_theta.
+                   */
+    hmpdf_profile_cache, /*!< Directory in which the profiles (and their conjugate space
+                          *   and filtered versions) are cached.
+                          *   The cache files are named by a hash of everything
+                          *   the profiles depend on (background cosmology, grids,
+                          *   profile and filter options), so a later run with identical
+                          *   settings loads them instead of recomputing.
+                          *   Multiple processes can safely share the directory.
+                          *   \par
+                          *   Type: char *. Default: None.
+                          *   \remark not used if any of #hmpdf_mass_resc, #hmpdf_conc_resc
+                          *           or #hmpdf_tot_profiles_N is set,
+                          *           and the filtered profiles are not cached
+                          *           if custom filters are used.
+                          */
+    hmpdf_profile_Mstride, /*!< If set to n > 1, the profiles are computed exactly only
+                            *   for every n-th mass (and the largest one) at each redshift.
+                            *   The others are interpolated in log(M) between these,
+                            *   at fixed angle in units of the outer radius.
+                            *   A few held-out masses are compared against the exact profiles;
+                            *   if the interpolation error is too large, a warning is printed
+                            *   and all profiles are computed exactly.
+                            *   \par
+                            *   Type: int. Default: 0.
+                            *   \remark speeds up hmpdf_init() for the expensive tSZ and
+                            *           baryonified convergence profiles and large #hmpdf_N_M.
+                            */
+    hmpdf_theta_adaptive, /*!< If set to non-zero, the tSZ and baryonified convergence profiles
+                           *   are not evaluated at all #hmpdf_N_theta angles.
+                           *   Starting from a coarse subset, intervals are bisected until
+                           *   cubic interpolation predicts the profile at the midpoint
+                           *   to within a tolerance (a tenth of the signal grid spacing);
+                           *   the remaining angles are interpolated.
+                           *   #hmpdf_N_theta then acts as the maximum resolution,
+                           *   and smooth profiles are much cheaper.
+                           *   \par
+                           *   Type: int. Default: 0.
+                           */
+    hmpdf_bcm_abel, /*!< If set to non-zero, the baryonified density of each halo is
+                     *   tabulated on a logarithmic radial grid once,
+                     *   and the convergence profile is obtained by projecting the
+                     *   interpolated density (fixed-order quadrature, adaptive only where
+                     *   the error estimate requires it).
+                     *   At initialization, a few halos are compared against the direct
+                     *   line-of-sight integration; if the difference is too large,
+                     *   a warning is printed and the direct integration is used.
+                     *   \par
+                     *   Type: int. Default: 0.
+                     *   \remark only relevant if #hmpdf_Arico20_params is passed.
+                     */
+    hmpdf_ssq_fftlog, /*!< If set to non-zero, the variance sigma^2(M) and its derivative
+                       *   are computed for all masses at once with FFTLog
+                       *   (instead of two adaptive integrals per mass)
+                       *   and interpolated to the mass grid.
+                       *   A few masses are compared against direct integration;
+                       *   if the relative error exceeds 1e-3, a warning is printed
+                       *   and the direct integration is used.
+                       *   \par
+                       *   Type: int. Default: 0.
+                       *   \remark useful for large #hmpdf_N_M.
+                       */
+    hmpdf_bg_table_N, /*!< Number of redshifts in the user-supplied background table.
+                       *   If passed (or #hmpdf_bg_table_file), CLASS is not run at all
+                       *   and the class_ini argument to hmpdf_init() is ignored (can be NULL).
+                       *   The power spectrum table (#hmpdf_Pk_table_N or #hmpdf_Pk_table_file)
+                       *   and #hmpdf_cosmo_h, #hmpdf_cosmo_Omega_m, #hmpdf_cosmo_Omega_b
+                       *   must then be passed as well.
+                       *   Only flat universes are supported in this mode.
+                       *   \par
+                       *   Type: int. Default: 0.
+                       *   \remark the tables are interpolated with cubic splines;
+                       *           if they are sampled densely enough (a few hundred points),
+                       *           the results agree with the CLASS-backed computation
+                       *           to well below the other numerical uncertainties.
+                       */
+    hmpdf_bg_table_z, /*!< Redshifts of the background table, strictly increasing.
+                       *   Must cover the redshift integration range and the source redshift.
+                       *   \par
+                       *   Type: double *. Default: None.
+                       */
+    hmpdf_bg_table_H, /*!< Hubble rate H(z) in 1/Mpc (i.e. divided by the speed of light).
+                       *   \par
+                       *   Type: double *. Default: None.
+                       */
+    hmpdf_bg_table_chi, /*!< Comoving distance chi(z) in Mpc.
+                         *   \par
+                         *   Type: double *. Default: None.
+                         */
+    hmpdf_bg_table_D, /*!< Linear growth factor D(z), normalized to unity at z=0.
+                       *   \par
+                       *   Type: double *. Default: None.
+                       */
+    hmpdf_bg_table_file, /*!< Alternative to the above four arrays:
+                          *   a text file with four whitespace-separated columns
+                          *   z, H(z), chi(z), D(z) (units as above).
+                          *   Lines starting with # are ignored.
+                          *   \par
+                          *   Type: char *. Default: None.
+                          */
+    hmpdf_Pk_table_N, /*!< Number of wavenumbers in the user-supplied
+                       *   linear power spectrum table.
+                       *   \par
+                       *   Type: int. Default: 0.
+                       */
+    hmpdf_Pk_table_k, /*!< Wavenumbers in 1/Mpc, strictly increasing.
+                       *   Should extend beyond 1/Mpc.
+                       *   \par
+                       *   Type: double *. Default: None.
+                       */
+    hmpdf_Pk_table_P, /*!< Linear matter power spectrum at z=0 in Mpc^3.
+                       *   \par
+                       *   Type: double *. Default: None.
+                       */
+    hmpdf_Pk_table_file, /*!< Alternative to the above two arrays:
+                          *   a text file with two whitespace-separated columns k, P(k).
+                          *   Lines starting with # are ignored.
+                          *   \par
+                          *   Type: char *. Default: None.
+                          */
+    hmpdf_cosmo_h, /*!< Dimensionless Hubble constant, required with the tables.
+                    *   \par
+                    *   Type: double. Default: None.
+                    */
+    hmpdf_cosmo_Omega_m, /*!< Matter density parameter today, required with the tables.
+                          *   \par
+                          *   Type: double. Default: None.
+                          */
+    hmpdf_cosmo_Omega_b, /*!< Baryon density parameter today, required with the tables.
+                          *   \par
+                          *   Type: double. Default: None.
+                          */
+    hmpdf_EH98_params, /*!< If passed, CLASS is not run (class_ini can be NULL).
+                        *   Instead, the linear power spectrum is computed from the
+                        *   Eisenstein & Hu (1998) transfer function fit (with BAO),
+                        *   normalized to sigma8,
+                        *   and distances and growth factor from numerical integration
+                        *   of the Friedmann equation in a flat LCDM universe.
+                        *   The ordering is specified by #hmpdf_EH98_params_e.
+                        *   Cannot be combined with the tables (#hmpdf_bg_table_N).
+                        *   \par
+                        *   Type: double *. Default: None.
+                        *   \remark intended for quick-look runs, the power spectrum
+                        *           is only accurate to a few percent.
+                        */
+    hmpdf_class_cache, /*!< Directory in which the quantities extracted from CLASS
+                        *   (background on the redshift grid, linear power spectrum,
+                        *   sigma^2(M) and the autocorrelation) are stored.
+                        *   The files are keyed by the contents of the .ini and precision
+                        *   files and the redshift and mass grids.
+                        *   If a matching file exists, CLASS is not run.
+                        *   Useful if many hmpdf_init() calls share a cosmology
+                        *   (e.g. when varying halo model parameters).
+                        *   \par
+                        *   Type: char *. Default: None.
+                        *   \remark not used if #hmpdf_dndz or #hmpdf_source_N is passed
+                        *           (user-supplied functions cannot be hashed).
+                        */
+    hmpdf_source_N, /*!< number of source redshift bins for #hmpdf_kappa.
+                     *   If non-zero, the halo model and the profiles are computed once
+                     *   and the outputs are obtained for the source bin selected with
+                     *   hmpdf_set_source_bin() (by default the first one).
+                     *   Since the source redshift only enters through the overall
+                     *   normalization of the convergence profiles, switching bins
+                     *   is cheap.
+                     *   \par
+                     *   Type: int. Default: 0.
+                     *   \remark the source redshift passed to hmpdf_init() then only sets
+                     *           the default #hmpdf_z_max and must not be smaller than
+                     *           any of the #hmpdf_source_z.
+                     */
+    hmpdf_source_z, /*!< source redshifts of the #hmpdf_source_N bins.
+                     *   If #hmpdf_dndz is passed, these are the upper integration
+                     *   boundaries of the source distributions.
+                     *   \par
+                     *   Type: double *. Default: None.
+                     */
+    hmpdf_source_dndz_params, /*!< additional parameters to pass to #hmpdf_dndz,
+                               *   one for each of the #hmpdf_source_N bins.
+                               *   \par
+                               *   Type: void **. Default: None (#hmpdf_dndz_params
+                               *                                 is used for all bins).
+                               */
     hmpdf_end_configs, /*!< required last argument in hmpdf_init_fct(), the convenience macro
                         *   hmpdf_init() takes care of that.
                         */
@@ -29,6 +29,30 @@ int hmpdf_get_cov(hmpdf_obj *d,
                   double cov[Nbins*Nbins],
                   int noisy);
 
+/*! Returns the cross-covariance matrix between the one-point PDFs in two source redshift bins.
+ *
+ *  \param[in,out] d    hmpdf_init() must have been called on d, with #hmpdf_source_N
+ *  \param[in] bin2     index into #hmpdf_source_z for the columns
+ *  \param[in] Nbins    number of bins the covariance matrix will be binned into
+ *  \param[in] binedges monotonically increasing array of length Nbins+1
+ *  \param[out] cov     the binned covariance matrix will be written into the first Nbins*Nbins elements of
+ *                      this output array.
+ *                      The rows refer to the bin selected with hmpdf_set_source_bin(),
+ *                      the columns to bin2.
+ *  \return error code
+ *
+ *  \remark Noise is not supported for this output.
+ *  \remark If bin2 is the selected bin, this is the same as hmpdf_get_cov() without noise.
+ *  \remark Switching between this function and hmpdf_get_cov(), or changing bin2,
+ *          discards the pre-computed covariance matrix.
+ *  \remark The same normalization as in hmpdf_get_cov() applies.
+ */
+int hmpdf_get_cov_cross(hmpdf_obj *d,
+                        int bin2,
+                        int Nbins,
+                        double binedges[Nbins+1],
+                        double cov[Nbins*Nbins]);
+
 /*! Returns diagnostic outputs for the covariance matrix computation.
  *  The main use of this function is to identify numerical instability at small
  *  pixel separations.
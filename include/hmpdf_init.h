@@ -10,6 +10,8 @@
  *
  *  \param[in,out] d        created with hmpdf_new()
  *  \param[in] class_ini    path to a CLASS .ini file
+ *                          (may be NULL if the cosmology is passed as tables,
+ *                           see #hmpdf_bg_table_N)
  *  \param[in] stype        signal type (either #hmpdf_kappa or #hmpdf_tsz)
  *  \param[in] ...          variadic argument list for optional arguments
  *  \return error code
@@ -54,4 +56,19 @@ int hmpdf_init_fct(hmpdf_obj *d,
                    hmpdf_signaltype_e stype,
                    ...);
 
+/*! Selects the source redshift bin for all subsequent outputs.
+ *  Only available if #hmpdf_source_N was passed to hmpdf_init(),
+ *  after which the first bin is selected.
+ *
+ *  \param[in,out] d   initialized with hmpdf_init()
+ *  \param[in] bin     index into #hmpdf_source_z
+ *  \return error code
+ *
+ *  \remark outputs computed for the previously selected bin are discarded,
+ *          but the profiles are re-used.
+ *  \remark correlations with other bins are available through
+ *          hmpdf_get_tp_cross() and hmpdf_get_cov_cross().
+ */
+int hmpdf_set_source_bin(hmpdf_obj *d, int bin);
+
 #endif
@@ -4,6 +4,43 @@
 
 #include "hmpdf_object.h"
 
+/*! A single halo in a map catalog.
+ *
+ *  Catalogs are written (#hmpdf_map_catalog_out) and read (#hmpdf_map_catalog_in)
+ *  as binary files in native byte order:
+ *  one #hmpdf_catalog_header_t followed by Nhalos records of this type.
+ *
+ *  \remark the indices refer to the internal redshift and mass grids,
+ *          which are determined by #hmpdf_N_z, #hmpdf_z_min, #hmpdf_z_max, #hmpdf_zintegr_type
+ *          (and analogous for mass).
+ *          When painting an external catalog, halos should be assigned to the closest
+ *          grid points.
+ */
+typedef struct
+{
+    int z_index; /*!< index into the redshift grid */
+    int M_index; /*!< index into the mass grid */
+    int x;       /*!< pixel containing the halo center (row), 0 <= x < Nside */
+    int y;       /*!< pixel containing the halo center (column), 0 <= y < Nside */
+    float dx;    /*!< offset of the halo center from the pixel center,
+                  *   in units of the pixel sidelength, -0.5 <= dx <= 0.5 */
+    float dy;    /*!< see dx */
+} hmpdf_catalog_halo_t;
+
+/*! Header of a map catalog file.
+ *
+ *  When painting an external catalog, Nside, Nz, NM need to match the values
+ *  used internally, otherwise an error is raised.
+ */
+typedef struct
+{
+    char magic[8]; /*!< the characters HMPDFCAT (not null-terminated) */
+    long Nside;    /*!< sidelength of the map in pixels */
+    int Nz;        /*!< size of the redshift grid */
+    int NM;        /*!< size of the mass grid */
+    long Nhalos;   /*!< number of records following the header */
+} hmpdf_catalog_header_t;
+
 /*! Returns the histogram of a simplified simulation (map).
  *
  *  \param[in,out] d    hmpdf_init() must have been called on d
@@ -58,4 +95,23 @@ int hmpdf_get_map(hmpdf_obj *d,
                   long *Nside,
                   int new_map);
 
+/*! Same as hmpdf_get_map(), but returns the map in single precision.
+ *
+ *  \param[in,out] d    hmpdf_init() must have been called on d
+ *  \param[out] map     the map (flattened array of dimensions Nside x Nside)
+ *  \param[out] Nside   sidelength of the map
+ *  \param[in] new_map  if set to non-zero, the simplified simulation will
+ *                      be rerun even if a map has already been generated
+ *  \return error code
+ *
+ *  \remark if the code was compiled with -DMAPS_SINGLE, the map is generated
+ *          in single precision and this function avoids the conversion
+ *          as well as half of the memory footprint.
+ *          The user is responsible for freeing the allocated array.
+ */
+int hmpdf_get_mapf(hmpdf_obj *d,
+                   float **map,
+                   long *Nside,
+                   int new_map);
+
 #endif
@@ -29,5 +29,32 @@ int hmpdf_get_tp(hmpdf_obj *d,
                  double tp[Nbins*Nbins],
                  int noisy);
 
+/*! Returns the two-point PDF between two source redshift bins.
+ *
+ *  \param[in,out] d    hmpdf_init() must have been called on d, with #hmpdf_source_N
+ *  \param[in] phi      angular separation for which the two-point PDF will be computed (in arcmin).
+ *                      Must be less than #hmpdf_phi_max.
+ *                      Zero is allowed if bin2 differs from the selected bin,
+ *                      and gives the joint PDF in a single pixel.
+ *  \param[in] bin2     index into #hmpdf_source_z for the second pixel
+ *  \param[in] Nbins    number of bins the two-point PDF will be binned into
+ *  \param[in] binedges monotonically increasing array of length Nbins+1
+ *  \param[out] tp      the binned two-point PDF will be written into the first Nbins*Nbins elements of
+ *                      this output array.
+ *                      The first index refers to the bin selected with hmpdf_set_source_bin(),
+ *                      the second one to bin2.
+ *  \return error code
+ *
+ *  \remark Noise is not supported for this output.
+ *  \remark Switching between this function and hmpdf_get_tp(), or changing bin2,
+ *          discards the pre-computed two-point PDF.
+ */
+int hmpdf_get_tp_cross(hmpdf_obj *d,
+                       double phi,
+                       int bin2,
+                       int Nbins,
+                       double binedges[Nbins+1],
+                       double tp[Nbins*Nbins]);
+
 
 #endif
@@ -9,19 +9,48 @@
 
 #include "hmpdf.h"
 
+// if MAPS_SINGLE is defined, the maps are stored and Fourier transformed
+//     in single precision (requires linking with -lfftw3f)
+#ifdef MAPS_SINGLE
+typedef float mapfloat;
+typedef float complex mapcomplex;
+typedef fftwf_plan mapfftw_plan;
+#   define MAPFFTW(name) fftwf_##name
+#else
+typedef double mapfloat;
+typedef double complex mapcomplex;
+typedef fftw_plan mapfftw_plan;
+#   define MAPFFTW(name) fftw_##name
+#endif
+
 typedef struct//{{{
 {
     int for_fft;
     long ldmap;
-    double *map; // the complete map in this work space
-                 //    includes all objects handled by a specific thread
-    double complex *map_comp;
-    fftw_plan *p_r2c;
+    mapfloat *map; // the complete map in this work space
+                   //    includes all objects handled by a specific thread
+    mapcomplex *map_comp;
+    mapfftw_plan *p_r2c;
 
     long bufside; // sidelength of this specific buffer
-    double *pos;  // angular separation from object center
-                  //     (same shape as buf)
-    double *buf;  // buffer for a single object
+    double *pos;    // angular separation from object center,
+                    //     overwritten with the profile samples
+    mapfloat *buf;  // buffer for a single object
+
+    long banklen;   // allocated length of bank
+    mapfloat *bank; // stamps at the subpixel_K^2 sub-pixel offsets (each bufside^2)
+    int *bank_done; // [subpixel_K^2], whether the stamp has been computed
+
+    mapfloat *cnt; // halo counts for painting in Fourier space
+                   //     (in-place r2c FFT, so Nside x (Nside+2))
+    mapcomplex *cnt_acc; // [Nside x (Nside/2+1)], sum of the halos this thread
+                         //     painted in Fourier space
+    double *ellmod; // [Nside/2+1], scratch for the Fourier space painting
+    double *sell;   // [Nside/2+1]
+
+    long Ncat;    // number of halos recorded by this thread
+    long catlen;  // allocated length of cat
+    hmpdf_catalog_halo_t *cat;
 
     gsl_rng *rng;
 }//}}}
@@ -35,12 +64,29 @@ typedef struct//{{{
     int mapseed;
 
     int pxlgrid;
+    int pixelavg;
+
+    int subpixel_K;
+
+    int fourier_min_N;
+    unsigned *Nfourier; // [Nz*NM], number of halos to be painted in Fourier space
+    mapfftw_plan *p_cnt_r2c; // executed with the ws->cnt arrays
+
+    char *catalog_out;
+    char *catalog_in;
+
+    int created_catalog_in;
+    hmpdf_catalog_halo_t *cat_in; // sorted by bin
+    long *cat_in_offsets; // [Nz*NM+1], halos of bin ii are
+                          //     cat_in[cat_in_offsets[ii] ... cat_in_offsets[ii+1]-1]
 
     int created_mem;
     int need_ft;
 
     int created_ellgrid;
     double *ellgrid;
+    double *pxlwindow; // [Nside/2+1], pixel window of the directly painted halos
+                       //     (without pixelavg) along one axis
 
     int created_sidelengths;
     long Nside;
@@ -48,10 +94,10 @@ typedef struct//{{{
 
     int created_map;
     long ldmap;
-    double *map_real;
-    double complex *map_comp;
-    fftw_plan *p_r2c;
-    fftw_plan *p_c2r;
+    mapfloat *map_real;
+    mapcomplex *map_comp;
+    mapfftw_plan *p_r2c;
+    mapfftw_plan *p_c2r;
 
     int Nws;
     int created_map_ws;
@@ -64,5 +110,6 @@ int reset_maps(hmpdf_obj *d);
 int hmpdf_get_map_op(hmpdf_obj *d, int Nbins, double binedges[Nbins+1], double op[Nbins], int new_map);
 int hmpdf_get_map_ps(hmpdf_obj *d, int Nbins, double binedges[Nbins+1], double ps[Nbins], int new_map);
 int hmpdf_get_map(hmpdf_obj *d, double **map, long *Nside, int new_map);
+int hmpdf_get_mapf(hmpdf_obj *d, float **map, long *Nside, int new_map);
 
 #endif
@@ -56,6 +56,11 @@ typedef struct//{{{
     //
 
     double zsource;
+
+    int source_N; // multiple source bins sharing the profiles
+    double *source_z;
+    void **source_dndz_params;
+    int source_bin; // currently selected
 }//}}}
 numerics_t;
 
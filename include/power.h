@@ -11,11 +11,19 @@ typedef struct//{{{
 {
     int inited_power;
 
+    // linear power spectrum at z=0, tabulated uniformly in log(k)
+    int Pk_N;
+    double Pk_lnkmin, Pk_lnkmax, Pk_dlnk;
+    double Pk_slope_lo; // power law extrapolation below Pk_lnkmin
+    double *Pk_lnP;
+
+    int ssq_fftlog;
     double **ssq;
     double autocorr;
 
     int created_corr;
-    double corr_rmax;
+    double corr_rmin, corr_rmax; // range of the interpolator (which is in log(r))
+    double corr_zeta0; // value at small r
     gsl_spline *corr_interp;
     int Ncorr_accel;
     gsl_interp_accel **corr_accel;
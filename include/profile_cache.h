@@ -0,0 +1,17 @@
+#ifndef PROFILE_CACHE_H
+#define PROFILE_CACHE_H
+
+#include "hmpdf.h"
+
+typedef enum
+{//{{{
+    cache_profiles,
+    cache_conj_profiles,
+    cache_filtered_profiles,
+}//}}}
+profile_cache_e;
+
+int profile_cache_load(hmpdf_obj *d, profile_cache_e which, int *found);
+int profile_cache_save(hmpdf_obj *d, profile_cache_e which);
+
+#endif
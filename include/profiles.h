@@ -1,11 +1,34 @@
 #ifndef PROFILES_H
 #define PROFILES_H
 
+#include <complex.h>
+
+#include <fftw3.h>
+
 #include <gsl/gsl_interp.h>
+#include <gsl/gsl_spline2d.h>
 #include <gsl/gsl_dht.h>
 
 #include "hmpdf.h"
 
+typedef struct
+// tabulated line-of-sight integral of the dimensionless GNFW pressure profile,
+//     int_0^l dz r^gamma / (1 + r^alpha)^beta,  r = sqrt(z^2 + rproj^2),
+//     for fixed (alpha, gamma)
+{//{{{
+    double alpha;
+    double gamma;
+
+    int Nbeta;    // number of beta nodes (1 if beta is the same for all halos)
+    double beta0; // first beta node
+    double dbeta; // spacing of beta nodes
+
+    double logrmin, logrmax; // range of log(rproj)
+    double loglmin, loglmax; // range of log(l)
+    gsl_spline2d **tabs; // [Nbeta], log of the integral on the (log rproj, log l) grid
+}//}}}
+gnfw_table_t;
+
 typedef struct//{{{
 {
     int inited_profiles;
@@ -24,21 +47,62 @@ typedef struct//{{{
     double *reci_tgrid; // reciprocal space grid
 
     gsl_interp_accel **incr_tgrid_accel;
-    gsl_interp_accel *reci_tgrid_accel;
+    gsl_interp_accel **reci_tgrid_accel;
+
+    // the per-(z,M) arrays below are stored in single slabs,
+    //     profiles[z_index][M_index] = profiles[0][0] + (z_index*NM + M_index) * stride
 
     double ***profiles; // each profile has as zero entry theta out and then the profile
+                        //    (stride Ntheta+2)
 
     int created_conj_profiles;
     double ***conj_profiles; // each profile has as zero entry the rescaling such that reci_thetagrid -> ell
+                             //    (stride Ntheta+1)
 
     int created_filtered_profiles;
-    double ***filtered_profiles;
+    double ***filtered_profiles; // stride Ntheta+2
+
+    int created_pixelavg_profiles;
+    double ***pixelavg_profiles; // same format as filtered_profiles,
+                                 //    but only the pixel window function is applied
 
     int created_segments;
-    int ***segment_boundaries;
+    int ***segment_boundaries; // variable length,
+    long *segment_offsets;     //    [Nz*NM+1] offsets into the slab
+
+    int los_fixed_order;
+    double *losquad_x; // Gauss-Legendre nodes on [0,1], LOSQUAD_N + LOSQUAD_N/2
+    double *losquad_w; //     (high and low order)
+
+    int tsz_table;
+    int created_gnfw_tables;
+    int Ngnfw_tables;
+    gnfw_table_t *gnfw_tables;
 
     gsl_dht *dht_ws;
 
+    int fftlog;
+    int fftlog_N;
+    double fftlog_lnx0; // first point of the logarithmic theta grid
+    double fftlog_dlnx; // spacing of the logarithmic grid (same in theta and ell)
+    double complex *fftlog_u; // [N/2+1], FFTLog kernel
+    fftw_plan *fftlog_r2c; // batched over masses
+    fftw_plan *fftlog_c2r;
+
+    char *cache_dir; // on-disk cache for profiles, conj_profiles, filtered_profiles
+
+    int Mstride; // if > 1, only every Mstride-th mass profile is computed exactly
+
+    int theta_adaptive; // only evaluate the profiles at the angles required for
+                        //     interpolation accuracy
+
+    int bcm_abel; // project the tabulated BCM density
+    int bcm_abel_fallback; // Abel projection was found inaccurate,
+                           //     using the line-of-sight integration instead
+
+    double *zM_cost; // [Nz*NM], modelled or measured cost of the exact profile computations,
+                     //     used to schedule the (z,M) tasks
+
     hmpdf_mass_resc_f mass_resc;
     void *mass_resc_params;
 
@@ -85,16 +149,24 @@ batch_container_t;
 
 void delete_batch(batch_t *b);
 
+int new_profile_slab(hmpdf_obj *d, long stride, double ****out);
+void delete_profile_slab(double ***x);
+
 int null_profiles(hmpdf_obj *d);
 int reset_profiles(hmpdf_obj *d);
 int init_profiles(hmpdf_obj *d);
 int create_conj_profiles(hmpdf_obj *d);
 int create_filtered_profiles(hmpdf_obj *d);
 int create_segments(hmpdf_obj *d);
+int create_pixelavg_profiles(hmpdf_obj *d);
+int rescale_profiles(hmpdf_obj *d, const double *invScrit);
 
 int s_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s);
+int s_pixelavg_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s);
 int s_of_ell(hmpdf_obj *d, int z_index, int M_index, int Nell, double *ell, double *s);
 int inv_profile(hmpdf_obj *d, int z_index, int M_index, int segment,
                 inv_profile_e mode, batch_t *b);
+int inv_profile_scaled(hmpdf_obj *d, int z_index, int M_index, int segment,
+                       inv_profile_e mode, double scale, batch_t *b);
 
 #endif
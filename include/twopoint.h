@@ -34,6 +34,16 @@ typedef struct//{{{
     batch_t ***t; // [ z_index, M_index, segment ]
     double complex **ac; // [ z_index, lambda_index ]
     double complex *au; // [ lambda_index ] // allocated with fftw_malloc
+
+    // the same for the second pixel, which can be in another source bin
+    //     (bin2 = -1 if it is in the selected one, then these point to the above)
+    int bin2;
+    batch_t ***dtsq2;
+    batch_t ***t2;
+    double complex **ac2;
+    double complex *au2;
+    double *PDFc2; // one-point PDF in the second source bin
+    double signalmeanc2;
     
     double last_phi;
 
@@ -50,7 +60,9 @@ int new_tp_ws(long N, twopoint_workspace **out);
 int null_twopoint(hmpdf_obj *d);
 int reset_twopoint(hmpdf_obj *d);
 int create_phi_indep(hmpdf_obj *d);
+int select_tp_bin2(hmpdf_obj *d, int bin2);
 int create_tp(hmpdf_obj *d, double phi, twopoint_workspace *ws);
 int hmpdf_get_tp(hmpdf_obj *d, double phi, int Nbins, double binedges[Nbins+1], double tp[Nbins*Nbins], int noisy);
+int hmpdf_get_tp_cross(hmpdf_obj *d, double phi, int bin2, int Nbins, double binedges[Nbins+1], double tp[Nbins*Nbins]);
 
 #endif
@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <complex.h>
@@ -462,6 +463,12 @@ void tofile(char *fname, int Nlines, int Nvec, ...);
 double **fromfile(char *fname, int *Nlines, int Nvec);
 int isfile(char *fname);
 
+// hashing for the keys of on-disk caches
+#define HASH_INIT 0xcbf29ce484222325ULL
+uint64_t hash_bytes(uint64_t h, const void *data, size_t len);
+#define HASH_VAL(h, x) h = hash_bytes(h, &(x), sizeof(x))
+#define HASH_ARR(h, x, N) h = hash_bytes(h, (x), (N) * sizeof(*(x)))
+
 #ifdef _OPENMP
 #   define THIS_THREAD omp_get_thread_num()
 #else
@@ -509,5 +516,8 @@ int bin_1d(int N, double *x, double *y,
 
 int bin_2d(int N, double *x, double *z, int Nsample,
            int Nbins, double *binedges, double *out, interp2d_mode m);
+int bin_2d_asym(int N, double *x, double *z, int Nsample,
+                int Nbins, double *binedges1, double *binedges2,
+                double *out, interp2d_mode m);
 
 #endif
@@ -33,6 +33,7 @@ null_bcm(hmpdf_obj *d)
 
     d->bcm->inited_bcm = 0;
     d->bcm->radii = NULL;
+    d->bcm->bg_gl = NULL;
     d->bcm->ws = NULL;
     d->bcm->profiles_indices = NULL;
 
@@ -47,6 +48,7 @@ reset_bcm(hmpdf_obj *d)
     HMPDFPRINT(2, "\treset_bcm\n");
 
     if (d->bcm->radii != NULL) { free(d->bcm->radii); }
+    if (d->bcm->bg_gl != NULL) { gsl_integration_glfixed_table_free(d->bcm->bg_gl); }
     if (d->bcm->ws != NULL)
     {
         for (int ii=0; ii<d->Ncores; ii++)
@@ -87,6 +89,9 @@ init_bcm(hmpdf_obj *d)
     // find the radius closest(ish) to R200c -- this is not super important and only
     // a small optimization in the computation of xi
     for (d->bcm->R200c_idx=0; d->bcm->radii[d->bcm->R200c_idx]<1.0; d->bcm->R200c_idx++);
+
+    // the nodes are shared between threads
+    SAFEALLOC(d->bcm->bg_gl, gsl_integration_glfixed_table_alloc(BCM_BGTAB_GLN));
     
     // allocate the workspaces
     SAFEALLOC(d->bcm->ws, malloc(d->Ncores * sizeof(bcm_ws *)));
@@ -127,6 +132,7 @@ bcm_new_ws(hmpdf_obj *d, bcm_ws *ws)
     STARTFCT
 
     SAFEALLOC(ws->dm_xi, malloc(d->bcm->Nradii * sizeof(double)));
+    SAFEALLOC(ws->bg_M, malloc(d->bcm->Nradii * sizeof(double)));
 
     SAFEALLOC(ws->dm_r_accel, gsl_interp_accel_alloc());
     // TODO think about interpolation type here, will need to see examples
@@ -143,6 +149,7 @@ bcm_delete_ws(bcm_ws *ws)
     STARTFCT
 
     free(ws->dm_xi);
+    free(ws->bg_M);
     gsl_interp_accel_free(ws->dm_r_accel);
     gsl_interp_free(ws->dm_xi_interp);
     gsl_integration_workspace_free(ws->bg_integr_ws);
@@ -281,43 +288,59 @@ rho_bg(double r, bcm_ws *ws)
 #endif
 }//}}}
 
-#ifdef ARICO20
-inline static double
-M_bg_integrand(double r, void *p)
-// basically the same function as above only with 4pi r^2 Jacobian
-// and GSL-compatible
+static int
+M_bg_shell(hmpdf_obj *d, double r1, double r2, bcm_ws *ws, double *out)
+// bound gas mass between r1 and r2,
+//     which should be close enough that a low order rule is sufficient
 {//{{{
-    bcm_ws *ws = (bcm_ws *)p;
-    return 4.0 * M_PI * gsl_pow_2(r) * rho_bg(r, ws);
+    STARTFCT
+
+    *out = 0.0;
+    for (size_t ii=0; ii<BCM_BGTAB_GLN; ii++)
+    {
+        double r, w;
+        SAFEGSL(gsl_integration_glfixed_point(r1, r2, ii, &r, &w, d->bcm->bg_gl));
+        *out += w * 4.0 * M_PI * gsl_pow_2(r) * rho_bg(r, ws);
+    }
+
+    ENDFCT
 }//}}}
-#endif // ifdef Arico20
 
 static int
-M_bg(double r, bcm_ws *ws, double other_mass, double *out)
-// bound gas mass profile
-// The other_mass is the remaining baryonic mass, which should be computed beforehand.
-// This can be used to robustly terminate the integration such that the total baryonic
-// mass is well approximated.
-// Can also pass a negative number for this parameter in case it is not known.
+tabulate_M_bg(hmpdf_obj *d, bcm_ws *ws)
+// fills bg_M by cumulative integration over the radii,
+//     splitting the intervals where rho_bg has kinks
 {//{{{
     STARTFCT
 
 #ifdef ARICO20
-    gsl_function integrand;
-
-    integrand.function = &M_bg_integrand;
-    integrand.params = ws;
-
-    double err;
-    SAFEGSL(gsl_integration_qag(&integrand, 0.0, r,
-                                (other_mass > 0.0) ? BCM_BGINTEGR_EPSABS * other_mass : 0.0,
-                                BCM_BGINTEGR_EPSREL,
-                                BCM_BGINTEGR_LIMIT, BCM_BGINTEGR_KEY,
-                                ws->bg_integr_ws, out, &err));
-#else 
-    SAFEHMPDF(M_bg0(r, ws, other_mass, out));
-    *out += M_bg1(r, ws);
+    double breaks[] = { ws->R200c, };
+#else
+    double breaks[] = { ws->R200c/M_SQRT5, ws->R200c, };
 #endif
+    int Nbreaks = sizeof(breaks) / sizeof(double);
+
+    double rlo = 0.0;
+    double M = 0.0;
+    double dM;
+    for (int r_index=0; r_index<d->bcm->Nradii; r_index++)
+    {
+        double rhi = d->bcm->radii[r_index] * ws->R200c;
+        double r1 = rlo;
+        for (int ii=0; ii<Nbreaks; ii++)
+        {
+            if (breaks[ii] > rlo && breaks[ii] < rhi)
+            {
+                SAFEHMPDF(M_bg_shell(d, r1, breaks[ii], ws, &dM));
+                M += dM;
+                r1 = breaks[ii];
+            }
+        }
+        SAFEHMPDF(M_bg_shell(d, r1, rhi, ws, &dM));
+        M += dM;
+        ws->bg_M[r_index] = M;
+        rlo = rhi;
+    }
 
     ENDFCT
 }//}}}
@@ -425,6 +448,15 @@ M_nfw(double r, bcm_ws *ws)
            * ( log1p(rout/ws->rs) - rout/(rout+ws->rs) );
 }//}}}
 
+inline static double
+rho_dm_xi(double r, double xi, double xiprime, bcm_ws *ws)
+// relaxed dark matter density profile, given the contraction xi(r/R200c)
+// and its derivative
+{//{{{
+    // TODO check this expression
+    return ws->dm_f * rho_nfw(r / xi, ws) * (xi - r/ws->R200c*xiprime) / gsl_pow_4(xi);
+}//}}}
+
 inline static int 
 rho_dm(hmpdf_obj *d, double r, bcm_ws *ws, double *out)
 {//{{{
@@ -436,8 +468,7 @@ rho_dm(hmpdf_obj *d, double r, bcm_ws *ws, double *out)
     SAFEGSL(gsl_interp_eval_deriv_e(ws->dm_xi_interp, d->bcm->radii, ws->dm_xi,
                                     r/ws->R200c, ws->dm_r_accel, &xiprime));
 
-    // TODO check this expression
-    *out = ws->dm_f * rho_nfw(r / xi, ws) * (xi - r/ws->R200c*xiprime) / gsl_pow_4(xi);
+    *out = rho_dm_xi(r, xi, xiprime, ws);
 
     ENDFCT
 }//}}}
@@ -480,21 +511,13 @@ f_cg_fit(hmpdf_obj *d, int z_index, double M200c)
 }//}}}
 
 inline static int
-find_xi_at_rf(double rf, double xi_init, bcm_ws *ws, double *out)
+find_xi_at_rf(double rf, double M_bary, double xi_init, bcm_ws *ws, double *out)
+// M_bary is the total baryonic mass enclosed in rf.
 // xi_init can be a guess for what xi should be, will be used to speed
 //         up the search if chosen well.
 {//{{{
     STARTFCT
 
-#ifdef ARICO20
-    double M_bary = M_cg(rf, ws) + M_rg(rf, ws) + M_eg(rf, ws);
-#else
-    double M_bary = M_cg(rf, ws) + M_eg(rf, ws);
-#endif
-    double m_bg;
-    SAFEHMPDF(M_bg(rf, ws, M_bary, &m_bg));
-    M_bary += m_bg;
-
     double xi, diff;
 
     do
@@ -517,20 +540,33 @@ interpolate_xi(hmpdf_obj *d, bcm_ws *ws)
 {//{{{
     STARTFCT
 
+    // the enclosed baryonic mass on the radial grid,
+    //     use dm_xi as temporary storage
+    double *M_bary = ws->dm_xi;
+    for (int r_index=0; r_index<d->bcm->Nradii; r_index++)
+    {
+        double rf = d->bcm->radii[r_index] * ws->R200c;
+#ifdef ARICO20
+        M_bary[r_index] = M_cg(rf, ws) + M_rg(rf, ws) + M_eg(rf, ws) + ws->bg_M[r_index];
+#else
+        M_bary[r_index] = M_cg(rf, ws) + M_eg(rf, ws) + ws->bg_M[r_index];
+#endif
+    }
+
     // we know that at R200c xi=1, so this is a good place to start
     int start_idx = d->bcm->R200c_idx;
 
-    SAFEHMPDF(find_xi_at_rf(d->bcm->radii[start_idx]*ws->R200c,
+    SAFEHMPDF(find_xi_at_rf(d->bcm->radii[start_idx]*ws->R200c, M_bary[start_idx],
                             1.0, ws, ws->dm_xi+start_idx));
 
     // now go upwards in r
     for (int r_index=start_idx+1; r_index<d->bcm->Nradii; r_index++)
-        SAFEHMPDF(find_xi_at_rf(d->bcm->radii[r_index]*ws->R200c,
+        SAFEHMPDF(find_xi_at_rf(d->bcm->radii[r_index]*ws->R200c, M_bary[r_index],
                                 ws->dm_xi[r_index-1], ws, ws->dm_xi+r_index));
 
     // now go downwards in r
     for (int r_index=start_idx-1; r_index>=0; r_index--)
-        SAFEHMPDF(find_xi_at_rf(d->bcm->radii[r_index]*ws->R200c,
+        SAFEHMPDF(find_xi_at_rf(d->bcm->radii[r_index]*ws->R200c, M_bary[r_index],
                                 ws->dm_xi[r_index+1], ws, ws->dm_xi+r_index));
 
     // TODO we may need a smoothing function here to get rid of small-scale noise
@@ -610,9 +646,14 @@ bcm_init_ws(hmpdf_obj *d, int z_index, int M_index, double mass_resc, bcm_ws *ws
     ws->bg_r_inn = theta_inn_this_z * ws->R200c;
     ws->bg_r_out = theta_out_this_z * ws->R200c;
     ws->bg_beta_i = 3.0 - pow(M_inn_this_z/ws->M200c, 0.31);
-    double m_bg;
-    SAFEHMPDF(M_bg(ws->R200c, ws, -1, &m_bg));
+    // the bound gas vanishes outside R200c, so the last entry is the total mass
+    SAFEHMPDF(tabulate_M_bg(d, ws));
+    double m_bg = ws->bg_M[d->bcm->Nradii-1];
     ws->bg_y0 = f_bg * ws->M200c / m_bg;
+    for (int r_index=0; r_index<d->bcm->Nradii; r_index++)
+    {
+        ws->bg_M[r_index] *= ws->bg_y0;
+    }
 #else
     ws->bg_y0 = 1.0;
     ws->bg_y1 = 1.0;
@@ -628,6 +669,7 @@ bcm_init_ws(hmpdf_obj *d, int z_index, int M_index, double mass_resc, bcm_ws *ws
     // fix y0, y1 by requiring continuity and correct integral
     ws->bg_y0 = f_bg * ws->M200c * g1 / (g1*m_bg0 + g0*m_bg1);
     ws->bg_y1 = f_bg * ws->M200c * g0 / (g1*m_bg0 + g0*m_bg1);
+    SAFEHMPDF(tabulate_M_bg(d, ws));
 #endif
 
     ws->cg_y0 = 1.0;
@@ -690,6 +732,53 @@ bcm_density_profile(hmpdf_obj *d, bcm_ws *ws, double r, double *out)
     ENDFCT
 }//}}}
 
+int
+bcm_density_profile_batch(hmpdf_obj *d, bcm_ws *ws, long N, double *r, double *out)
+{//{{{
+    STARTFCT
+
+    // halo-dependent constants, shared by all radii
+    #define POW3(x) ((x)*(x)*(x))
+    const double eg_pref = ws->eg_f * ws->M200c
+                           * POW3(0.5 * M_SQRT1_2 * M_2_SQRTPI) / POW3(ws->eg_rej);
+    #undef POW3
+    const double eg_expfac = -0.5 / gsl_pow_2(ws->eg_rej);
+    const double nfw_pref = ws->dm_f * ws->rhos;
+
+    for (long ii=0; ii<N; ii++)
+    {
+        // out and r are allowed to alias
+        double rr = r[ii];
+        double x200c = rr / ws->R200c;
+
+        // the accelerator is shared, so sorted radii make the lookups cheap
+        double xi, xiprime;
+        SAFEGSL(gsl_interp_eval_e(ws->dm_xi_interp, d->bcm->radii, ws->dm_xi,
+                                  x200c, ws->dm_r_accel, &xi));
+        SAFEGSL(gsl_interp_eval_deriv_e(ws->dm_xi_interp, d->bcm->radii, ws->dm_xi,
+                                        x200c, ws->dm_r_accel, &xiprime));
+
+#ifdef ARICO20
+        double rho = rho_bg(rr, ws) + rho_cg(rr, ws) + rho_rg(rr, ws);
+#else
+        double rho = rho_bg(rr, ws) + rho_cg(rr, ws);
+#endif
+        rho += eg_pref * exp(eg_expfac * gsl_pow_2(rr));
+        rho += rho_dm_xi(rr, xi, xiprime, ws);
+
+        // do the DM particles that have not been translated (outside R200c)
+        if (rr > ws->R200c)
+        {
+            double x = rr / ws->rs;
+            rho += nfw_pref / (x * gsl_pow_2(1.0 + x));
+        }
+
+        out[ii] = rho;
+    }
+
+    ENDFCT
+}//}}}
+
 int
 bcm_profiles_to_file(hmpdf_obj *d, int z_index, int M_index, bcm_ws *ws, char *fname)
 {//{{{
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "configs.h"
+#include "utils.h"
+#include "object.h"
+#include "class_interface.h"
+#include "cosmology.h"
+#include "power.h"
+#include "class_cache.h"
+
+#include "hmpdf.h"
+
+// The quantities we extract from CLASS (background on the redshift grid,
+//     the linear power spectrum table, sigma^2(M) and the autocorrelation)
+//     are stored in a single binary file, keyed by the contents of the
+//     .ini and precision files and the grids.
+
+// number of blocks in the layout defined in cache_blocks,
+//     not counting the NM sigma^2 blocks
+#define NBLOCKS_BG 13
+#define NBLOCKS (NBLOCKS_BG + 5)
+
+typedef struct
+{//{{{
+    char magic[8]; // "HMPDFCLC"
+    uint64_t key;
+    int Nz;
+    int NM;
+    long len; // number of doubles following the header
+}//}}}
+class_cache_header_t;
+
+typedef struct
+{//{{{
+    double *ptr;
+    long N;
+}//}}}
+cache_block_t;
+
+static int
+hash_file(char *fname, uint64_t *h)
+{//{{{
+    STARTFCT
+
+    FILE *fp = fopen(fname, "rb");
+    HMPDFCHECK(fp == NULL, "failed to open %s", fname);
+
+    char buf[CLASSCACHE_BUFLEN];
+    size_t len;
+    while ((len = fread(buf, 1, CLASSCACHE_BUFLEN, fp)) > 0)
+    {
+        *h = hash_bytes(*h, buf, len);
+    }
+    fclose(fp);
+
+    ENDFCT
+}//}}}
+
+static int
+cache_key(hmpdf_obj *d, int *cacheable, uint64_t *key)
+{//{{{
+    STARTFCT
+
+    // we cannot hash the user-supplied source distribution,
+    //     and the tabulated backends are cheap anyways
+    *cacheable = d->cls->cache_dir != NULL
+                 && !d->cls->use_tables
+                 && d->n->dndz == NULL
+                 && d->n->source_N == 0;
+    if (!*cacheable) { return 0; }
+
+    uint64_t h = HASH_INIT;
+    int version = CLASSCACHE_VERSION;
+    HASH_VAL(h, version);
+
+    // cosmology
+    SAFEHMPDF(hash_file(d->cls->class_ini, &h));
+    if (strcmp(d->cls->class_pre, "none"))
+    {
+        SAFEHMPDF(hash_file(d->cls->class_pre, &h));
+    }
+
+    // what we extract
+    int Pk_N = PKTAB_N;
+    HASH_VAL(h, Pk_N);
+    HASH_VAL(h, d->p->stype);
+    if (d->p->stype == hmpdf_kappa) { HASH_VAL(h, d->n->zsource); }
+    HASH_VAL(h, d->n->Nz);
+    HASH_ARR(h, d->n->zgrid, d->n->Nz);
+    HASH_VAL(h, d->n->NM);
+    HASH_ARR(h, d->n->Mgrid, d->n->NM);
+    HASH_VAL(h, d->pwr->ssq_fftlog);
+
+    *key = h;
+
+    ENDFCT
+}//}}}
+
+static int
+cache_blocks(hmpdf_obj *d, cache_block_t *blocks, int *Nblocks, long *len)
+// defines the layout of the cache file.
+//     blocks must have space for NBLOCKS + NM entries
+{//{{{
+    STARTFCT
+
+    int Nz = d->n->Nz;
+    int ii = 0;
+
+    // background
+    blocks[ii++] = (cache_block_t){ &(d->c->h), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->c->rho_c_0), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->c->rho_m_0), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->c->Om_0), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->c->Ob_0), 1 };
+    blocks[ii++] = (cache_block_t){ d->c->hubble, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->comoving, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->angular_diameter, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->Dsq, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->Om, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->rho_c, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->rho_m, Nz };
+    blocks[ii++] = (cache_block_t){ d->c->invScrit,
+                                    (d->p->stype == hmpdf_kappa) ? Nz : 0 };
+
+    // power spectrum
+    blocks[ii++] = (cache_block_t){ &(d->pwr->Pk_lnkmin), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->pwr->Pk_lnkmax), 1 };
+    blocks[ii++] = (cache_block_t){ &(d->pwr->Pk_slope_lo), 1 };
+    blocks[ii++] = (cache_block_t){ d->pwr->Pk_lnP, PKTAB_N };
+    blocks[ii++] = (cache_block_t){ &(d->pwr->autocorr), 1 };
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        blocks[ii++] = (cache_block_t){ (d->pwr->ssq==NULL) ? NULL : d->pwr->ssq[M_index], 2 };
+    }
+
+    HMPDFCHECK(ii != NBLOCKS + d->n->NM, "inconsistent cache layout");
+    *Nblocks = ii;
+
+    *len = 0;
+    for (int jj=0; jj<*Nblocks; jj++)
+    {
+        *len += blocks[jj].N;
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+copy_from_cache(hmpdf_obj *d, int first, int last)
+// copies blocks [first, last) from the loaded buffer
+{//{{{
+    STARTFCT
+
+    cache_block_t *blocks;
+    SAFEALLOC(blocks, malloc((NBLOCKS + d->n->NM) * sizeof(cache_block_t)));
+    int Nblocks;
+    long len;
+    SAFEHMPDF(cache_blocks(d, blocks, &Nblocks, &len));
+    if (last < 0) { last = Nblocks; }
+
+    long offset = 0;
+    for (int ii=0; ii<last; ii++)
+    {
+        if (ii >= first && blocks[ii].N > 0)
+        {
+            memcpy(blocks[ii].ptr, d->cls->cache_buf + offset,
+                   blocks[ii].N * sizeof(double));
+        }
+        offset += blocks[ii].N;
+    }
+
+    free(blocks);
+
+    ENDFCT
+}//}}}
+
+static char *
+cache_fname(hmpdf_obj *d, uint64_t key)
+{//{{{
+    size_t len = strlen(d->cls->cache_dir) + 64;
+    char *out = malloc(len);
+    if (out != NULL)
+    {
+        snprintf(out, len, "%s/class_%016llx.bin",
+                 d->cls->cache_dir, (unsigned long long)key);
+    }
+    return out;
+}//}}}
+
+int
+class_cache_load(hmpdf_obj *d, int *found)
+// if a matching cache file exists, reads it into a buffer
+//     from which class_cache_background and class_cache_power copy
+{//{{{
+    STARTFCT
+
+    *found = 0;
+
+    int cacheable;
+    uint64_t key;
+    SAFEHMPDF(cache_key(d, &cacheable, &key));
+    if (!cacheable) { return 0; }
+
+    // the buffer length does not depend on any allocated arrays
+    cache_block_t *blocks;
+    SAFEALLOC(blocks, malloc((NBLOCKS + d->n->NM) * sizeof(cache_block_t)));
+    int Nblocks;
+    long len;
+    SAFEHMPDF(cache_blocks(d, blocks, &Nblocks, &len));
+    free(blocks);
+
+    // allocated before opening the file so no error path leaks it
+    char *fname;
+    SAFEALLOC(fname, cache_fname(d, key));
+    SAFEALLOC(d->cls->cache_buf, malloc(len * sizeof(double)));
+
+    FILE *fp = fopen(fname, "rb");
+    if (fp == NULL)
+    {
+        HMPDFPRINT(3, "\t\tCLASS results not found in cache\n");
+        free(d->cls->cache_buf);
+        d->cls->cache_buf = NULL;
+        free(fname);
+        errno = 0;
+        return 0;
+    }
+
+    class_cache_header_t hdr;
+    if (fread(&hdr, sizeof(class_cache_header_t), 1, fp) != 1
+        || memcmp(hdr.magic, "HMPDFCLC", 8) || hdr.key != key
+        || hdr.Nz != d->n->Nz || hdr.NM != d->n->NM || hdr.len != len)
+    {
+        HMPDFPRINT(1, "\t\tCLASS cache file %s is inconsistent, ignoring it.\n", fname);
+        free(d->cls->cache_buf);
+        d->cls->cache_buf = NULL;
+        fclose(fp);
+        free(fname);
+        errno = 0;
+        return 0;
+    }
+
+    if (fread(d->cls->cache_buf, sizeof(double), len, fp) != (size_t)len)
+    {
+        HMPDFPRINT(1, "\t\tCLASS cache file %s is incomplete, ignoring it.\n", fname);
+        free(d->cls->cache_buf);
+        d->cls->cache_buf = NULL;
+        fclose(fp);
+        free(fname);
+        errno = 0;
+        return 0;
+    }
+    fclose(fp);
+
+    HMPDFPRINT(2, "\t\tloaded CLASS results from %s\n", fname);
+    free(fname);
+
+    *found = 1;
+
+    ENDFCT
+}//}}}
+
+int
+class_cache_background(hmpdf_obj *d)
+// fills the (allocated) cosmology arrays from the loaded cache
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(copy_from_cache(d, 0, NBLOCKS_BG));
+
+    ENDFCT
+}//}}}
+
+int
+class_cache_power(hmpdf_obj *d)
+// allocates and fills the power spectrum table and sigma^2 from the loaded cache
+{//{{{
+    STARTFCT
+
+    d->pwr->Pk_N = PKTAB_N;
+    SAFEALLOC(d->pwr->Pk_lnP, malloc(d->pwr->Pk_N * sizeof(double)));
+
+    SAFEALLOC(d->pwr->ssq, malloc(d->n->NM * sizeof(double *)));
+    SETARRNULL(d->pwr->ssq, d->n->NM);
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        SAFEALLOC(d->pwr->ssq[M_index], malloc(2 * sizeof(double)));
+    }
+
+    SAFEHMPDF(copy_from_cache(d, NBLOCKS_BG, -1));
+
+    d->pwr->Pk_dlnk = (d->pwr->Pk_lnkmax - d->pwr->Pk_lnkmin)
+                      / (double)(d->pwr->Pk_N - 1);
+
+    // no longer needed
+    free(d->cls->cache_buf);
+    d->cls->cache_buf = NULL;
+
+    ENDFCT
+}//}}}
+
+int
+class_cache_save(hmpdf_obj *d)
+// writes to a temporary file first and renames it,
+//     so concurrent processes never see an incomplete file
+{//{{{
+    STARTFCT
+
+    if (d->cls->from_cache) { return 0; }
+
+    int cacheable;
+    uint64_t key;
+    SAFEHMPDF(cache_key(d, &cacheable, &key));
+    if (!cacheable) { return 0; }
+
+    if (mkdir(d->cls->cache_dir, 0755) && errno != EEXIST)
+    {
+        HMPDFPRINT(1, "\t\tfailed to create CLASS cache directory %s, "
+                      "not saving.\n", d->cls->cache_dir);
+        errno = 0;
+        return 0;
+    }
+    errno = 0;
+
+    char *fname;
+    SAFEALLOC(fname, cache_fname(d, key));
+    char *tmpname;
+    SAFEALLOC(tmpname, malloc(strlen(fname) + 32));
+    sprintf(tmpname, "%s.tmp.%ld", fname, (long)getpid());
+
+    cache_block_t *blocks;
+    SAFEALLOC(blocks, malloc((NBLOCKS + d->n->NM) * sizeof(cache_block_t)));
+    int Nblocks;
+    long len;
+    SAFEHMPDF(cache_blocks(d, blocks, &Nblocks, &len));
+
+    FILE *fp = fopen(tmpname, "wb");
+    if (fp == NULL)
+    {
+        HMPDFPRINT(1, "\t\tfailed to open %s for writing, not saving.\n", tmpname);
+        free(blocks);
+        free(fname);
+        free(tmpname);
+        errno = 0;
+        return 0;
+    }
+
+    class_cache_header_t hdr;
+    memset(&hdr, 0, sizeof(class_cache_header_t));
+    memcpy(hdr.magic, "HMPDFCLC", 8);
+    hdr.key = key;
+    hdr.Nz = d->n->Nz;
+    hdr.NM = d->n->NM;
+    hdr.len = len;
+
+    size_t written = fwrite(&hdr, sizeof(class_cache_header_t), 1, fp);
+    for (int ii=0; ii<Nblocks; ii++)
+    {
+        written += fwrite(blocks[ii].ptr, sizeof(double), blocks[ii].N, fp);
+    }
+    fclose(fp);
+
+    if (written != 1 + (size_t)len || rename(tmpname, fname))
+    {
+        remove(tmpname);
+        HMPDFPRINT(1, "\t\tfailed to write CLASS cache file %s.\n", fname);
+        errno = 0;
+    }
+    else
+    {
+        HMPDFPRINT(2, "\t\twrote CLASS results to %s\n", fname);
+    }
+
+    free(blocks);
+    free(fname);
+    free(tmpname);
+
+    ENDFCT
+}//}}}
@@ -4,9 +4,12 @@
 
 #include <class.h>
 
+#include "configs.h"
 #include "utils.h"
 #include "object.h"
 #include "class_interface.h"
+#include "eisenstein_hu.h"
+#include "class_cache.h"
 
 #include "hmpdf.h"
 
@@ -82,6 +85,110 @@ run_class(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
+static int
+read_table(char *fname, int Ncols, int *N, double **buf)
+// reads whitespace separated columns, lines starting with # are ignored.
+//     buf is allocated and filled column-wise, (*buf)[col*N + row]
+{//{{{
+    STARTFCT
+
+    FILE *fp = fopen(fname, "r");
+    HMPDFCHECK(fp == NULL, "failed to open %s", fname);
+
+    char line[TABLE_LINELEN];
+
+    // first pass: count the data lines
+    *N = 0;
+    while (fgets(line, TABLE_LINELEN, fp) != NULL)
+    {
+        char *c = line + strspn(line, " \t");
+        if (*c != '#' && *c != '\n' && *c != '\0') { ++*N; }
+    }
+    HMPDFCHECK(*N < 4, "too few rows (%d) in %s", *N, fname);
+
+    SAFEALLOC(*buf, malloc(Ncols * *N * sizeof(double)));
+
+    // second pass: parse
+    rewind(fp);
+    int row = 0;
+    while (fgets(line, TABLE_LINELEN, fp) != NULL)
+    {
+        char *c = line + strspn(line, " \t");
+        if (*c == '#' || *c == '\n' || *c == '\0') { continue; }
+        for (int col=0; col<Ncols; col++)
+        {
+            char *end;
+            (*buf)[col * *N + row] = strtod(c, &end);
+            HMPDFCHECK(end == c, "failed to parse column %d in row %d of %s",
+                       col, row, fname);
+            c = end;
+        }
+        ++row;
+    }
+    errno = 0; // strtod may set ERANGE for denormals, not a problem
+
+    fclose(fp);
+
+    ENDFCT
+}//}}}
+
+static int
+init_tables(hmpdf_obj *d)
+// sets up the user-supplied background and power spectrum tables
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\tinit_tables\n");
+
+    class_interface_t *c = d->cls;
+
+    if (c->bg_file != NULL)
+    {
+        SAFEHMPDF(read_table(c->bg_file, 4, &c->bg_N, &c->bg_buf));
+        c->bg_z   = c->bg_buf;
+        c->bg_H   = c->bg_buf + c->bg_N;
+        c->bg_chi = c->bg_buf + 2*c->bg_N;
+        c->bg_D   = c->bg_buf + 3*c->bg_N;
+    }
+    if (c->Pk_file != NULL)
+    {
+        SAFEHMPDF(read_table(c->Pk_file, 2, &c->Pk_N, &c->Pk_buf));
+        c->Pk_k = c->Pk_buf;
+        c->Pk_P = c->Pk_buf + c->Pk_N;
+    }
+
+    HMPDFCHECK(c->bg_z == NULL || c->bg_H == NULL || c->bg_chi == NULL || c->bg_D == NULL,
+               "hmpdf_bg_table_z, hmpdf_bg_table_H, hmpdf_bg_table_chi "
+               "and hmpdf_bg_table_D must all be passed");
+    HMPDFCHECK(c->Pk_k == NULL || c->Pk_P == NULL,
+               "hmpdf_Pk_table_k and hmpdf_Pk_table_P must both be passed");
+    HMPDFCHECK(c->h <= 0.0 || c->Om_0 <= 0.0 || c->Ob_0 < 0.0,
+               "hmpdf_cosmo_h, hmpdf_cosmo_Omega_m and hmpdf_cosmo_Omega_b "
+               "must be passed with tabulated cosmology");
+
+    for (int ii=1; ii<c->bg_N; ii++)
+    {
+        HMPDFCHECK(c->bg_z[ii] <= c->bg_z[ii-1],
+                   "background table redshifts must be strictly increasing");
+    }
+    for (int ii=0; ii<c->bg_N; ii++)
+    {
+        HMPDFCHECK(c->bg_H[ii] <= 0.0 || c->bg_D[ii] <= 0.0 || c->bg_chi[ii] < 0.0,
+                   "invalid background table entry at z = %g", c->bg_z[ii]);
+    }
+    for (int ii=0; ii<c->Pk_N; ii++)
+    {
+        HMPDFCHECK(c->Pk_k[ii] <= 0.0 || c->Pk_P[ii] <= 0.0,
+                   "power spectrum table entries must be positive");
+        HMPDFCHECK(ii && c->Pk_k[ii] <= c->Pk_k[ii-1],
+                   "power spectrum table wavenumbers must be strictly increasing");
+    }
+    HMPDFCHECK(c->Pk_k[c->Pk_N-1] < 1.0,
+               "power spectrum table should extend to k > 1/Mpc");
+
+    ENDFCT
+}//}}}
+
 int
 init_class_interface(hmpdf_obj *d)
 {//{{{
@@ -89,6 +196,21 @@ init_class_interface(hmpdf_obj *d)
 
     HMPDFPRINT(2, "\tinit_class_interface\n");
 
+    d->cls->use_tables = d->cls->bg_N > 0 || d->cls->bg_file != NULL
+                         || d->cls->EH98_params != NULL;
+    if (d->cls->use_tables)
+    {
+        if (d->cls->EH98_params != NULL)
+        {
+            SAFEHMPDF(EH98_tables(d));
+        }
+        SAFEHMPDF(init_tables(d));
+        return 0;
+    }
+
+    SAFEHMPDF(class_cache_load(d, &d->cls->from_cache));
+    if (d->cls->from_cache) { return 0; }
+
     char **argv;
     SAFEALLOC(argv, malloc(3 * sizeof(char *)));
     argv[1] = d->cls->class_ini;
@@ -128,6 +250,11 @@ null_class_interface(hmpdf_obj *d)
 {//{{{
     STARTFCT
 
+    d->cls->use_tables = 0;
+    d->cls->from_cache = 0;
+    d->cls->cache_buf = NULL;
+    d->cls->bg_buf = NULL;
+    d->cls->Pk_buf = NULL;
     d->cls->pr = NULL;
     d->cls->ba = NULL;
     d->cls->th = NULL;
@@ -156,6 +283,9 @@ reset_class_interface(hmpdf_obj *d)
     struct thermodynamics *th;
     struct background *ba;
 
+    if (d->cls->cache_buf != NULL) { free(d->cls->cache_buf); }
+    if (d->cls->bg_buf != NULL) { free(d->cls->bg_buf); }
+    if (d->cls->Pk_buf != NULL) { free(d->cls->Pk_buf); }
     if (d->cls->op != NULL) { free(d->cls->op); }
     if (d->cls->le != NULL) { free(d->cls->le); }
     if (d->cls->sp != NULL) { free(d->cls->sp); }
@@ -62,6 +62,16 @@ struct DEFAULTS def = { .Ncores={1,1,1000}, .verbosity=0, .warn_is_err=1,
                         .Battaglia12_p=def_Battaglia12_tsz_params,
                         .noise_pwr=NULL, .noise_pwr_params=NULL,
                         .fsky={-1.0,0.0,1.0}, .pxlgrid={3,1,20}, .mappoisson=1, .mapseed=INT_MAX,
+                        .map_pixelavg=0, .map_subpixel_K={0,0,16}, .map_fourier_min_N=0, .map_catalog_out=NULL, .map_catalog_in=NULL,
+                        .tsz_table=0, .los_fixed_order=0, .fftlog=0,
+                        .profile_cache=NULL, .profile_Mstride=0, .theta_adaptive=0,
+                        .bcm_abel=0, .ssq_fftlog=0,
+                        .bg_table_N=0, .bg_table_z=NULL, .bg_table_H=NULL, .bg_table_chi=NULL, .bg_table_D=NULL,
+                        .bg_table_file=NULL,
+                        .Pk_table_N=0, .Pk_table_k=NULL, .Pk_table_P=NULL, .Pk_table_file=NULL,
+                        .cosmo_h=-1.0, .cosmo_Omega_m=-1.0, .cosmo_Omega_b=-1.0,
+                        .EH98_params=NULL, .class_cache=NULL,
+                        .source_N=0, .source_z=NULL, .source_dndz_params=NULL,
                         .mass_z_fix_prof=0, .min_mass_fix_prof=8*1e14, .max_z_fix_prof=0.5};
 
 // The following is only needed for more reliable interaction
@@ -6,10 +6,12 @@
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_integration.h>
+#include <gsl/gsl_sort.h>
 
 #include "utils.h"
 #include "object.h"
 #include "class_interface.h"
+#include "class_cache.h"
 #include "configs.h"
 #include "cosmology.h"
 
@@ -23,6 +25,7 @@ null_cosmology(hmpdf_obj *d)
     d->c->comoving = NULL;
     d->c->angular_diameter = NULL;
     d->c->invScrit = NULL;
+    d->c->invScrit_bins = NULL;
     d->c->Dsq = NULL;
     d->c->rho_m = NULL;
     d->c->rho_c = NULL;
@@ -42,6 +45,7 @@ reset_cosmology(hmpdf_obj *d)
     if (d->c->comoving != NULL) { free(d->c->comoving); }
     if (d->c->angular_diameter != NULL) { free(d->c->angular_diameter); }
     if (d->c->invScrit != NULL) { free(d->c->invScrit); }
+    if (d->c->invScrit_bins != NULL) { free(d->c->invScrit_bins); }
     if (d->c->Dsq != NULL) { free(d->c->Dsq); }
     if (d->c->rho_m != NULL) { free(d->c->rho_m); }
     if (d->c->rho_c != NULL) { free(d->c->rho_c); }
@@ -68,6 +72,11 @@ alloc_cosmo(hmpdf_obj *d)
     if (d->p->stype == hmpdf_kappa)
     {
         SAFEALLOC(d->c->invScrit, malloc(d->n->Nz * sizeof(double)));
+        if (d->n->source_N)
+        {
+            SAFEALLOC(d->c->invScrit_bins,
+                      malloc(d->n->source_N * d->n->Nz * sizeof(double)));
+        }
     }
 
     ENDFCT
@@ -80,41 +89,281 @@ typedef struct
     struct background *ba;
     int index;
 
-    hmpdf_dndz_f dndz;
-    void *dndz_params;
+    // alternatively, the user-supplied tables
+    interp1d *H;
+    interp1d *chi;
+    interp1d *D;
+}
+bg_ws;
 
-    double chi_z;
+static int
+new_bg_ws(hmpdf_obj *d, bg_ws **out)
+{//{{{
+    STARTFCT
 
-    int status;
-} dndz_integr_params;
+    SAFEALLOC(*out, malloc(sizeof(bg_ws)));
+    bg_ws *ws = *out;
+    ws->pvecback = NULL;
+    ws->ba = NULL;
+    ws->index = 0;
+    ws->H = NULL;
+    ws->chi = NULL;
+    ws->D = NULL;
 
-static inline int
-dndz_integr_kernel(double z, dndz_integr_params *p, double *out)
-{
+    if (d->cls->use_tables)
+    {
+        class_interface_t *c = d->cls;
+        SAFEHMPDF(new_interp1d(c->bg_N, c->bg_z, c->bg_H, 0.0, 0.0,
+                               BGTAB_INTERP_TYPE, NULL, &ws->H));
+        SAFEHMPDF(new_interp1d(c->bg_N, c->bg_z, c->bg_chi, 0.0, 0.0,
+                               BGTAB_INTERP_TYPE, NULL, &ws->chi));
+        SAFEHMPDF(new_interp1d(c->bg_N, c->bg_z, c->bg_D, 0.0, 0.0,
+                               BGTAB_INTERP_TYPE, NULL, &ws->D));
+    }
+    else
+    {
+        ws->ba = (struct background *)d->cls->ba;
+        SAFEALLOC(ws->pvecback, malloc(ws->ba->bg_size * sizeof(double)));
+    }
+
+    ENDFCT
+}//}}}
+
+static void
+delete_bg_ws(bg_ws *ws)
+{//{{{
+    if (ws->pvecback != NULL) { free(ws->pvecback); }
+    if (ws->H != NULL) { delete_interp1d(ws->H); }
+    if (ws->chi != NULL) { delete_interp1d(ws->chi); }
+    if (ws->D != NULL) { delete_interp1d(ws->D); }
+    free(ws);
+}//}}}
+
+static int
+bg_table_eval(interp1d *interp, double z, double *out)
+{//{{{
     STARTFCT
 
-    double tau;
-    SAFECLASS(background_tau_of_z(p->ba, z, &tau),
-              p->ba->error_message);
-    SAFECLASS(background_at_tau(p->ba, tau, long_info, inter_normal, &p->index, p->pvecback),
-              p->ba->error_message);
+    int inrange;
+    SAFEHMPDF(interp1d_eval1(interp, z, &inrange, out));
+    HMPDFCHECK(!inrange, "z = %g not covered by the background table", z);
 
-    double chi_this_z = p->pvecback[p->ba->index_bg_conf_distance];
+    ENDFCT
+}//}}}
 
-    *out = (1.0 - p->chi_z/chi_this_z) * p->dndz(z, p->dndz_params);
+static int
+background_at_z(hmpdf_obj *d, bg_ws *ws, double z,
+                double *H, double *chi, double *dA, double *D, double *Om)
+// any of the outputs can be NULL if not needed
+{//{{{
+    STARTFCT
+
+    if (ws->ba != NULL)
+    {
+        double tau; // conformal time in Mpc
+        SAFECLASS(background_tau_of_z(ws->ba, z, &tau),
+                  ws->ba->error_message);
+        SAFECLASS(background_at_tau(ws->ba, tau, long_info,
+                                    inter_normal, &ws->index, ws->pvecback),
+                  ws->ba->error_message);
+
+        if (H != NULL) { *H = ws->pvecback[ws->ba->index_bg_H]; }
+        if (chi != NULL) { *chi = ws->pvecback[ws->ba->index_bg_conf_distance]; }
+        if (dA != NULL) { *dA = ws->pvecback[ws->ba->index_bg_ang_distance]; }
+        if (D != NULL) { *D = ws->pvecback[ws->ba->index_bg_D]; }
+        if (Om != NULL) { *Om = ws->pvecback[ws->ba->index_bg_Omega_m]; }
+    }
+    else
+    // flat universe assumed
+    {
+        double chi_z;
+        SAFEHMPDF(bg_table_eval(ws->chi, z, &chi_z));
+        if (chi != NULL) { *chi = chi_z; }
+        if (dA != NULL) { *dA = chi_z / (1.0 + z); }
+        if (D != NULL) { SAFEHMPDF(bg_table_eval(ws->D, z, D)); }
+        if (H != NULL || Om != NULL)
+        {
+            double H_z;
+            SAFEHMPDF(bg_table_eval(ws->H, z, &H_z));
+            if (H != NULL) { *H = H_z; }
+            if (Om != NULL)
+            {
+                *Om = d->c->Om_0 * gsl_pow_3(1.0+z)
+                      * gsl_pow_2(d->c->h / SPEEDOFLIGHT / H_z);
+            }
+        }
+    }
 
     ENDFCT
-}
+}//}}}
 
-static double
-dndz_integr_f(double z, void *params)
-{
-    dndz_integr_params *p = (dndz_integr_params *)params;
+static int
+lensing_efficiency(hmpdf_obj *d, bg_ws *bg, double zs, void *dndz_params,
+                   double norm, double *out)
+// computes int_z^zs dz' n(z') (1 - chi(z)/chi(z')) for all z in zgrid
+//     in a single backward sweep, accumulating
+//     A(z) = int_z^zs dz' n(z') and B(z) = int_z^zs dz' n(z')/chi(z')
+//     over fixed-order Gauss-Legendre sub-intervals.
+//     The comoving distance at the nodes is interpolated from a table
+//     that is much coarser than the nodes.
+{//{{{
+    STARTFCT
 
-    double out = 0.0; // to avoid maybe-uninitialized
-    p->status = dndz_integr_kernel(z, p, &out);
-    return out;
-}
+    // the sweep requires the redshift nodes in increasing order
+    size_t *order;
+    SAFEALLOC(order, malloc(d->n->Nz * sizeof(size_t)));
+    gsl_sort_index(order, d->n->zgrid, 1, d->n->Nz);
+
+    // tabulate chi(z) over the range covered by the sweep
+    double zlo = GSL_MIN(d->n->zgrid[order[0]], zs);
+    int Nchi = GSL_MAX(8, (int)ceil((zs - zlo) / DNDZ_CHI_DZ) + 1);
+    double *chi_z, *chi_chi;
+    SAFEALLOC(chi_z, malloc(Nchi * sizeof(double)));
+    SAFEALLOC(chi_chi, malloc(Nchi * sizeof(double)));
+    for (int ii=0; ii<Nchi; ii++)
+    {
+        chi_z[ii] = zlo + (double)ii * (zs - zlo) / (double)(Nchi - 1);
+        SAFEHMPDF(background_at_z(d, bg, chi_z[ii], NULL, chi_chi+ii, NULL, NULL, NULL));
+    }
+    interp1d *chi_interp = NULL;
+    if (zs > zlo)
+    {
+        SAFEHMPDF(new_interp1d(Nchi, chi_z, chi_chi, 0.0, 0.0,
+                               DNDZ_CHI_INTERP_TYPE, NULL, &chi_interp));
+    }
+
+    gsl_integration_glfixed_table *t;
+    SAFEALLOC(t, gsl_integration_glfixed_table_alloc(DNDZ_CUMUL_GLN));
+
+    double A = 0.0;
+    double B = 0.0;
+    double hi = zs;
+    for (int ii=d->n->Nz-1; ii>=0; ii--)
+    {
+        int z_index = (int)order[ii];
+        // lenses behind the source do not contribute
+        double lo = GSL_MIN(d->n->zgrid[z_index], zs);
+
+        int Nsub = (int)ceil((hi - lo) / DNDZ_CUMUL_DZ);
+        for (int jj=0; jj<Nsub; jj++)
+        {
+            double a = lo + (double)jj * (hi - lo) / (double)Nsub;
+            double b = lo + (double)(jj+1) * (hi - lo) / (double)Nsub;
+            for (int kk=0; kk<DNDZ_CUMUL_GLN; kk++)
+            {
+                double z, w;
+                SAFEGSL(gsl_integration_glfixed_point(a, b, kk, &z, &w, t));
+                double chi;
+                SAFEHMPDF(bg_table_eval(chi_interp, z, &chi));
+                double n = d->n->dndz(z, dndz_params);
+                A += w * n;
+                B += w * n / chi;
+            }
+        }
+
+        double chi_z = d->c->comoving[z_index];
+        out[z_index] = 4.0*M_PI*GNEWTON*chi_z
+                       /gsl_pow_2(SPEEDOFLIGHT)/(1.0 + d->n->zgrid[z_index])
+                       * GSL_MAX(0.0, A - chi_z * B) / norm;
+        hi = lo;
+    }
+
+    gsl_integration_glfixed_table_free(t);
+    if (chi_interp != NULL) { delete_interp1d(chi_interp); }
+    free(chi_z);
+    free(chi_chi);
+    free(order);
+
+    ENDFCT
+}//}}}
+
+static int
+source_invScrit(hmpdf_obj *d, bg_ws *bg, double zs, void *dndz_params, double *out)
+// inverse critical surface density for a single source bin
+{//{{{
+    STARTFCT
+
+    if (d->n->dndz != NULL)
+    // non-trivial source distribution
+    {
+        // allocate some integration resources
+        gsl_integration_workspace *ws;
+        SAFEALLOC(ws, gsl_integration_workspace_alloc(DNDZ_INTEGR_LIMIT));
+        gsl_function F;
+
+        // first figure out the normalization
+        double norm, err;
+        F.function = d->n->dndz;
+        F.params = dndz_params;
+        SAFEGSL(gsl_integration_qag(&F, 0.0, zs,
+                                    0.0, DNDZ_INTEGR_EPSREL,
+                                    DNDZ_INTEGR_LIMIT, DNDZ_INTEGR_KEY, ws,
+                                    &norm, &err));
+
+        // now compute the critical surface densities
+        SAFEHMPDF(lensing_efficiency(d, bg, zs, dndz_params, norm, out));
+
+        // clean up
+        gsl_integration_workspace_free(ws);
+    }
+    else
+    // Dirac delta source distribution
+    {
+        // find distances to source position
+        double chi_s, dA_s;
+        SAFEHMPDF(background_at_z(d, bg, zs,
+                                  NULL, &chi_s, &dA_s, NULL, NULL));
+        // fill the Scrit grid
+        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        {
+            out[z_index] = 4.0*M_PI*GNEWTON/gsl_pow_2(SPEEDOFLIGHT)/(1.0+zs)
+                           * GSL_MAX(0.0, chi_s - d->c->comoving[z_index])
+                           * d->c->angular_diameter[z_index]
+                           / dA_s;
+        }
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+source_bins_invScrit(hmpdf_obj *d, bg_ws *bg)
+// fills invScrit_bins and sets invScrit to their maximum,
+//     which is what the profiles are computed with
+//     (so the integration tolerances are appropriate for all bins)
+{//{{{
+    STARTFCT
+
+    for (int bin=0; bin<d->n->source_N; bin++)
+    {
+        SAFEHMPDF(source_invScrit(d, bg, d->n->source_z[bin],
+                                  (d->n->source_dndz_params == NULL) ?
+                                  d->n->dndz_params
+                                  : d->n->source_dndz_params[bin],
+                                  d->c->invScrit_bins + bin*d->n->Nz));
+    }
+
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
+        d->c->invScrit[z_index] = 0.0;
+        for (int bin=0; bin<d->n->source_N; bin++)
+        {
+            d->c->invScrit[z_index] = GSL_MAX(d->c->invScrit[z_index],
+                                              d->c->invScrit_bins[bin*d->n->Nz+z_index]);
+        }
+    }
+
+    // if a redshift is behind one of the sources, we cannot normalize the
+    //     profiles to zero since we would lose them for the other bins
+    for (int ii=0; ii<d->n->source_N*d->n->Nz; ii++)
+    {
+        d->c->invScrit_bins[ii] = GSL_MAX(d->c->invScrit_bins[ii],
+                                          SOURCE_ZERO_SCALE
+                                          * d->c->invScrit[ii%d->n->Nz]);
+    }
+
+    ENDFCT
+}//}}}
 
 static int
 fill_background(hmpdf_obj *d)
@@ -123,37 +372,46 @@ fill_background(hmpdf_obj *d)
 
     HMPDFPRINT(2, "\tfill_background\n");
 
-    double tau; // conformal time in Mpc
-    int index = 0; // some internal CLASS thing
-
-    struct background *ba = (struct background *)d->cls->ba;
+    if (d->cls->from_cache)
+    {
+        SAFEHMPDF(class_cache_background(d));
+        return 0;
+    }
 
-    double *pvecback;
-    SAFEALLOC(pvecback, malloc(ba->bg_size * sizeof(double)));
     // get z=0 numbers
-    d->c->h = ba->h;
+    double H0;
+    if (d->cls->use_tables)
+    {
+        d->c->h = d->cls->h;
+        H0 = d->cls->h / SPEEDOFLIGHT; // 1/Mpc
+        d->c->Om_0 = d->cls->Om_0;
+        d->c->Ob_0 = d->cls->Ob_0;
+    }
+    else
+    {
+        struct background *ba = (struct background *)d->cls->ba;
+        d->c->h = ba->h;
+        H0 = ba->H0;
+        d->c->Om_0 = ba->Omega0_m;
+        d->c->Ob_0 = ba->Omega0_b;
+    }
     d->c->rho_c_0 = 3.0 * gsl_pow_2(SPEEDOFLIGHT) / 8.0 / M_PI / GNEWTON
-                    * gsl_pow_2(ba->H0);
-    d->c->Om_0 = ba->Omega0_m;
+                    * gsl_pow_2(H0);
     d->c->rho_m_0 = d->c->Om_0 * d->c->rho_c_0;
-    d->c->Ob_0 = ba->Omega0_b;
+
+    bg_ws *bg;
+    SAFEHMPDF(new_bg_ws(d, &bg));
 
     // get background
     for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
-        // get conformal time at given redshift
-        SAFECLASS(background_tau_of_z(ba, d->n->zgrid[z_index], &tau),
-                  ba->error_message);
-        // write interpolated background quantities into pvecback
-        SAFECLASS(background_at_tau(ba, tau, long_info,
-                                    inter_normal, &index, pvecback),
-                  ba->error_message);
-
-        d->c->hubble[z_index] = pvecback[ba->index_bg_H]; // 1/Mpc
-        d->c->comoving[z_index] = pvecback[ba->index_bg_conf_distance]; // Mpc
-        d->c->angular_diameter[z_index] = pvecback[ba->index_bg_ang_distance]; // Mpc, physical
-        d->c->Dsq[z_index] = gsl_pow_2(pvecback[ba->index_bg_D]); // squared growth factor
-        d->c->Om[z_index] = pvecback[ba->index_bg_Omega_m];
+        double D;
+        SAFEHMPDF(background_at_z(d, bg, d->n->zgrid[z_index],
+                                  d->c->hubble+z_index, // 1/Mpc
+                                  d->c->comoving+z_index, // Mpc
+                                  d->c->angular_diameter+z_index, // Mpc, physical
+                                  &D, d->c->Om+z_index));
+        d->c->Dsq[z_index] = gsl_pow_2(D); // squared growth factor
         d->c->rho_c[z_index] = 3.0 * gsl_pow_2(SPEEDOFLIGHT) / 8.0 / M_PI / GNEWTON
                                * gsl_pow_2(d->c->hubble[z_index]);
         d->c->rho_m[z_index] = d->c->Om[z_index] * d->c->rho_c[z_index];
@@ -161,72 +419,18 @@ fill_background(hmpdf_obj *d)
 
     if (d->p->stype == hmpdf_kappa) // need to compute critical surface density
     {
-        if (d->n->dndz != NULL)
-        // non-trivial source distribution
+        if (d->n->source_N)
         {
-            // allocate some integration resources
-            gsl_integration_workspace *ws;
-            SAFEALLOC(ws, gsl_integration_workspace_alloc(DNDZ_INTEGR_LIMIT));
-            gsl_function F;
-
-            // first figure out the normalization
-            double norm, err;
-            F.function = d->n->dndz;
-            F.params = d->n->dndz_params;
-            SAFEGSL(gsl_integration_qag(&F, 0.0, d->n->zsource,
-                                        0.0, DNDZ_INTEGR_EPSREL,
-                                        DNDZ_INTEGR_LIMIT, DNDZ_INTEGR_KEY, ws,
-                                        &norm, &err));
-
-            // prepare our integration struct
-            dndz_integr_params p = { .ba=ba, .pvecback=pvecback, .index=0,
-                                     .dndz=d->n->dndz, .dndz_params=d->n->dndz_params,
-                                     .status=0 };
-            F.function = dndz_integr_f;
-            F.params = &p;
-
-            // now compute the critical surface densities
-            for (int z_index=0; z_index<d->n->Nz; z_index++)
-            {
-                p.chi_z = d->c->comoving[z_index];
-                double out;
-                SAFEGSL(gsl_integration_qag(&F, d->n->zgrid[z_index], d->n->zsource,
-                                            DNDZ_INTEGR_EPSABS*norm, DNDZ_INTEGR_EPSREL,
-                                            DNDZ_INTEGR_LIMIT, DNDZ_INTEGR_KEY, ws,
-                                            &out, &err));
-
-                HMPDFCHECK(p.status, "error encountered during integration");
-
-                d->c->invScrit[z_index] = 4.0*M_PI*GNEWTON*p.chi_z
-                                          /gsl_pow_2(SPEEDOFLIGHT)/(1.0 + d->n->zgrid[z_index])
-                                          * out / norm;
-            }
-            
-            // clean up
-            gsl_integration_workspace_free(ws);
+            SAFEHMPDF(source_bins_invScrit(d, bg));
         }
         else
-        // Dirac delta source distribution
         {
-            // find distances to source position
-            SAFECLASS(background_tau_of_z(ba, d->n->zsource, &tau),
-                      ba->error_message);
-            SAFECLASS(background_at_tau(ba, tau, long_info,
-                                        inter_normal, &index, pvecback),
-                      ba->error_message);
-            double chi_s = pvecback[ba->index_bg_conf_distance];
-            double dA_s = pvecback[ba->index_bg_ang_distance];
-            // fill the Scrit grid
-            for (int z_index=0; z_index<d->n->Nz; z_index++)
-            {
-                d->c->invScrit[z_index] = 4.0*M_PI*GNEWTON/gsl_pow_2(SPEEDOFLIGHT)/(1.0+d->n->zsource)
-                                          * (chi_s - d->c->comoving[z_index]) * d->c->angular_diameter[z_index]
-                                          / dA_s;
-            }
+            SAFEHMPDF(source_invScrit(d, bg, d->n->zsource, d->n->dndz_params,
+                                      d->c->invScrit));
         }
-    } // if kappa
+    }
 
-    free(pvecback);
+    delete_bg_ws(bg);
 
     ENDFCT
 }//}}}
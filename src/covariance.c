@@ -310,7 +310,9 @@ create_phigrid(hmpdf_obj *d)
 {//{{{
     STARTFCT
 
-    if (d->cov->created_phigrid) { return 0; }
+    // the grid is stored with the numerics and does not depend on the source bin,
+    //     so it is kept when this module is reset
+    if (d->cov->created_phigrid || d->n->phigrid != NULL) { return 0; }
 
     HMPDFPRINT(2, "\tcreate_phigrid\n");
 
@@ -416,11 +418,21 @@ create_tp_ws(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
+static inline int
+have_noisy_cov(hmpdf_obj *d)
+// the noise is only defined for a single source population,
+//     so there is no noisy cross-bin covariance
+{//{{{
+    return d->ns->have_noise && d->tp->bin2 < 0;
+}//}}}
+
 static int
 corr_diagn(hmpdf_obj *d, twopoint_workspace *ws, double *out)
 {//{{{
     STARTFCT
 
+    double mean2 = (d->tp->bin2 < 0) ? d->op->signalmeanc : d->tp->signalmeanc2;
+
     *out = 0.0;
     for (long ii=0; ii<d->n->Nsignal; ii++)
     {
@@ -429,7 +441,7 @@ corr_diagn(hmpdf_obj *d, twopoint_workspace *ws, double *out)
             // assumes pdf_real to be properly normalized!
             *out += ws->pdf_real[ii*(d->n->Nsignal+2)+jj]
                     * (d->n->signalgrid[ii] - d->op->signalmeanc)
-                    * (d->n->signalgrid[jj] - d->op->signalmeanc);
+                    * (d->n->signalgrid[jj] - mean2);
         }
     }
 
@@ -483,7 +495,7 @@ add_tp_to_cov(hmpdf_obj *d, int phiindex)
         }
     }
 
-    if (d->ns->have_noise)
+    if (have_noisy_cov(d))
     {
         // add to noisy covariance matrix
         for (long ii=0; ii<d->n->Nsignal_noisy; ii++)
@@ -515,16 +527,19 @@ subtract_op_from_cov(hmpdf_obj *d)
         weight_sum += d->n->phiweights[pp];
     }
 
+    // the second pixel can be in another source bin
+    double *PDFc2 = (d->tp->bin2 < 0) ? d->op->PDFc : d->tp->PDFc2;
+
     for (long ii=0; ii<d->n->Nsignal; ii++)
     {
         for (long jj=0; jj<d->n->Nsignal; jj++)
         {
             d->cov->Cov[ii*d->n->Nsignal+jj]
-                -= weight_sum * d->op->PDFc[ii] * d->op->PDFc[jj];
+                -= weight_sum * d->op->PDFc[ii] * PDFc2[jj];
         }
     }
 
-    if (d->ns->have_noise)
+    if (have_noisy_cov(d))
     {
         for (long ii=0; ii<d->n->Nsignal_noisy; ii++)
         {
@@ -552,7 +567,7 @@ create_cov(hmpdf_obj *d)
     SAFEALLOC(d->cov->Cov, malloc(d->n->Nsignal
                                   * d->n->Nsignal
                                   * sizeof(double)));
-    if (d->ns->have_noise)
+    if (have_noisy_cov(d))
     {
         SAFEALLOC(d->cov->Cov_noisy, malloc(d->n->Nsignal_noisy
                                             * d->n->Nsignal_noisy
@@ -562,7 +577,7 @@ create_cov(hmpdf_obj *d)
 
     // zero covariance
     zero_real(d->n->Nsignal * d->n->Nsignal, d->cov->Cov);
-    if (d->ns->have_noise)
+    if (have_noisy_cov(d))
     {
         zero_real(d->n->Nsignal_noisy * d->n->Nsignal_noisy,
                   d->cov->Cov_noisy);
@@ -586,7 +601,7 @@ create_cov(hmpdf_obj *d)
         CONTINUE_IF_ERR
 
         // compute noisy two-point PDF if necessary
-        if (d->ns->have_noise)
+        if (have_noisy_cov(d))
         {
             SAFEHMPDF_NORETURN(noise_matr(d, d->cov->ws[THIS_THREAD]->pdf_real,
                                           NULL/*no separate output allocated*/,
@@ -624,6 +639,21 @@ create_cov(hmpdf_obj *d)
         CONTINUE_IF_ERR
     }
 
+    if (d->tp->bin2 >= 0)
+    // for different source bins, the zero-separation term is the joint PDF in a single pixel
+    //     (for the same one, it is the shot noise added to the diagonal after binning)
+    {
+        SAFEHMPDF(create_tp(d, 0.0, d->cov->ws[0]));
+        for (long ii=0; ii<d->n->Nsignal; ii++)
+        {
+            for (long jj=0; jj<d->n->Nsignal; jj++)
+            {
+                d->cov->Cov[ii*d->n->Nsignal+jj]
+                    += d->cov->ws[0]->pdf_real[ii*(d->n->Nsignal+2)+jj];
+            }
+        }
+    }
+
     // subtract the one-point outer product
     SAFEHMPDF(subtract_op_from_cov(d));
 
@@ -650,7 +680,7 @@ prepare_cov(hmpdf_obj *d)
 
     SAFEHMPDF(create_op(d));
 
-    if (d->ns->have_noise)
+    if (have_noisy_cov(d))
     {
         SAFEHMPDF(create_noisy_op(d));
         SAFEHMPDF(create_noise_matr_conv(d, d->Ncores));
@@ -678,6 +708,8 @@ hmpdf_get_cov(hmpdf_obj *d, int Nbins, double binedges[Nbins+1], double cov[Nbin
 
     SAFEHMPDF(pdf_check_user_input(d, Nbins, binedges, noisy));
 
+    SAFEHMPDF(select_tp_bin2(d, -1));
+
     // perform the computation
     SAFEHMPDF(prepare_cov(d));
 
@@ -704,6 +736,49 @@ hmpdf_get_cov(hmpdf_obj *d, int Nbins, double binedges[Nbins+1], double cov[Nbin
     ENDFCT
 }//}}}
 
+int
+hmpdf_get_cov_cross(hmpdf_obj *d, int bin2, int Nbins, double binedges[Nbins+1], double cov[Nbins*Nbins])
+{//{{{
+    STARTFCT
+
+    CHECKINIT;
+
+    HMPDFCHECK(d->n->source_N == 0,
+               "hmpdf_get_cov_cross requires hmpdf_source_N to be passed");
+    HMPDFCHECK(bin2 < 0 || bin2 >= d->n->source_N,
+               "source bin %d out of range [0, %d)", bin2, d->n->source_N);
+
+    if (bin2 == d->n->source_bin)
+    // this is the usual covariance matrix
+    {
+        SAFEHMPDF(hmpdf_get_cov(d, Nbins, binedges, cov, 0));
+        return 0;
+    }
+
+    SAFEHMPDF(pdf_check_user_input(d, Nbins, binedges, 0));
+
+    SAFEHMPDF(select_tp_bin2(d, bin2));
+
+    // perform the computation
+    SAFEHMPDF(prepare_cov(d));
+
+    double _binedges1[Nbins+1];
+    double _binedges2[Nbins+1];
+    SAFEHMPDF(pdf_adjust_binedges(d, Nbins, binedges, _binedges1, d->op->signalmeanc));
+    SAFEHMPDF(pdf_adjust_binedges(d, Nbins, binedges, _binedges2, d->tp->signalmeanc2));
+
+    // perform the binning
+    //     (the zero-separation term is already included)
+    HMPDFPRINT(3, "\t\tbinning the covariance matrix\n");
+    SAFEHMPDF(bin_2d_asym(d->n->Nsignal, d->n->signalgrid, d->cov->Cov,
+                          COVINTEGR_N, Nbins, _binedges1, _binedges2, cov, TPINTERP_TYPE));
+
+    // normalize properly
+    SAFEHMPDF(rescale_to_fsky1(d, Nbins, cov));
+
+    ENDFCT
+}//}}}
+
 int
 _get_Nphi(hmpdf_obj *d, int *Nphi)
 {//{{{
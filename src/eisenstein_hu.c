@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_integration.h>
+
+#include "configs.h"
+#include "utils.h"
+#include "object.h"
+#include "class_interface.h"
+#include "eisenstein_hu.h"
+
+#include "hmpdf.h"
+
+typedef struct
+{//{{{
+    double h;
+    double Om;
+    double Or;
+    double OL;
+    double fb; // baryon fraction
+
+    // fit quantities, all lengths in Mpc
+    double k_equality;
+    double sound_horizon;
+    double k_silk;
+    double alpha_c;
+    double beta_c;
+    double alpha_b;
+    double beta_b;
+    double beta_node;
+}//}}}
+EH98_t;
+
+static void
+EH98_setup(double *p, EH98_t *eh)
+// transcribed from Eisenstein & Hu 1998 (tf_fit.c)
+{//{{{
+    eh->h = p[hmpdf_EH98_h];
+    eh->Om = p[hmpdf_EH98_Omega_m];
+    eh->fb = p[hmpdf_EH98_Omega_b] / eh->Om;
+
+    double theta = p[hmpdf_EH98_T_cmb] / 2.7;
+    double omhh = eh->Om * gsl_pow_2(eh->h);
+    double obhh = omhh * eh->fb;
+
+    eh->Or = EH98_ORH2 * gsl_pow_4(p[hmpdf_EH98_T_cmb]/2.7255) / gsl_pow_2(eh->h);
+    eh->OL = 1.0 - eh->Om - eh->Or;
+
+    double z_equality = 2.50e4 * omhh / gsl_pow_4(theta);
+    eh->k_equality = 0.0746 * omhh / gsl_pow_2(theta);
+
+    double z_drag_b1 = 0.313 * pow(omhh, -0.419) * (1.0 + 0.607*pow(omhh, 0.674));
+    double z_drag_b2 = 0.238 * pow(omhh, 0.223);
+    double z_drag = 1291.0 * pow(omhh, 0.251) / (1.0 + 0.659*pow(omhh, 0.828))
+                    * (1.0 + z_drag_b1*pow(obhh, z_drag_b2));
+
+    double R_drag = 31.5 * obhh / gsl_pow_4(theta) * (1000.0/(1.0+z_drag));
+    double R_equality = 31.5 * obhh / gsl_pow_4(theta) * (1000.0/z_equality);
+
+    eh->sound_horizon = 2.0/3.0/eh->k_equality * sqrt(6.0/R_equality)
+                        * log((sqrt(1.0+R_drag) + sqrt(R_drag+R_equality))
+                              / (1.0+sqrt(R_equality)));
+
+    eh->k_silk = 1.6 * pow(obhh, 0.52) * pow(omhh, 0.73)
+                 * (1.0 + pow(10.4*omhh, -0.95));
+
+    double alpha_c_a1 = pow(46.9*omhh, 0.670) * (1.0 + pow(32.1*omhh, -0.532));
+    double alpha_c_a2 = pow(12.0*omhh, 0.424) * (1.0 + pow(45.0*omhh, -0.582));
+    eh->alpha_c = pow(alpha_c_a1, -eh->fb) * pow(alpha_c_a2, -gsl_pow_3(eh->fb));
+
+    double beta_c_b1 = 0.944 / (1.0 + pow(458.0*omhh, -0.708));
+    double beta_c_b2 = pow(0.395*omhh, -0.0266);
+    eh->beta_c = 1.0 / (1.0 + beta_c_b1*(pow(1.0-eh->fb, beta_c_b2) - 1.0));
+
+    double y = z_equality / (1.0 + z_drag);
+    double alpha_b_G = y * (-6.0*sqrt(1.0+y)
+                            + (2.0+3.0*y) * log((sqrt(1.0+y)+1.0)/(sqrt(1.0+y)-1.0)));
+    eh->alpha_b = 2.07 * eh->k_equality * eh->sound_horizon
+                  * pow(1.0+R_drag, -0.75) * alpha_b_G;
+
+    eh->beta_node = 8.41 * pow(omhh, 0.435);
+    eh->beta_b = 0.5 + eh->fb + (3.0-2.0*eh->fb) * sqrt(gsl_pow_2(17.2*omhh) + 1.0);
+}//}}}
+
+static double
+EH98_transfer(EH98_t *eh, double k)
+// k in 1/Mpc
+{//{{{
+    double q = k / 13.41 / eh->k_equality;
+    double xx = k * eh->sound_horizon;
+
+    double T_c_ln_beta = log(M_E + 1.8*eh->beta_c*q);
+    double T_c_ln_nobeta = log(M_E + 1.8*q);
+    double T_c_C_alpha = 14.2/eh->alpha_c + 386.0/(1.0+69.9*pow(q, 1.08));
+    double T_c_C_noalpha = 14.2 + 386.0/(1.0+69.9*pow(q, 1.08));
+
+    double T_c_f = 1.0 / (1.0 + gsl_pow_4(xx/5.4));
+    double T_c = T_c_f * T_c_ln_beta / (T_c_ln_beta + T_c_C_noalpha*gsl_pow_2(q))
+                 + (1.0-T_c_f) * T_c_ln_beta / (T_c_ln_beta + T_c_C_alpha*gsl_pow_2(q));
+
+    double s_tilde = eh->sound_horizon / cbrt(1.0 + gsl_pow_3(eh->beta_node/xx));
+    double xx_tilde = k * s_tilde;
+
+    double T_b_T0 = T_c_ln_nobeta / (T_c_ln_nobeta + T_c_C_noalpha*gsl_pow_2(q));
+    double T_b = sin(xx_tilde) / xx_tilde
+                 * (T_b_T0 / (1.0 + gsl_pow_2(xx/5.2))
+                    + eh->alpha_b / (1.0 + gsl_pow_3(eh->beta_b/xx))
+                      * exp(-pow(k/eh->k_silk, 1.4)));
+
+    return eh->fb * T_b + (1.0-eh->fb) * T_c;
+}//}}}
+
+static inline double
+EH98_E(EH98_t *eh, double z)
+// H(z)/H0
+{//{{{
+    return sqrt(eh->Om*gsl_pow_3(1.0+z) + eh->Or*gsl_pow_4(1.0+z) + eh->OL);
+}//}}}
+
+static inline double
+growth_integrand(EH98_t *eh, double x)
+// the growth integral int_0^a da'/(a'E(a'))^3,
+//     with a = x^2 to remove the sqrt behaviour at a -> 0.
+//     Radiation is neglected here, so the integral solution is exact.
+{//{{{
+    return 2.0 * gsl_pow_4(x)
+           / gsl_pow_3(sqrt(eh->Om + (1.0-eh->Om)*gsl_pow_6(x)));
+}//}}}
+
+static int
+EH98_background(hmpdf_obj *d, EH98_t *eh)
+{//{{{
+    STARTFCT
+
+    class_interface_t *c = d->cls;
+
+    double zmax = d->n->zmax;
+    if (d->p->stype == hmpdf_kappa) { zmax = GSL_MAX(zmax, d->n->zsource); }
+
+    c->bg_N = EH98_NZ;
+    SAFEALLOC(c->bg_buf, malloc(4 * c->bg_N * sizeof(double)));
+    c->bg_z   = c->bg_buf;
+    c->bg_H   = c->bg_buf + c->bg_N;
+    c->bg_chi = c->bg_buf + 2*c->bg_N;
+    c->bg_D   = c->bg_buf + 3*c->bg_N;
+
+    for (int ii=0; ii<c->bg_N; ii++)
+    {
+        c->bg_z[ii] = expm1((double)ii * log1p(zmax) / (double)(c->bg_N-1));
+    }
+    c->bg_z[c->bg_N-1] = zmax; // make sure roundoff doesn't leave zmax uncovered
+
+    gsl_integration_glfixed_table *t;
+    SAFEALLOC(t, gsl_integration_glfixed_table_alloc(EH98_GLN));
+
+    // comoving distance, integrating upwards from z=0
+    c->bg_chi[0] = 0.0;
+    for (int ii=0; ii<c->bg_N; ii++)
+    {
+        c->bg_H[ii] = eh->h / SPEEDOFLIGHT * EH98_E(eh, c->bg_z[ii]);
+        if (ii == 0) { continue; }
+        double integr = 0.0;
+        for (int jj=0; jj<EH98_GLN; jj++)
+        {
+            double z, w;
+            SAFEGSL(gsl_integration_glfixed_point(c->bg_z[ii-1], c->bg_z[ii],
+                                                  jj, &z, &w, t));
+            integr += w / EH98_E(eh, z);
+        }
+        c->bg_chi[ii] = c->bg_chi[ii-1] + SPEEDOFLIGHT / eh->h * integr;
+    }
+
+    // growth integral, integrating downwards in z from a=0
+    double integr = 0.0;
+    double x_lo = 0.0;
+    for (int ii=c->bg_N-1; ii>=0; ii--)
+    {
+        double x_hi = 1.0 / sqrt(1.0 + c->bg_z[ii]);
+        for (int jj=0; jj<EH98_GLN; jj++)
+        {
+            double x, w;
+            SAFEGSL(gsl_integration_glfixed_point(x_lo, x_hi, jj, &x, &w, t));
+            integr += w * growth_integrand(eh, x);
+        }
+        double a = gsl_pow_2(x_hi);
+        // D ~ E(a) * I(a), store unnormalized for now
+        c->bg_D[ii] = sqrt(eh->Om/gsl_pow_3(a) + 1.0 - eh->Om) * integr;
+        x_lo = x_hi;
+    }
+    // z=0 is the first entry
+    for (int ii=c->bg_N-1; ii>=0; ii--)
+    {
+        c->bg_D[ii] /= c->bg_D[0];
+    }
+
+    gsl_integration_glfixed_table_free(t);
+
+    ENDFCT
+}//}}}
+
+static double
+tophat_W(double x)
+{//{{{
+    if (x < 1e-2)
+    {
+        return 1.0 - gsl_pow_2(x)/10.0;
+    }
+    return 3.0 * (sin(x) - x*cos(x)) / gsl_pow_3(x);
+}//}}}
+
+static int
+EH98_power(hmpdf_obj *d, EH98_t *eh)
+{//{{{
+    STARTFCT
+
+    class_interface_t *c = d->cls;
+    double *p = c->EH98_params;
+
+    c->Pk_N = EH98_NK;
+    SAFEALLOC(c->Pk_buf, malloc(2 * c->Pk_N * sizeof(double)));
+    c->Pk_k = c->Pk_buf;
+    c->Pk_P = c->Pk_buf + c->Pk_N;
+
+    double dlnk = log(EH98_KMAX/EH98_KMIN) / (double)(c->Pk_N-1);
+    double R8 = 8.0 / eh->h; // Mpc
+
+    // unnormalized spectrum and sigma8 (trapezoidal rule in log(k))
+    double ssq8 = 0.0;
+    for (int ii=0; ii<c->Pk_N; ii++)
+    {
+        double k = EH98_KMIN * exp((double)ii * dlnk);
+        c->Pk_k[ii] = k;
+        c->Pk_P[ii] = pow(k, p[hmpdf_EH98_n_s]) * gsl_pow_2(EH98_transfer(eh, k));
+        double integrand = gsl_pow_3(k) * c->Pk_P[ii] * gsl_pow_2(tophat_W(k*R8));
+        ssq8 += (ii == 0 || ii == c->Pk_N-1) ? 0.5*integrand : integrand;
+    }
+    ssq8 *= dlnk / 2.0 / M_PI / M_PI;
+
+    double norm = gsl_pow_2(p[hmpdf_EH98_sigma8]) / ssq8;
+    for (int ii=0; ii<c->Pk_N; ii++)
+    {
+        c->Pk_P[ii] *= norm;
+    }
+
+    ENDFCT
+}//}}}
+
+int
+EH98_tables(hmpdf_obj *d)
+// fills the cosmology tables in the class interface,
+//     they are then used in the same way as user-supplied tables
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\tEH98_tables\n");
+
+    double *p = d->cls->EH98_params;
+    HMPDFCHECK(p[hmpdf_EH98_h] <= 0.0 || p[hmpdf_EH98_Omega_m] <= 0.0
+               || p[hmpdf_EH98_Omega_b] <= 0.0
+               || p[hmpdf_EH98_Omega_b] >= p[hmpdf_EH98_Omega_m]
+               || p[hmpdf_EH98_sigma8] <= 0.0 || p[hmpdf_EH98_T_cmb] <= 0.0,
+               "invalid hmpdf_EH98_params");
+
+    EH98_t eh;
+    EH98_setup(p, &eh);
+
+    d->cls->h = eh.h;
+    d->cls->Om_0 = p[hmpdf_EH98_Omega_m];
+    d->cls->Ob_0 = p[hmpdf_EH98_Omega_b];
+
+    SAFEHMPDF(EH98_background(d, &eh));
+    SAFEHMPDF(EH98_power(d, &eh));
+
+    ENDFCT
+}//}}}
@@ -405,6 +405,27 @@ apply_filters(hmpdf_obj *d, int N, double *ell, double *in, double *out,
     ENDFCT
 }//}}}
 
+int
+apply_pixelfilter(hmpdf_obj *d, int N, double *ell, double *in, double *out)
+// applies only the pixel window function (in the pdf mode)
+// NOTE : function is safe if in and out point to same memory
+{//{{{
+    STARTFCT
+
+    HMPDFCHECK(d->f->pixelfilter_idx < 0,
+               "no pixel window function available.");
+
+    for (int jj=0; jj<N; jj++)
+    {
+        double temp;
+        SAFEHMPDF(filter_quadraticpixel((void *)d, ell[jj], filter_pdf,
+                                        NULL, &temp));
+        out[jj] = in[jj] * temp;
+    }
+
+    ENDFCT
+}//}}}
+
 int
 apply_filters_map(hmpdf_obj *d, long N, double *ell, double complex *in, double complex *out,
                   int *z_index)
@@ -472,8 +493,23 @@ init_filters(hmpdf_obj *d)
                   malloc(2 * sizeof(double)));
         SAFEALLOC(d->f->quadraticpixel_ellmax,
                   malloc(2 * sizeof(double)));
-        SAFEHMPDF(create_quadraticpixelinterp(d, filter_pdf));
-        SAFEHMPDF(create_quadraticpixelinterp(d, filter_ps));
+        // the two tabulations are independent.
+        //     If we are inside the task graph of hmpdf_init,
+        //     they run concurrently, otherwise the tasks are executed immediately
+        int status_pdf = 0, status_ps = 0;
+        #ifdef _OPENMP
+        #   pragma omp task shared(status_pdf)
+        #endif
+        status_pdf = create_quadraticpixelinterp(d, filter_pdf);
+        #ifdef _OPENMP
+        #   pragma omp task shared(status_ps)
+        #endif
+        status_ps = create_quadraticpixelinterp(d, filter_ps);
+        #ifdef _OPENMP
+        #   pragma omp taskwait
+        #endif
+        SAFEHMPDF(status_pdf);
+        SAFEHMPDF(status_ps);
         d->f->ffilters[d->f->Nfilters] = &filter_quadraticpixel;
         d->f->z_dependent[d->f->Nfilters] = 0;
         d->f->pixelfilter_idx = d->f->Nfilters;
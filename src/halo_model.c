@@ -271,6 +271,19 @@ Mconv(hmpdf_obj *d, int z_index, int M_index, hmpdf_mdef_e mdef_out,
     ENDFCT
 }//}}}
 
+typedef struct
+// redshift-dependent parameters of the Tinker+2010 mass function,
+//     in the form needed for
+//     f(nu) = alpha * (1 + beta^(-2phi) nu^(-2phi)) * nu^(1+2eta) * exp(-gamma nu^2 / 2)
+{//{{{
+    double alpha;
+    double beta_m2phi; // beta^(-2phi)
+    double m2phi;      // -2phi
+    double p2eta;      // 1+2eta
+    double gamma;
+}//}}}
+Tinker10_z_t;
+
 static inline double
 fnu_Tinker10_primitive(hmpdf_obj *d, int n, double z)
 {//{{{
@@ -278,8 +291,8 @@ fnu_Tinker10_primitive(hmpdf_obj *d, int n, double z)
            *pow(1.0+z, d->h->Tinker10_params[n*2 + 1]);
 }//}}}
 
-static double
-fnu_Tinker10(hmpdf_obj *d, double nu, double z)
+static void
+fnu_Tinker10_params(hmpdf_obj *d, double z, Tinker10_z_t *out)
 {//{{{
     z = (z<3.0) ? z : 3.0;
     double beta  = fnu_Tinker10_primitive(d, 0, z);
@@ -287,74 +300,67 @@ fnu_Tinker10(hmpdf_obj *d, double nu, double z)
     double eta   = fnu_Tinker10_primitive(d, 2, z);
     double gamma = fnu_Tinker10_primitive(d, 3, z);
     double alpha = fnu_Tinker10_primitive(d, 4, z);
-    return nu * alpha*(1.0+pow(beta*nu, -2.0*phi))
-           * pow(nu, 2.0*eta) * exp(-0.5*gamma*gsl_pow_2(nu));
+    out->alpha = alpha;
+    out->beta_m2phi = pow(beta, -2.0*phi);
+    out->m2phi = -2.0*phi;
+    out->p2eta = 1.0+2.0*eta;
+    out->gamma = gamma;
 }//}}}
 
-static double
-bnu_Tinker10(double nu)
+typedef struct
+// b(nu) = 1 - A nu^a / (nu^a + 1.686^a) + B nu^b + C nu^c
 {//{{{
-    double y = 2.0 + M_LN2/M_LN10; // y = log_10(200)
-    double A = 1.0 + 0.24 * y * exp(-gsl_pow_4(4.0/y));
-    double a = 0.44 * y - 0.88;
-    double B = 0.183;
-    double b = 1.5;
-    double C = 0.019 + 0.107 * y + 0.19 * exp(-gsl_pow_4(4.0/y));
-    double c = 2.4;
-    return 1.0 - A*pow(nu, a)/(pow(nu, a) + pow(1.686, a)) + B*pow(nu, b) + C*pow(nu, c);
+    double A, a, dc_a, B, b, C, c;
 }//}}}
+Tinker10_bias_t;
 
-static int
-dndlogM(hmpdf_obj *d, int z_index, int M_index, double *hmf, double *bias)
+static void
+bnu_Tinker10_params(Tinker10_bias_t *out)
 {//{{{
-    STARTFCT
-
-    // case where we are above the possible mass cut
-    if (d->n->mass_cuts != NULL
-        && d->n->Mgrid[M_index]
-           > d->n->mass_cuts(d->n->zgrid[z_index], d->n->mass_cuts_params)
-             / d->c->h)
-    {
-        *hmf = 0.0;
-        *bias = 0.0;
-    }
-    // we are below the mass cut (or none is given)
-    else
-    {
-        double sigma_squared = d->pwr->ssq[M_index][0];
-        double sigma_squared_prime = d->pwr->ssq[M_index][1];
-        //double nu = 1.686/sqrt(d->c->Dsq[z_index] * sigma_squared);
-	double dc=3.0/20.0*pow(12.0*M_PI,2.0/3.0);
-        double nu=dc/sqrt(d->c->Dsq[z_index]*sigma_squared);
-        double fnu = fnu_Tinker10(d, nu, d->n->zgrid[z_index]);
-
-        #ifdef SAVE_SIGMA_NU
-	FILE *fp = fopen("/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/sigma_nu/hmf_sigma_nu.txt", "a");
-	fprintf(fp, "%.8f %.18e %.18e %.18e\n",d->n->zgrid[z_index], d->n->Mgrid[M_index],sigma_squared*d->c->Dsq[z_index], nu);
-	fclose(fp);
-	#endif
-
-        *hmf = -fnu * d->c->rho_m_0 * sigma_squared_prime
-               / (2.0 * sigma_squared * d->n->Mgrid[M_index]);
+    double y = 2.0 + M_LN2/M_LN10; // y = log_10(200)
+    out->A = 1.0 + 0.24 * y * exp(-gsl_pow_4(4.0/y));
+    out->a = 0.44 * y - 0.88;
+    out->dc_a = pow(1.686, out->a);
+    out->B = 0.183;
+    out->b = 1.5;
+    out->C = 0.019 + 0.107 * y + 0.19 * exp(-gsl_pow_4(4.0/y));
+    out->c = 2.4;
+}//}}}
 
-        *bias = bnu_Tinker10(nu);
+static void
+dndlogM_z(hmpdf_obj *d, int z_index, const Tinker10_bias_t *bp,
+          const double *lnnu_M, const double *pref_M, double Mcut,
+          double *hmf, double *bias)
+// fills one redshift row of the tables, on input hmf and bias contain
+//     the (user-supplied) correction factors.
+// Written without branches or function calls other than exp
+//     so it vectorizes over the mass axis.
+{//{{{
+    Tinker10_z_t tp;
+    fnu_Tinker10_params(d, d->n->zgrid[z_index], &tp);
 
-        if (d->h->massfunc_corr != NULL)
-        {
-            *hmf *= d->h->massfunc_corr(d->n->zgrid[z_index],
-                                        d->n->Mgrid[M_index] * d->c->h,
-                                        d->h->massfunc_corr_params);
-        }
+    //double nu = 1.686/sqrt(d->c->Dsq[z_index] * sigma_squared);
+    double dc = 3.0/20.0*pow(12.0*M_PI,2.0/3.0);
+    double lnnu_z = log(dc) - 0.5 * log(d->c->Dsq[z_index]);
 
-        if (d->h->bias_resc != NULL)
-        {
-            *bias *= d->h->bias_resc(d->n->zgrid[z_index],
-                                     d->n->Mgrid[M_index] * d->c->h,
-                                     d->h->bias_resc_params);
-        }
+    #ifdef _OPENMP
+    #   pragma omp simd
+    #endif
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        double lnnu = lnnu_z + lnnu_M[M_index];
+        double nu = exp(lnnu);
+        double fnu = tp.alpha * (1.0 + tp.beta_m2phi * exp(tp.m2phi * lnnu))
+                     * exp(tp.p2eta * lnnu - 0.5 * tp.gamma * nu * nu);
+        double nu_a = exp(bp->a * lnnu);
+        double b = 1.0 - bp->A * nu_a / (nu_a + bp->dc_a)
+                   + bp->B * exp(bp->b * lnnu) + bp->C * exp(bp->c * lnnu);
+
+        // case where we are above the possible mass cut
+        int cut = d->n->Mgrid[M_index] > Mcut;
+        hmf[M_index] = (cut) ? 0.0 : hmf[M_index] * fnu * pref_M[M_index];
+        bias[M_index] = (cut) ? 0.0 : bias[M_index] * b;
     }
-
-    ENDFCT
 }//}}}
 
 static int
@@ -367,33 +373,96 @@ create_dndlogM(hmpdf_obj *d)
     SAFEALLOC(d->h->hmf,  malloc(d->n->Nz * sizeof(double *)));
     SETARRNULL(d->h->hmf, d->n->Nz);
     SAFEALLOC(d->h->bias, malloc(d->n->Nz * sizeof(double *)));
-    SETARRNULL(d->h->hmf, d->n->Nz);
+    SETARRNULL(d->h->bias, d->n->Nz);
+
+    // mass-only quantities
+    double *lnnu_M;
+    double *pref_M;
+    SAFEALLOC(lnnu_M, malloc(d->n->NM * sizeof(double)));
+    SAFEALLOC(pref_M, malloc(d->n->NM * sizeof(double)));
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        double sigma_squared = d->pwr->ssq[M_index][0];
+        double sigma_squared_prime = d->pwr->ssq[M_index][1];
+        lnnu_M[M_index] = -0.5 * log(sigma_squared);
+        pref_M[M_index] = - d->c->rho_m_0 * sigma_squared_prime
+                          / (2.0 * sigma_squared * d->n->Mgrid[M_index]);
+    }
 
-    #ifdef SAVE_SIGMA_NU
-    FILE *fp = fopen("/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/sigma_nu/hmf_sigma_nu.txt", "w");
-    fclose(fp);
-    #endif
+    Tinker10_bias_t bp;
+    bnu_Tinker10_params(&bp);
 
+    // the user-supplied functions are called serially beforehand,
+    //     so they need not be thread safe
+    double *Mcut;
+    SAFEALLOC(Mcut, malloc(d->n->Nz * sizeof(double)));
     for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
         SAFEALLOC(d->h->hmf[z_index],  malloc(d->n->NM * sizeof(double)));
         SAFEALLOC(d->h->bias[z_index], malloc(d->n->NM * sizeof(double)));
+
+        Mcut[z_index] = (d->n->mass_cuts == NULL) ? HUGE_VAL
+                        : d->n->mass_cuts(d->n->zgrid[z_index], d->n->mass_cuts_params)
+                          / d->c->h;
+
+        for (int M_index=0; M_index<d->n->NM; M_index++)
+        {
+            int cut = d->n->Mgrid[M_index] > Mcut[z_index];
+            d->h->hmf[z_index][M_index]
+                = (d->h->massfunc_corr == NULL || cut) ? 1.0
+                  : d->h->massfunc_corr(d->n->zgrid[z_index],
+                                        d->n->Mgrid[M_index] * d->c->h,
+                                        d->h->massfunc_corr_params);
+            d->h->bias[z_index][M_index]
+                = (d->h->bias_resc == NULL || cut) ? 1.0
+                  : d->h->bias_resc(d->n->zgrid[z_index],
+                                    d->n->Mgrid[M_index] * d->c->h,
+                                    d->h->bias_resc_params);
+        }
+    }
+
+    // we are called from the task graph in hmpdf_init,
+    //     so distribute the redshifts among the idle threads
+    #ifdef _OPENMP
+    #   pragma omp taskloop default(shared) grainsize(1)
+    #endif
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
+        dndlogM_z(d, z_index, &bp, lnnu_M, pref_M, Mcut[z_index],
+                  d->h->hmf[z_index], d->h->bias[z_index]);
+    }
+
+    #ifdef SAVE_SIGMA_NU
+    FILE *fp = fopen("/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/sigma_nu/hmf_sigma_nu.txt", "w");
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
         for (int M_index=0; M_index<d->n->NM; M_index++)
         {
-            SAFEHMPDF(dndlogM(d, z_index, M_index,
-                              d->h->hmf[z_index]+M_index,
-                              d->h->bias[z_index]+M_index));
+            if (d->n->Mgrid[M_index] > Mcut[z_index]) { continue; }
+            double sigma_squared = d->pwr->ssq[M_index][0];
+            double dc = 3.0/20.0*pow(12.0*M_PI,2.0/3.0);
+            double nu = dc/sqrt(d->c->Dsq[z_index]*sigma_squared);
+            fprintf(fp, "%.8f %.18e %.18e %.18e\n",d->n->zgrid[z_index], d->n->Mgrid[M_index],sigma_squared*d->c->Dsq[z_index], nu);
         }
+    }
+    fclose(fp);
+    #endif
 
-	#ifdef SAVE_HMF
+    #ifdef SAVE_HMF
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
 	char buffer[512];
         sprintf(buffer, "/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/hmf/hmf_%.8f.bin", d->n->zgrid[z_index]);
         FILE *fp = fopen(buffer, "w");
 	fwrite(d->n->Mgrid, sizeof(double), d->n->NM, fp);
 	fwrite(d->h->hmf[z_index], sizeof(double), d->n->NM, fp);
 	fclose(fp);
-	#endif
     }
+    #endif
+
+    free(lnnu_M);
+    free(pref_M);
+    free(Mcut);
 
     ENDFCT
 }//}}}
@@ -6,6 +6,7 @@
 #include "configs.h"
 #include "object.h"
 #include "class_interface.h"
+#include "class_cache.h"
 #include "cosmology.h"
 #include "numerics.h"
 #include "power.h"
@@ -32,6 +33,7 @@ typedef enum
     strptr_type, // char **
     dptr_type, // double *
     vptr_type, // void *
+    vptrptr_type, // void **
     lf_type, // hmpdf_ell_filter_f
     kf_type, // hmpdf_k_filter_f
     mf_type, // hmpdf_massfunc_corr_f
@@ -59,6 +61,7 @@ dtype;
             case (mdef_type) : expr(hmpdf_mdef_e); break;          \
             case (integr_type) : expr(hmpdf_integr_mode_e); break; \
             case (vptr_type) : expr(void *); break;                \
+            case (vptrptr_type) : expr(void **); break;            \
             case (lf_type) : expr(hmpdf_ell_filter_f); break;      \
             case (kf_type) : expr(hmpdf_k_filter_f); break;        \
             case (mf_type) : expr(hmpdf_massfunc_corr_f); break;   \
@@ -205,6 +208,58 @@ init_params(hmpdf_obj *d, param *p)
              d->p->rout_scale, dbl_type, def.rout_scale);
     INIT_P_B(hmpdf_rout_rdef,
              d->p->rout_def, mdef_type, def.rout_rdef);
+    INIT_P(hmpdf_tsz_table,
+           d->p->tsz_table, int_type, def.tsz_table);
+    INIT_P(hmpdf_los_fixed_order,
+           d->p->los_fixed_order, int_type, def.los_fixed_order);
+    INIT_P(hmpdf_fftlog,
+           d->p->fftlog, int_type, def.fftlog);
+    INIT_P(hmpdf_profile_cache,
+           d->p->cache_dir, str_type, def.profile_cache);
+    INIT_P(hmpdf_profile_Mstride,
+           d->p->Mstride, int_type, def.profile_Mstride);
+    INIT_P(hmpdf_theta_adaptive,
+           d->p->theta_adaptive, int_type, def.theta_adaptive);
+    INIT_P(hmpdf_bcm_abel,
+           d->p->bcm_abel, int_type, def.bcm_abel);
+    INIT_P(hmpdf_ssq_fftlog,
+           d->pwr->ssq_fftlog, int_type, def.ssq_fftlog);
+    INIT_P(hmpdf_bg_table_N,
+           d->cls->bg_N, int_type, def.bg_table_N);
+    INIT_P(hmpdf_bg_table_z,
+           d->cls->bg_z, dptr_type, def.bg_table_z);
+    INIT_P(hmpdf_bg_table_H,
+           d->cls->bg_H, dptr_type, def.bg_table_H);
+    INIT_P(hmpdf_bg_table_chi,
+           d->cls->bg_chi, dptr_type, def.bg_table_chi);
+    INIT_P(hmpdf_bg_table_D,
+           d->cls->bg_D, dptr_type, def.bg_table_D);
+    INIT_P(hmpdf_bg_table_file,
+           d->cls->bg_file, str_type, def.bg_table_file);
+    INIT_P(hmpdf_Pk_table_N,
+           d->cls->Pk_N, int_type, def.Pk_table_N);
+    INIT_P(hmpdf_Pk_table_k,
+           d->cls->Pk_k, dptr_type, def.Pk_table_k);
+    INIT_P(hmpdf_Pk_table_P,
+           d->cls->Pk_P, dptr_type, def.Pk_table_P);
+    INIT_P(hmpdf_Pk_table_file,
+           d->cls->Pk_file, str_type, def.Pk_table_file);
+    INIT_P(hmpdf_cosmo_h,
+           d->cls->h, dbl_type, def.cosmo_h);
+    INIT_P(hmpdf_cosmo_Omega_m,
+           d->cls->Om_0, dbl_type, def.cosmo_Omega_m);
+    INIT_P(hmpdf_cosmo_Omega_b,
+           d->cls->Ob_0, dbl_type, def.cosmo_Omega_b);
+    INIT_P(hmpdf_EH98_params,
+           d->cls->EH98_params, dptr_type, def.EH98_params);
+    INIT_P(hmpdf_class_cache,
+           d->cls->cache_dir, str_type, def.class_cache);
+    INIT_P(hmpdf_source_N,
+           d->n->source_N, int_type, def.source_N);
+    INIT_P(hmpdf_source_z,
+           d->n->source_z, dptr_type, def.source_z);
+    INIT_P(hmpdf_source_dndz_params,
+           d->n->source_dndz_params, vptrptr_type, def.source_dndz_params);
     INIT_P_B(hmpdf_pixel_side,
              d->f->pixelside, dbl_type, def.pixel_sidelength);
     INIT_P_B(hmpdf_tophat_radius,
@@ -309,6 +364,16 @@ init_params(hmpdf_obj *d, param *p)
            d->m->mappoisson, int_type, def.mappoisson);
     INIT_P(hmpdf_map_seed,
            d->m->mapseed, int_type, def.mapseed);
+    INIT_P(hmpdf_map_pixelavg,
+           d->m->pixelavg, int_type, def.map_pixelavg);
+    INIT_P_B(hmpdf_map_subpixel_K,
+             d->m->subpixel_K, int_type, def.map_subpixel_K);
+    INIT_P(hmpdf_map_fourier_min_N,
+           d->m->fourier_min_N, int_type, def.map_fourier_min_N);
+    INIT_P(hmpdf_map_catalog_out,
+           d->m->catalog_out, str_type, def.map_catalog_out);
+    INIT_P(hmpdf_map_catalog_in,
+           d->m->catalog_in, str_type, def.map_catalog_in);
     INIT_P(hmpdf_mass_z_fix,
             d->p->mass_z_fix, int_type, def.mass_z_fix_prof);
     INIT_P(hmpdf_min_mass_fix,
@@ -543,6 +608,65 @@ sanity_checks(hmpdf_obj *d)
     HMPDFCHECK(d->n->dndz != NULL && d->p->stype != hmpdf_kappa,
                "dndz does not make sense for a non-WL signal");
 
+    HMPDFCHECK(d->n->source_N && d->p->stype != hmpdf_kappa,
+               "hmpdf_source_N does not make sense for a non-WL signal");
+    HMPDFCHECK(d->n->source_N < 0,
+               "hmpdf_source_N must be non-negative");
+    HMPDFCHECK(d->n->source_N && d->n->source_z == NULL,
+               "hmpdf_source_z must be passed if hmpdf_source_N is non-zero");
+    HMPDFCHECK(d->n->source_dndz_params != NULL && d->n->dndz == NULL,
+               "hmpdf_source_dndz_params requires hmpdf_dndz");
+    for (int bin=0; bin<d->n->source_N; bin++)
+    {
+        HMPDFCHECK(d->n->source_z[bin] <= d->n->zmin
+                   || d->n->source_z[bin] > d->n->zsource,
+                   "Invalid source redshift %g in bin %d, must be in "
+                   "(hmpdf_z_min, source redshift passed to hmpdf_init].",
+                   d->n->source_z[bin], bin);
+    }
+
+    HMPDFCHECK(d->m->catalog_out != NULL && d->m->catalog_in != NULL,
+               "hmpdf_map_catalog_out and hmpdf_map_catalog_in cannot both be passed");
+
+    int bg_table = d->cls->bg_N > 0 || d->cls->bg_file != NULL;
+    int Pk_table = d->cls->Pk_N > 0 || d->cls->Pk_file != NULL;
+    HMPDFCHECK(bg_table != Pk_table,
+               "either none or both of the background and power spectrum tables "
+               "must be passed");
+    HMPDFCHECK(bg_table && d->cls->EH98_params != NULL,
+               "either use cosmology tables or hmpdf_EH98_params");
+    HMPDFCHECK(!bg_table && d->cls->EH98_params == NULL && d->cls->class_ini == NULL,
+               "class_ini can only be NULL if cosmology tables "
+               "or hmpdf_EH98_params are passed");
+
+    ENDFCT
+}//}}}
+
+static int
+select_source_bin(hmpdf_obj *d, int bin)
+// everything downstream of the profiles is computed lazily,
+//     so we simply discard it
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(1, "select_source_bin\n");
+
+    // note that reset_twopoint needs the old segments
+    SAFEHMPDF(reset_onepoint(d));
+    SAFEHMPDF(reset_twopoint(d));
+    SAFEHMPDF(reset_powerspectrum(d));
+    SAFEHMPDF(reset_covariance(d));
+    SAFEHMPDF(reset_maps(d));
+    SAFEHMPDF(null_onepoint(d));
+    SAFEHMPDF(null_twopoint(d));
+    SAFEHMPDF(null_powerspectrum(d));
+    SAFEHMPDF(null_covariance(d));
+    SAFEHMPDF(null_maps(d));
+
+    SAFEHMPDF(rescale_profiles(d, d->c->invScrit_bins + bin*d->n->Nz));
+
+    d->n->source_bin = bin;
+
     ENDFCT
 }//}}}
 
@@ -551,15 +675,79 @@ compute_necessary_for_all(hmpdf_obj *d)
 {//{{{
     STARTFCT
 
+    // CLASS has its own parallel regions, so it does not go into the task graph
     SAFEHMPDF(init_numerics(d));
     SAFEHMPDF(init_class_interface(d));
-    SAFEHMPDF(init_cosmology(d));
-    SAFEHMPDF(init_power(d));
-    SAFEHMPDF(init_halo_model(d));
-    SAFEHMPDF(init_filters(d));
-    SAFEHMPDF(init_bcm(d));
+
+    // the remaining stages (before the profiles) are mostly serial internally,
+    //     so we run the independent ones concurrently.
+    // The status variables double as dependency tokens,
+    //     and a stage is skipped if one of its inputs failed.
+    // Note that none of these stages call the (non-threadsafe) FFTW planner
+    //     concurrently -- only init_power does.
+    int status_cosmo = 0,
+        status_power = 0,
+        status_cache = 0,
+        status_halo = 0,
+        status_bcm = 0,
+        status_filters = 0,
+        status_noise = 0;
+
+    #ifdef _OPENMP
+    #   pragma omp parallel num_threads(d->Ncores)
+    #   pragma omp single
+    #endif
+    {
+        #ifdef _OPENMP
+        #   pragma omp task depend(out:status_cosmo)
+        #endif
+        status_cosmo = init_cosmology(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(in:status_cosmo) depend(out:status_power)
+        #endif
+        status_power = (status_cosmo) ? 1 : init_power(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(in:status_cosmo,status_power) depend(out:status_cache)
+        #endif
+        status_cache = (status_cosmo || status_power) ? 1 : class_cache_save(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(in:status_cosmo,status_power) depend(out:status_halo)
+        #endif
+        status_halo = (status_cosmo || status_power) ? 1 : init_halo_model(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(in:status_cosmo) depend(out:status_bcm)
+        #endif
+        status_bcm = (status_cosmo) ? 1 : init_bcm(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(out:status_filters)
+        #endif
+        status_filters = init_filters(d);
+
+        #ifdef _OPENMP
+        #   pragma omp task depend(in:status_filters) depend(out:status_noise)
+        #endif
+        status_noise = (status_filters) ? 1 : init_noise(d);
+    } // implicit barrier waits for all tasks
+
+    SAFEHMPDF(status_cosmo);
+    SAFEHMPDF(status_power);
+    SAFEHMPDF(status_cache);
+    SAFEHMPDF(status_halo);
+    SAFEHMPDF(status_bcm);
+    SAFEHMPDF(status_filters);
+    SAFEHMPDF(status_noise);
+
     SAFEHMPDF(init_profiles(d));
-    SAFEHMPDF(init_noise(d));
+
+    if (d->n->source_N)
+    {
+        SAFEHMPDF(select_source_bin(d, 0));
+    }
 
     ENDFCT
 }//}}}
@@ -654,3 +842,21 @@ hmpdf_init_fct(hmpdf_obj *d, char *class_ini, hmpdf_signaltype_e stype, ...)
     ENDFCT
 }//}}}
 
+int
+hmpdf_set_source_bin(hmpdf_obj *d, int bin)
+{//{{{
+    STARTFCT
+
+    CHECKINIT;
+
+    HMPDFCHECK(d->n->source_N == 0,
+               "hmpdf_set_source_bin requires hmpdf_source_N to be passed");
+    HMPDFCHECK(bin < 0 || bin >= d->n->source_N,
+               "source bin %d out of range [0, %d)", bin, d->n->source_N);
+
+    if (bin == d->n->source_bin) { return 0; }
+
+    SAFEHMPDF(select_source_bin(d, bin));
+
+    ENDFCT
+}//}}}
@@ -32,9 +32,12 @@ null_maps(hmpdf_obj *d)
     d->m->created_sidelengths = 0;
 
     d->m->created_mem = 0;
+    d->m->Nfourier = NULL;
+    d->m->p_cnt_r2c = NULL;
 
     d->m->created_ellgrid = 0;
     d->m->ellgrid = NULL;
+    d->m->pxlwindow = NULL;
 
     d->m->created_map = 0;
     d->m->map_real = NULL;
@@ -44,6 +47,10 @@ null_maps(hmpdf_obj *d)
     d->m->created_map_ws = 0;
     d->m->ws = NULL;
 
+    d->m->created_catalog_in = 0;
+    d->m->cat_in = NULL;
+    d->m->cat_in_offsets = NULL;
+
     ENDFCT
 }//}}}
 
@@ -55,19 +62,22 @@ reset_maps(hmpdf_obj *d)
     HMPDFPRINT(2, "\treset_maps\n");
 
     if (d->m->ellgrid != NULL) { free(d->m->ellgrid); }
+    if (d->m->pxlwindow != NULL) { free(d->m->pxlwindow); }
     if (d->m->map_real != NULL)
     {
         if (d->m->need_ft)
         {
-            fftw_free(d->m->map_real);
+            MAPFFTW(free)(d->m->map_real);
         }
         else
         {
             free(d->m->map_real);
         }
     }
-    if (d->m->p_r2c != NULL) { fftw_destroy_plan(*(d->m->p_r2c)); free(d->m->p_r2c); }
-    if (d->m->p_c2r != NULL) { fftw_destroy_plan(*(d->m->p_c2r)); free(d->m->p_c2r); }
+    if (d->m->p_r2c != NULL) { MAPFFTW(destroy_plan)(*(d->m->p_r2c)); free(d->m->p_r2c); }
+    if (d->m->p_c2r != NULL) { MAPFFTW(destroy_plan)(*(d->m->p_c2r)); free(d->m->p_c2r); }
+    if (d->m->p_cnt_r2c != NULL) { MAPFFTW(destroy_plan)(*(d->m->p_cnt_r2c)); free(d->m->p_cnt_r2c); }
+    if (d->m->Nfourier != NULL) { free(d->m->Nfourier); }
     if (d->m->ws != NULL)
     {
         for (int ii=0; ii<d->m->Nws; ii++)
@@ -78,7 +88,7 @@ reset_maps(hmpdf_obj *d)
                 {
                     if (d->m->ws[ii]->for_fft)
                     {
-                        fftw_free(d->m->ws[ii]->map);
+                        MAPFFTW(free)(d->m->ws[ii]->map);
                     }
                     else
                     {
@@ -87,10 +97,17 @@ reset_maps(hmpdf_obj *d)
                 }
                 if (d->m->ws[ii]->pos != NULL) { free(d->m->ws[ii]->pos); }
                 if (d->m->ws[ii]->buf != NULL) { free(d->m->ws[ii]->buf); }
+                if (d->m->ws[ii]->bank != NULL) { free(d->m->ws[ii]->bank); }
+                if (d->m->ws[ii]->bank_done != NULL) { free(d->m->ws[ii]->bank_done); }
+                if (d->m->ws[ii]->cnt != NULL) { MAPFFTW(free)(d->m->ws[ii]->cnt); }
+                if (d->m->ws[ii]->cnt_acc != NULL) { free(d->m->ws[ii]->cnt_acc); }
+                if (d->m->ws[ii]->ellmod != NULL) { free(d->m->ws[ii]->ellmod); }
+                if (d->m->ws[ii]->sell != NULL) { free(d->m->ws[ii]->sell); }
+                if (d->m->ws[ii]->cat != NULL) { free(d->m->ws[ii]->cat); }
                 if (d->m->ws[ii]->rng != NULL) { gsl_rng_free(d->m->ws[ii]->rng); }
                 if (d->m->ws[ii]->p_r2c != NULL)
                 {
-                    fftw_destroy_plan(*(d->m->ws[ii]->p_r2c));
+                    MAPFFTW(destroy_plan)(*(d->m->ws[ii]->p_r2c));
                     free(d->m->ws[ii]->p_r2c);
                 }
                 free(d->m->ws[ii]);
@@ -98,6 +115,8 @@ reset_maps(hmpdf_obj *d)
         }
         free(d->m->ws);
     }
+    if (d->m->cat_in != NULL) { free(d->m->cat_in); }
+    if (d->m->cat_in_offsets != NULL) { free(d->m->cat_in_offsets); }
 
     ENDFCT
 }//}}}
@@ -113,6 +132,16 @@ reset_maps(hmpdf_obj *d)
             { free(ws->pos); }         \
             if (ws->buf != NULL)       \
             { free(ws->buf); }         \
+            if (ws->cnt != NULL)       \
+            { MAPFFTW(free)(ws->cnt); }    \
+            if (ws->cnt_acc != NULL)   \
+            { free(ws->cnt_acc); }     \
+            if (ws->ellmod != NULL)    \
+            { free(ws->ellmod); }      \
+            if (ws->sell != NULL)      \
+            { free(ws->sell); }        \
+            if (ws->bank_done != NULL) \
+            { free(ws->bank_done); }   \
             free(*out);                \
             if (ws->rng != NULL)       \
             { gsl_rng_free(ws->rng); } \
@@ -134,8 +163,18 @@ new_map_ws(hmpdf_obj *d, int idx, map_ws **out)
     ws->map = NULL;
     ws->pos = NULL;
     ws->buf = NULL;
+    ws->banklen = 0;
+    ws->bank = NULL;
+    ws->bank_done = NULL;
+    ws->cnt = NULL;
+    ws->cnt_acc = NULL;
+    ws->ellmod = NULL;
+    ws->sell = NULL;
     ws->rng = NULL;
     ws->p_r2c = NULL;
+    ws->Ncat = 0;
+    ws->catlen = 0;
+    ws->cat = NULL;
 
     if (idx == 0 && d->f->has_z_dependent)
     {
@@ -151,7 +190,24 @@ new_map_ws(hmpdf_obj *d, int idx, map_ws **out)
     NEWMAPWS_SAFEALLOC(ws->pos, malloc(d->m->buflen
                                        * sizeof(double)));
     NEWMAPWS_SAFEALLOC(ws->buf, malloc(d->m->buflen
-                                       * sizeof(double)));
+                                       * sizeof(mapfloat)));
+
+    if (d->m->subpixel_K > 0)
+    // the bank itself is grown as needed
+    {
+        NEWMAPWS_SAFEALLOC(ws->bank_done, malloc(d->m->subpixel_K * d->m->subpixel_K
+                                                 * sizeof(int)));
+    }
+
+    if (d->m->fourier_min_N > 0)
+    {
+        NEWMAPWS_SAFEALLOC(ws->cnt, MAPFFTW(malloc)(d->m->Nside * (d->m->Nside+2)
+                                                    * sizeof(mapfloat)));
+        NEWMAPWS_SAFEALLOC(ws->cnt_acc, malloc(d->m->Nside * (d->m->Nside/2+1)
+                                               * sizeof(mapcomplex)));
+        NEWMAPWS_SAFEALLOC(ws->ellmod, malloc((d->m->Nside/2+1) * sizeof(double)));
+        NEWMAPWS_SAFEALLOC(ws->sell, malloc((d->m->Nside/2+1) * sizeof(double)));
+    }
 
     // the performance of the random number generator can actually
     //     turn out to be a bottle neck, so we use a relatively
@@ -159,17 +215,17 @@ new_map_ws(hmpdf_obj *d, int idx, map_ws **out)
     NEWMAPWS_SAFEALLOC(ws->rng, gsl_rng_alloc(gsl_rng_taus));
 
     NEWMAPWS_SAFEALLOC(ws->map, ((ws->for_fft) ?
-                                 fftw_malloc
+                                 MAPFFTW(malloc)
                                  : malloc)(ws->ldmap * d->m->Nside
-                                           * sizeof(double)));
+                                           * sizeof(mapfloat)));
 
     if (ws->for_fft)
     {
-        ws->map_comp = (double complex *)ws->map;
+        ws->map_comp = (mapcomplex *)ws->map;
         if (d->f->has_z_dependent)
         {
-            NEWMAPWS_SAFEALLOC(ws->p_r2c, malloc(sizeof(fftw_plan)));
-            *(ws->p_r2c) = fftw_plan_dft_r2c_2d(d->m->Nside, d->m->Nside,
+            NEWMAPWS_SAFEALLOC(ws->p_r2c, malloc(sizeof(mapfftw_plan)));
+            *(ws->p_r2c) = MAPFFTW(plan_dft_r2c_2d)(d->m->Nside, d->m->Nside,
                                                 ws->map, ws->map_comp, FFTW_MEASURE);
         }
     }
@@ -215,6 +271,16 @@ create_map_ws(hmpdf_obj *d)
 
     HMPDFCHECK(d->m->Nws<1, "Failed to allocate any workspaces.");
 
+    if (d->m->fourier_min_N > 0)
+    // one plan for all workspaces, executed with the new-array interface
+    {
+        SAFEALLOC(d->m->p_cnt_r2c, malloc(sizeof(mapfftw_plan)));
+        *(d->m->p_cnt_r2c) = MAPFFTW(plan_dft_r2c_2d)(d->m->Nside, d->m->Nside,
+                                                      d->m->ws[0]->cnt,
+                                                      (mapcomplex *)d->m->ws[0]->cnt,
+                                                      FFTW_ESTIMATE);
+    }
+
     d->m->created_map_ws = 1;
 
     ENDFCT
@@ -234,6 +300,21 @@ create_ellgrid(hmpdf_obj *d)
                        0.0, M_PI/d->f->pixelside,
                        d->m->ellgrid));
 
+    // Fourier transform of the sampling points fill_buf averages over, along one axis,
+    //     so the halos painted in Fourier space have the same pixelization
+    SAFEALLOC(d->m->pxlwindow, malloc((d->m->Nside/2+1) * sizeof(double)));
+    long pixside = 2 * d->m->pxlgrid + 1;
+    for (long ii=0; ii<d->m->Nside/2+1; ii++)
+    {
+        d->m->pxlwindow[ii] = 0.0;
+        for (long xp= -d->m->pxlgrid; xp<= d->m->pxlgrid; xp++)
+        {
+            d->m->pxlwindow[ii] += cos(d->m->ellgrid[ii] * d->f->pixelside
+                                       * (double)(2*xp)/(double)pixside);
+        }
+        d->m->pxlwindow[ii] /= (double)pixside;
+    }
+
     d->m->created_ellgrid = 1;
 
     ENDFCT
@@ -270,37 +351,47 @@ reset_map_ws(hmpdf_obj *d, map_ws *ws)
     // seed the random number generator
     gsl_rng_set(ws->rng, seed);
 
-    zero_real(ws->ldmap * d->m->Nside, ws->map);
+    memset(ws->map, 0, ws->ldmap * d->m->Nside * sizeof(mapfloat));
 
     ENDFCT
 }//}}}
 
+static inline double
+stamp_tout(hmpdf_obj *d, int z_index, int M_index)
+// outer radius of the painted signal in units of the pixel spacing
+//     (the pixel-averaged profiles extend further than the profiles)
+{//{{{
+    return ((d->m->pixelavg) ? d->p->pixelavg_profiles[z_index][M_index][0]
+                             : d->p->profiles[z_index][M_index][0])
+           / d->f->pixelside;
+}//}}}
+
 static int
-fill_buf(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
+fill_buf(hmpdf_obj *d, int z_index, int M_index, double cx, double cy, map_ws *ws)
 // creates a map of the given object in the buffer
+//     the center of the object is displaced by (cx, cy) pixels
+//     from the center of the buffer
 {//{{{
     STARTFCT
 
     // theta_out in units of the pixel spacing
-    double tout = d->p->profiles[z_index][M_index][0]
-                  / d->f->pixelside;
+    double tout = stamp_tout(d, z_index, M_index);
 
     // compute how large this specific map needs to be
     //     the map is of size (2*w+1)^2
     long w = (long)ceil(tout);
     ws->bufside = 2 * w + 1;
-    long pixside = 2 * d->m->pxlgrid + 1;
 
-    // draw random displacement of the center of the halo
-    double dx = gsl_rng_uniform(ws->rng) - 0.5;
-    double dy = gsl_rng_uniform(ws->rng) - 0.5;
+    // with the pixel-averaged profiles, a single evaluation per pixel is sufficient
+    long pxlgrid = (d->m->pixelavg) ? 0 : d->m->pxlgrid;
+    long pixside = 2 * pxlgrid + 1;
 
     long Npix_filled = 0;
     while (Npix_filled < ws->bufside * ws->bufside)
     {
         long Npix_here
-            = GSL_MIN(ws->bufside * ws->bufside - Npix_filled,           // physical constraint
-                      (d->m->buflen - Npix_filled) / (pixside*pixside)); // memory constraint
+            = GSL_MIN(ws->bufside * ws->bufside - Npix_filled, // physical constraint
+                      d->m->buflen / (pixside*pixside));       // memory constraint
         HMPDFCHECK(Npix_here <= 0, "no buffer left. this is a bug.");
         
         long posidx = 0;
@@ -312,28 +403,37 @@ fill_buf(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
             long yy = (ii + Npix_filled) % ws->bufside - w;
 
             // loop over sample points within the pixel
-            for (long xp= -d->m->pxlgrid; xp<= d->m->pxlgrid; xp++)
+            for (long xp= -pxlgrid; xp<= pxlgrid; xp++)
             {
-                for (long yp= -d->m->pxlgrid; yp<= d->m->pxlgrid; yp++, posidx++)
+                for (long yp= -pxlgrid; yp<= pxlgrid; yp++, posidx++)
                 {
-                    double xpos = (double)xx + (double)(2*xp)/(double)pixside + dx;
-                    double ypos = (double)yy + (double)(2*yp)/(double)pixside + dy;
+                    double xpos = (double)xx + (double)(2*xp)/(double)pixside - cx;
+                    double ypos = (double)yy + (double)(2*yp)/(double)pixside - cy;
                     ws->pos[posidx] = hypot(xpos, ypos) / tout;
                 }
             }
         }
 
         // evaluate the profile interpolator
-        SAFEHMPDF(s_of_t(d, z_index, M_index, posidx, ws->pos, ws->buf+Npix_filled));
+        //     (in place, the profile is sampled in double precision)
+        if (d->m->pixelavg)
+        {
+            SAFEHMPDF(s_pixelavg_of_t(d, z_index, M_index, posidx, ws->pos, ws->pos));
+        }
+        else
+        {
+            SAFEHMPDF(s_of_t(d, z_index, M_index, posidx, ws->pos, ws->pos));
+        }
 
         posidx = 0;
         // perform the average
+        //     (with MAPS_SINGLE, this is the only rounding of the stamp)
         for (long ii=0; ii<Npix_here; ii++)
         {
             double temp = 0.0;
             for (long jj=0; jj<pixside*pixside; jj++, posidx++)
             {
-                temp += ws->buf[Npix_filled + posidx];
+                temp += ws->pos[posidx];
             }
             temp /= (double)(pixside*pixside);
             ws->buf[Npix_filled + ii] = temp;
@@ -346,12 +446,12 @@ fill_buf(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
 }//}}}
 
 // convenience macro to reduce typing
-#define INNERLOOP_OP                      \
-    ws->map[ixx*ws->ldmap + iyy]          \
-        += ws->buf[xx * ws->bufside + yy];
+#define INNERLOOP_OP                    \
+    ws->map[ixx*ws->ldmap + iyy]        \
+        += stamp[xx * ws->bufside + yy];
 
 static inline void 
-add_buf_inner_loop(hmpdf_obj *d, map_ws *ws, long y0, long xx, long ixx)
+add_buf_inner_loop(hmpdf_obj *d, map_ws *ws, mapfloat *stamp, long y0, long xx, long ixx)
 {//{{{
     for (long yy=0, iyy=y0;
          yy< GSL_MIN(ws->bufside, d->m->Nside - y0);
@@ -368,19 +468,15 @@ add_buf_inner_loop(hmpdf_obj *d, map_ws *ws, long y0, long xx, long ixx)
 }//}}}
 
 #define OUTERLOOP_OP \
-    add_buf_inner_loop(d, ws, y0, xx, ixx);
+    add_buf_inner_loop(d, ws, stamp, y0, xx, ixx);
 
 static int 
-add_buf(hmpdf_obj *d, map_ws *ws)
-// picks random position in the map and adds buffer map once,
+add_buf(hmpdf_obj *d, mapfloat *stamp, long x0, long y0, map_ws *ws)
+// adds buffer map (stamp, bufside x bufside) once, with its corner at (x0, y0),
 //     satisfies periodic boundary conditions
 {//{{{
     STARTFCT
 
-    // pick a random point in the map
-    long x0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
-    long y0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
-
     // add the pixel values from the buffer
     //     we 'unroll' the loops slightly for better efficiency
     //     with the periodic boundary conditions
@@ -455,14 +551,147 @@ draw_N_halos(hmpdf_obj *d, int z_index, int M_index, map_ws *ws, unsigned *N)
     ENDFCT
 }//}}}
 
+static int
+record_halo(int z_index, int M_index,
+            long x, long y, double cx, double cy, map_ws *ws)
+// appends a halo to the workspace's catalog
+//     (x, y) is the pixel containing the center
+{//{{{
+    STARTFCT
+
+    if (ws->Ncat == ws->catlen)
+    {
+        ws->catlen = (ws->catlen == 0) ? MAPCAT_CHUNK : 2 * ws->catlen;
+        SAFEALLOC(ws->cat, realloc(ws->cat, ws->catlen
+                                            * sizeof(hmpdf_catalog_halo_t)));
+    }
+
+    hmpdf_catalog_halo_t *h = ws->cat + ws->Ncat;
+    h->z_index = z_index;
+    h->M_index = M_index;
+    h->x = (int)x;
+    h->y = (int)y;
+    h->dx = (float)cx;
+    h->dy = (float)cy;
+    ++ws->Ncat;
+
+    ENDFCT
+}//}}}
+
+static int
+paint_catalog_bin(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
+// adds the halos of the input catalog in this bin to the map
+{//{{{
+    STARTFCT
+
+    int bin = z_index * d->n->NM + M_index;
+    hmpdf_catalog_halo_t *h_prev = NULL;
+
+    for (long ii=d->m->cat_in_offsets[bin]; ii<d->m->cat_in_offsets[bin+1]; ii++)
+    {
+        hmpdf_catalog_halo_t *h = d->m->cat_in + ii;
+
+        // the catalog is sorted by offsets within the bin,
+        //     so we only need to recompute the buffer if they change
+        if (h_prev == NULL || h->dx != h_prev->dx || h->dy != h_prev->dy)
+        {
+            SAFEHMPDF(fill_buf(d, z_index, M_index, h->dx, h->dy, ws));
+
+            HMPDFCHECK(ws->bufside >= d->m->Nside,
+                       "attempting to add a halo that is larger than the map. "
+                       "You should make the map larger.");
+        }
+        h_prev = h;
+
+        // convert center position to corner of the buffer
+        long w = (ws->bufside - 1) / 2;
+        long x0 = ((long)(h->x) - w + d->m->Nside) % d->m->Nside;
+        long y0 = ((long)(h->y) - w + d->m->Nside) % d->m->Nside;
+
+        SAFEHMPDF(add_buf(d, ws->buf, x0, y0, ws));
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+do_this_bin_bank(hmpdf_obj *d, int z_index, int M_index, unsigned N, map_ws *ws)
+// paints N halos with random sub-pixel offsets from the K x K bank
+{//{{{
+    STARTFCT
+
+    int K = d->m->subpixel_K;
+
+    // figure out the size of the stamps
+    //     (this is the same computation as in fill_buf)
+    long w = (long)ceil(stamp_tout(d, z_index, M_index));
+    long bufside = 2 * w + 1;
+
+    HMPDFCHECK(bufside >= d->m->Nside,
+               "attempting to add a halo that is larger than the map. "
+               "You should make the map larger.");
+
+    if (ws->banklen < K * K * bufside * bufside)
+    {
+        ws->banklen = K * K * bufside * bufside;
+        SAFEALLOC(ws->bank, realloc(ws->bank, ws->banklen * sizeof(mapfloat)));
+    }
+
+    for (int ii=0; ii<K*K; ii++)
+    {
+        ws->bank_done[ii] = 0;
+    }
+
+    for (unsigned ii=0; ii<N; ii++)
+    {
+        int k = gsl_rng_uniform_int(ws->rng, K*K);
+
+        // centers of the K x K sub-pixels
+        double cx = ((double)(k / K) + 0.5) / (double)K - 0.5;
+        double cy = ((double)(k % K) + 0.5) / (double)K - 0.5;
+
+        mapfloat *stamp = ws->bank + k * bufside * bufside;
+
+        if (!(ws->bank_done[k]))
+        {
+            SAFEHMPDF(fill_buf(d, z_index, M_index, cx, cy, ws));
+            memcpy(stamp, ws->buf, bufside * bufside * sizeof(mapfloat));
+            ws->bank_done[k] = 1;
+        }
+
+        long x0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+        long y0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+
+        if (d->m->catalog_out != NULL)
+        {
+            SAFEHMPDF(record_halo(z_index, M_index,
+                                  (x0 + w) % d->m->Nside, (y0 + w) % d->m->Nside,
+                                  cx, cy, ws));
+        }
+
+        // fill_buf may not have been called for this halo
+        ws->bufside = bufside;
+        SAFEHMPDF(add_buf(d, stamp, x0, y0, ws));
+    }
+
+    ENDFCT
+}//}}}
+
 static int
 do_this_bin(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
 // draws random integer from correct distribution
 // if ==0, return
 // else, fill_buf and then integer x add_buf
+// (if an input catalog is given, paints the halos in there instead)
 {//{{{
     STARTFCT
 
+    if (d->m->catalog_in != NULL)
+    {
+        SAFEHMPDF(paint_catalog_bin(d, z_index, M_index, ws));
+        return 0;
+    }
+
     unsigned N;
     SAFEHMPDF(draw_N_halos(d, z_index, M_index, ws, &N));
 
@@ -470,9 +699,22 @@ do_this_bin(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
     {
         return 0;
     }
+    else if (d->m->fourier_min_N > 0 && N >= (unsigned)(d->m->fourier_min_N))
+    // defer to paint_fourier_bins
+    {
+        d->m->Nfourier[z_index*d->n->NM+M_index] = N;
+    }
+    else if (d->m->subpixel_K > 0)
+    {
+        SAFEHMPDF(do_this_bin_bank(d, z_index, M_index, N, ws));
+    }
     else
     {
-        SAFEHMPDF(fill_buf(d, z_index, M_index, ws));
+        // draw random displacement of the center of the halo
+        double cx = 0.5 - gsl_rng_uniform(ws->rng);
+        double cy = 0.5 - gsl_rng_uniform(ws->rng);
+
+        SAFEHMPDF(fill_buf(d, z_index, M_index, cx, cy, ws));
 
         HMPDFCHECK(ws->bufside >= d->m->Nside,
                    "attempting to add a halo that is larger than the map. "
@@ -480,7 +722,19 @@ do_this_bin(hmpdf_obj *d, int z_index, int M_index, map_ws *ws)
 
         for (unsigned ii=0; ii<N; ii++)
         {
-            SAFEHMPDF(add_buf(d, ws));
+            // pick a random point in the map
+            long x0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+            long y0 = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+
+            if (d->m->catalog_out != NULL)
+            {
+                long w = (ws->bufside - 1) / 2;
+                SAFEHMPDF(record_halo(z_index, M_index,
+                                      (x0 + w) % d->m->Nside, (y0 + w) % d->m->Nside,
+                                      cx, cy, ws));
+            }
+
+            SAFEHMPDF(add_buf(d, ws->buf, x0, y0, ws));
         }
     }
 
@@ -539,7 +793,7 @@ add_grf(hmpdf_obj *d, double (*pwr_spec)(double, void *), void *pwr_spec_params)
 }//}}}
 
 static int
-filter_map(hmpdf_obj *d, double complex *map_comp, int *z_index)
+filter_map(hmpdf_obj *d, mapcomplex *map_comp, int *z_index)
 {//{{{
     STARTFCT
 
@@ -570,10 +824,33 @@ filter_map(hmpdf_obj *d, double complex *map_comp, int *z_index)
             ellmod[jj] = hypot(ell1, ell2);
         }
 
+        #ifdef MAPS_SINGLE
+        // the filters operate in double precision, so we need a temporary row
+        double complex *row;
+        SAFEALLOC_NORETURN(row, malloc((d->m->Nside/2+1) * sizeof(double complex)));
+
+        CONTINUE_IF_ERR
+
+        for (long jj=0; jj<d->m->Nside/2+1; jj++)
+        {
+            row[jj] = map_comp[ii*(d->m->Nside/2+1)+jj];
+        }
+
+        SAFEHMPDF_NORETURN(apply_filters_map(d, d->m->Nside/2+1, ellmod,
+                                             row, row, z_index));
+
+        for (long jj=0; jj<d->m->Nside/2+1; jj++)
+        {
+            map_comp[ii*(d->m->Nside/2+1)+jj] = row[jj];
+        }
+
+        free(row);
+        #else
         SAFEHMPDF_NORETURN(apply_filters_map(d, d->m->Nside/2+1, ellmod,
                                              map_comp + ii * (d->m->Nside/2+1),
                                              map_comp + ii * (d->m->Nside/2+1),
                                              z_index));
+        #endif
 
         free(ellmod);
     }
@@ -582,6 +859,152 @@ filter_map(hmpdf_obj *d, double complex *map_comp, int *z_index)
     ENDFCT
 }//}}}
 
+static int
+paint_fourier_bin(hmpdf_obj *d, int z_index, int M_index, unsigned N, map_ws *ws)
+// deposits N halo centers on the count grid, and adds its convolution
+//     with the conjugate profile to ws->cnt_acc
+{//{{{
+    STARTFCT
+
+    long ldcnt = d->m->Nside + 2;
+    long Nell2 = d->m->Nside/2 + 1;
+
+    memset(ws->cnt, 0, d->m->Nside * ldcnt * sizeof(mapfloat));
+
+    // same convention as in do_this_bin
+    double cx = 0.5 - gsl_rng_uniform(ws->rng);
+    double cy = 0.5 - gsl_rng_uniform(ws->rng);
+
+    for (unsigned ii=0; ii<N; ii++)
+    {
+        long x = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+        long y = gsl_rng_uniform_int(ws->rng, d->m->Nside);
+
+        if (d->m->catalog_out != NULL)
+        {
+            SAFEHMPDF(record_halo(z_index, M_index, x, y, cx, cy, ws));
+        }
+
+        ws->cnt[x*ldcnt + y] += 1.0;
+    }
+
+    mapcomplex *cnt_comp = (mapcomplex *)ws->cnt;
+    MAPFFTW(execute_dft_r2c)(*(d->m->p_cnt_r2c), ws->cnt, cnt_comp);
+
+    // the discrete transform of a stamp is the continuous one divided by the pixel area
+    double norm = 1.0 / gsl_pow_2(d->f->pixelside);
+
+    for (long ii=0; ii<d->m->Nside; ii++)
+    // loop over long direction (rows)
+    {
+        double ell1 = WAVENR(d->m->Nside, d->m->ellgrid, ii);
+
+        for (long jj=0; jj<Nell2; jj++)
+        {
+            double ell2 = WAVENR(d->m->Nside, d->m->ellgrid, jj);
+            ws->ellmod[jj] = hypot(ell1, ell2);
+        }
+
+        SAFEHMPDF(s_of_ell(d, z_index, M_index, Nell2, ws->ellmod, ws->sell));
+
+        // same pixelization as the directly painted halos
+        double pw1 = 1.0;
+        if (d->m->pixelavg)
+        {
+            SAFEHMPDF(apply_pixelfilter(d, Nell2, ws->ellmod, ws->sell, ws->sell));
+        }
+        else
+        {
+            pw1 = d->m->pxlwindow[(ii <= d->m->Nside/2) ? ii : d->m->Nside-ii];
+        }
+
+        for (long jj=0; jj<Nell2; jj++)
+        {
+            double ell2 = WAVENR(d->m->Nside, d->m->ellgrid, jj);
+            double pw2 = (d->m->pixelavg) ? 1.0 : d->m->pxlwindow[jj];
+
+            // profile, pixel window, and shift to the sub-pixel position
+            ws->cnt_acc[ii*Nell2+jj] += cnt_comp[ii*Nell2+jj]
+                                        * norm * ws->sell[jj] * pw1 * pw2
+                                        * cexp(-_Complex_I * d->f->pixelside
+                                               * (ell1 * cx + ell2 * cy));
+        }
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+paint_fourier_bins(hmpdf_obj *d, int *z_index, mapcomplex *map_comp)
+// paints all bins that have been deferred by do_this_bin
+// if z_index != NULL, only the bins at this redshift
+{//{{{
+    STARTFCT
+
+    if (d->m->fourier_min_N <= 0) { return 0; }
+
+    int *bins;
+    SAFEALLOC(bins, malloc(d->n->Nz * d->n->NM * sizeof(int)));
+    int Nbins = 0;
+    for (int ii=0; ii<d->n->Nz * d->n->NM; ii++)
+    {
+        if (d->m->Nfourier[ii] > 0
+            && (z_index == NULL || ii / d->n->NM == *z_index))
+        {
+            bins[Nbins++] = ii;
+        }
+    }
+
+    if (z_index == NULL)
+    {
+        HMPDFPRINT(3, "\t\tpainting %d bins in Fourier space\n", Nbins);
+    }
+
+    if (Nbins == 0)
+    {
+        free(bins);
+        return 0;
+    }
+
+    long Ncomp = d->m->Nside * (d->m->Nside/2+1);
+
+    // each thread accumulates into its own array
+    for (int ii=0; ii<d->m->Nws; ii++)
+    {
+        memset(d->m->ws[ii]->cnt_acc, 0, Ncomp * sizeof(mapcomplex));
+    }
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->m->Nws) schedule(dynamic)
+    #endif
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        CONTINUE_IF_ERR
+
+        int this_z_index = bins[ii] / d->n->NM;
+        int this_M_index = bins[ii] % d->n->NM;
+        SAFEHMPDF_NORETURN(paint_fourier_bin(d, this_z_index, this_M_index,
+                                             d->m->Nfourier[bins[ii]],
+                                             d->m->ws[THIS_THREAD]));
+    }
+
+    free(bins);
+
+    // reduce once
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
+    #endif
+    for (long ii=0; ii<Ncomp; ii++)
+    {
+        for (int jj=0; jj<d->m->Nws; jj++)
+        {
+            map_comp[ii] += d->m->ws[jj]->cnt_acc[ii];
+        }
+    }
+
+    ENDFCT
+}//}}}
+
 static int
 loop_no_z_dependence(hmpdf_obj *d)
 // the loop if there are no z-dependent filters
@@ -645,18 +1068,21 @@ loop_no_z_dependence(hmpdf_obj *d)
     free(bins);
 
     // add to the total map
-    for (int ii=0; ii<d->m->Nws; ii++)
+    //     (the workspaces are summed in double, so with MAPS_SINGLE
+    //      there is a single rounding per pixel)
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
+    #endif
+    for (long jj=0; jj<d->m->Nside; jj++)
     {
-        #ifdef _OPENMP
-        #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
-        #endif
-        for (long jj=0; jj<d->m->Nside; jj++)
+        for (long kk=0; kk<d->m->Nside; kk++)
         {
-            for (long kk=0; kk<d->m->Nside; kk++)
+            double temp = d->m->map_real[jj*d->m->ldmap + kk];
+            for (int ii=0; ii<d->m->Nws; ii++)
             {
-                d->m->map_real[jj*d->m->ldmap + kk]
-                    += d->m->ws[ii]->map[jj*d->m->ws[ii]->ldmap+kk];
+                temp += d->m->ws[ii]->map[jj*d->m->ws[ii]->ldmap + kk];
             }
+            d->m->map_real[jj*d->m->ldmap + kk] = temp;
         }
     }
 
@@ -665,7 +1091,10 @@ loop_no_z_dependence(hmpdf_obj *d)
         // transform to conjugate space
         HMPDFCHECK(d->m->p_r2c == NULL,
                    "trying to execute an fftw_plan that has not been initialized.");
-        fftw_execute(*(d->m->p_r2c));
+        MAPFFTW(execute)(*(d->m->p_r2c));
+
+        // add the halos from abundant bins
+        SAFEHMPDF(paint_fourier_bins(d, NULL, d->m->map_comp));
     }
 
     ENDFCT
@@ -724,22 +1153,27 @@ loop_w_z_dependence(hmpdf_obj *d)
         }
 
         // sum all sub-maps in the 0th one (which always exists)
-        for (int ii=1; ii<d->m->Nws; ii++)
+        //     (in double, so there is a single rounding per pixel with MAPS_SINGLE)
+        for (long jj=0; jj<d->m->Nside; jj++)
         {
-            for (long jj=0; jj<d->m->Nside; jj++)
+            for (long kk=0; kk<d->m->Nside; kk++)
             {
-                for (long kk=0; kk<d->m->Nside; kk++)
+                double temp = 0.0;
+                for (int ii=0; ii<d->m->Nws; ii++)
                 {
-                    d->m->ws[0]->map[jj*(d->m->Nside+2) + kk]
-                        += d->m->ws[ii]->map[jj*d->m->Nside + kk];
+                    temp += d->m->ws[ii]->map[jj*d->m->ws[ii]->ldmap + kk];
                 }
+                d->m->ws[0]->map[jj*d->m->ws[0]->ldmap + kk] = temp;
             }
         }
 
         // transform to conjugate space
         HMPDFCHECK(d->m->ws[0]->p_r2c == NULL,
                    "trying to execute an fftw_plan that has not been initialized.");
-        fftw_execute(*(d->m->ws[0]->p_r2c));
+        MAPFFTW(execute)(*(d->m->ws[0]->p_r2c));
+
+        // add the halos from abundant bins
+        SAFEHMPDF(paint_fourier_bins(d, &z_index, d->m->ws[0]->map_comp));
 
         // apply the z-dependent filters
         SAFEHMPDF(filter_map(d, d->m->ws[0]->map_comp, &z_index));
@@ -764,6 +1198,131 @@ loop_w_z_dependence(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
+static int
+write_catalog(hmpdf_obj *d)
+// writes the halos recorded by all workspaces to file
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(3, "\t\twriting halo catalog to %s\n", d->m->catalog_out);
+
+    hmpdf_catalog_header_t hdr = { .Nside=d->m->Nside,
+                                   .Nz=d->n->Nz, .NM=d->n->NM,
+                                   .Nhalos=0 };
+    memcpy(hdr.magic, "HMPDFCAT", 8);
+    for (int ii=0; ii<d->m->Nws; ii++)
+    {
+        hdr.Nhalos += d->m->ws[ii]->Ncat;
+    }
+
+    FILE *fp = fopen(d->m->catalog_out, "wb");
+    HMPDFCHECK(!fp, "failed to open file %s", d->m->catalog_out);
+
+    int write_failed = fwrite(&hdr, sizeof(hmpdf_catalog_header_t), 1, fp) != 1;
+    for (int ii=0; ii<d->m->Nws && !write_failed; ii++)
+    {
+        write_failed = fwrite(d->m->ws[ii]->cat, sizeof(hmpdf_catalog_halo_t),
+                              d->m->ws[ii]->Ncat, fp)
+                       != (size_t)(d->m->ws[ii]->Ncat);
+    }
+
+    fclose(fp);
+
+    HMPDFCHECK(write_failed, "failed to write to file %s", d->m->catalog_out);
+
+    ENDFCT
+}//}}}
+
+static int
+cmp_catalog_halo(const void *a, const void *b)
+// sorts by bin, and within a bin by offset
+{//{{{
+    const hmpdf_catalog_halo_t *h1 = (const hmpdf_catalog_halo_t *)a;
+    const hmpdf_catalog_halo_t *h2 = (const hmpdf_catalog_halo_t *)b;
+
+    if (h1->z_index != h2->z_index) { return (h1->z_index < h2->z_index) ? -1 : 1; }
+    if (h1->M_index != h2->M_index) { return (h1->M_index < h2->M_index) ? -1 : 1; }
+    if (h1->dx != h2->dx) { return (h1->dx < h2->dx) ? -1 : 1; }
+    if (h1->dy != h2->dy) { return (h1->dy < h2->dy) ? -1 : 1; }
+    return 0;
+}//}}}
+
+static int
+create_catalog_in(hmpdf_obj *d)
+// reads the input catalog and sorts it by bin
+{//{{{
+    STARTFCT
+
+    if (d->m->created_catalog_in) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_catalog_in\n");
+
+    FILE *fp = fopen(d->m->catalog_in, "rb");
+    HMPDFCHECK(!fp, "failed to open file %s", d->m->catalog_in);
+
+    hmpdf_catalog_header_t hdr;
+    if (fread(&hdr, sizeof(hmpdf_catalog_header_t), 1, fp) != 1)
+    {
+        fclose(fp);
+        HMPDFERR("failed to read header from file %s", d->m->catalog_in);
+    }
+    if (memcmp(hdr.magic, "HMPDFCAT", 8) || hdr.Nhalos < 0)
+    {
+        fclose(fp);
+        HMPDFERR("file %s is not a valid halo catalog", d->m->catalog_in);
+    }
+    if (hdr.Nside != d->m->Nside || hdr.Nz != d->n->Nz || hdr.NM != d->n->NM)
+    {
+        fclose(fp);
+        HMPDFERR("halo catalog %s has Nside=%ld, Nz=%d, NM=%d, "
+                 "but the code uses Nside=%ld, Nz=%d, NM=%d.",
+                 d->m->catalog_in, hdr.Nside, hdr.Nz, hdr.NM,
+                 d->m->Nside, d->n->Nz, d->n->NM);
+    }
+
+    HMPDFPRINT(3, "\t\treading %ld halos from %s\n", hdr.Nhalos, d->m->catalog_in);
+
+    // allocate at least one element so we do not get NULL for empty catalogs
+    SAFEALLOC(d->m->cat_in, malloc(GSL_MAX(hdr.Nhalos, 1)
+                                   * sizeof(hmpdf_catalog_halo_t)));
+    long read = fread(d->m->cat_in, sizeof(hmpdf_catalog_halo_t), hdr.Nhalos, fp);
+    fclose(fp);
+    HMPDFCHECK(read != hdr.Nhalos,
+               "file %s corrupted, expected %ld halos but found %ld.",
+               d->m->catalog_in, hdr.Nhalos, read);
+
+    for (long ii=0; ii<hdr.Nhalos; ii++)
+    {
+        hmpdf_catalog_halo_t *h = d->m->cat_in + ii;
+        HMPDFCHECK(h->z_index < 0 || h->z_index >= d->n->Nz
+                   || h->M_index < 0 || h->M_index >= d->n->NM
+                   || h->x < 0 || h->x >= d->m->Nside
+                   || h->y < 0 || h->y >= d->m->Nside
+                   || fabs(h->dx) > 0.5 || fabs(h->dy) > 0.5,
+                   "invalid halo %ld in catalog %s.", ii, d->m->catalog_in);
+    }
+
+    qsort(d->m->cat_in, hdr.Nhalos, sizeof(hmpdf_catalog_halo_t), cmp_catalog_halo);
+
+    // figure out where the individual bins start
+    SAFEALLOC(d->m->cat_in_offsets, malloc((d->n->Nz * d->n->NM + 1) * sizeof(long)));
+    long idx = 0;
+    for (int bin=0; bin<d->n->Nz * d->n->NM; bin++)
+    {
+        d->m->cat_in_offsets[bin] = idx;
+        while (idx < hdr.Nhalos
+               && d->m->cat_in[idx].z_index * d->n->NM + d->m->cat_in[idx].M_index == bin)
+        {
+            ++idx;
+        }
+    }
+    d->m->cat_in_offsets[d->n->Nz * d->n->NM] = idx;
+
+    d->m->created_catalog_in = 1;
+
+    ENDFCT
+}//}}}
+
 static int
 create_mem(hmpdf_obj *d)
 {//{{{
@@ -775,7 +1334,8 @@ create_mem(hmpdf_obj *d)
 
     if (d->f->Nfilters > 1 // the pixelization is done in real space,
                            //     which is more accurate
-        || d->ns->have_noise)
+        || d->ns->have_noise
+        || d->m->fourier_min_N > 0)
     {
         d->m->need_ft = 1;
         d->m->ldmap = d->m->Nside + 2;
@@ -787,27 +1347,32 @@ create_mem(hmpdf_obj *d)
     }
 
     SAFEALLOC(d->m->map_real, ((d->m->need_ft) ?
-                               fftw_malloc : malloc)(d->m->Nside * d->m->ldmap
-                                                     * sizeof(double)));
+                               MAPFFTW(malloc) : malloc)(d->m->Nside * d->m->ldmap
+                                                         * sizeof(mapfloat)));
 
     if (d->m->need_ft)
     {
-        d->m->map_comp = (double complex *)d->m->map_real;
+        d->m->map_comp = (mapcomplex *)d->m->map_real;
 
         if (!(d->f->has_z_dependent))
         // if there are z-dependent filters, the 0th workspace
         //     handles the r2c FFTs (one for each redshift)
         {
-            SAFEALLOC(d->m->p_r2c, malloc(sizeof(fftw_plan)));
-            *(d->m->p_r2c) = fftw_plan_dft_r2c_2d(d->m->Nside, d->m->Nside,
-                                                  d->m->map_real, d->m->map_comp,
-                                                  FFTW_ESTIMATE);
+            SAFEALLOC(d->m->p_r2c, malloc(sizeof(mapfftw_plan)));
+            *(d->m->p_r2c) = MAPFFTW(plan_dft_r2c_2d)(d->m->Nside, d->m->Nside,
+                                                      d->m->map_real, d->m->map_comp,
+                                                      FFTW_ESTIMATE);
         }
 
-        SAFEALLOC(d->m->p_c2r, malloc(sizeof(fftw_plan)));
-        *(d->m->p_c2r) = fftw_plan_dft_c2r_2d(d->m->Nside, d->m->Nside,
-                                              d->m->map_comp, d->m->map_real,
-                                              FFTW_ESTIMATE);
+        SAFEALLOC(d->m->p_c2r, malloc(sizeof(mapfftw_plan)));
+        *(d->m->p_c2r) = MAPFFTW(plan_dft_c2r_2d)(d->m->Nside, d->m->Nside,
+                                                  d->m->map_comp, d->m->map_real,
+                                                  FFTW_ESTIMATE);
+    }
+
+    if (d->m->fourier_min_N > 0)
+    {
+        SAFEALLOC(d->m->Nfourier, malloc(d->n->Nz * d->n->NM * sizeof(unsigned)));
     }
 
     d->m->created_mem = 1;
@@ -852,7 +1417,19 @@ create_map(hmpdf_obj *d)
     HMPDFPRINT(2, "\tcreate_map\n");
 
     // zero the map
-    zero_real(d->m->Nside * d->m->ldmap, d->m->map_real);
+    memset(d->m->map_real, 0, d->m->Nside * d->m->ldmap * sizeof(mapfloat));
+
+    // clear the halo catalogs
+    for (int ii=0; ii<d->m->Nws; ii++)
+    {
+        d->m->ws[ii]->Ncat = 0;
+    }
+
+    // clear the bins deferred to Fourier space
+    if (d->m->Nfourier != NULL)
+    {
+        memset(d->m->Nfourier, 0, d->n->Nz * d->n->NM * sizeof(unsigned));
+    }
 
     // run the loop
     if (d->f->has_z_dependent)
@@ -864,6 +1441,11 @@ create_map(hmpdf_obj *d)
         SAFEHMPDF(loop_no_z_dependence(d));
     }
 
+    if (d->m->catalog_out != NULL)
+    {
+        SAFEHMPDF(write_catalog(d));
+    }
+
     if (d->m->need_ft)
     {
         // add the Gaussian random field
@@ -878,7 +1460,7 @@ create_map(hmpdf_obj *d)
         // transform back to real space
         HMPDFCHECK(d->m->p_c2r == NULL,
                    "trying to execute an fftw_plan that has not been initialized.");
-        fftw_execute(*(d->m->p_c2r));
+        MAPFFTW(execute)(*(d->m->p_c2r));
 
         // normalize properly
         for (long ii=0; ii<d->m->Nside * (d->m->Nside+2); ii++)
@@ -909,17 +1491,22 @@ create_sidelengths(hmpdf_obj *d)
     double map_side = sqrt(d->m->area);
     d->m->Nside = (long)round(map_side/d->f->pixelside);
 
+    // the pixel-averaged profiles extend further, which determines the buffer size
+    if (d->m->pixelavg)
+    {
+        SAFEHMPDF(create_pixelavg_profiles(d));
+    }
+
     double max_t_out = 0.0;
     for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
         for (int M_index=0; M_index<d->n->NM; M_index++)
         {
-            max_t_out = GSL_MAX(max_t_out,
-                                d->p->profiles[z_index][M_index][0]);
+            max_t_out = GSL_MAX(max_t_out, stamp_tout(d, z_index, M_index));
         }
     }
 
-    long temp = (long)round(max_t_out/d->f->pixelside);
+    long temp = (long)round(max_t_out);
     temp *= 2;
     temp += 4; // some safety buffer
     d->m->buflen = temp * temp; // not sufficient to do all halos
@@ -931,9 +1518,9 @@ create_sidelengths(hmpdf_obj *d)
     HMPDFPRINT(3, "\t\tmap = %ld x %ld <=> %g GB\n",
                   d->m->Nside, d->m->Nside,
                   1e-9 * (double)(d->m->Nside * d->m->Nside
-                                  * sizeof(double)));
+                                  * sizeof(mapfloat)));
     HMPDFPRINT(3, "\t\tbuffer <=> %g GB\n",
-                  1e-9 * (double)(d->m->buflen * sizeof(double)));
+                  1e-9 * (double)(d->m->buflen * (sizeof(double) + sizeof(mapfloat))));
 
     ENDFCT
 }//}}}
@@ -947,10 +1534,14 @@ prepare_maps(hmpdf_obj *d)
 
     HMPDFPRINT(1, "prepare_maps\n");
 
-    SAFEHMPDF(create_sidelengths(d));
+    SAFEHMPDF(create_sidelengths(d)); // includes the pixel-averaged profiles
     SAFEHMPDF(create_mem(d));
     SAFEHMPDF(create_ellgrid(d));
     SAFEHMPDF(create_map_ws(d));
+    if (d->m->catalog_in != NULL)
+    {
+        SAFEHMPDF(create_catalog_in(d));
+    }
     SAFEHMPDF(create_map(d));
 
     ENDFCT
@@ -1053,11 +1644,11 @@ perform_map_FT(hmpdf_obj *d)
     //     an fftw plan does not preserve the memory pointed to
     if (d->m->ws[0]->p_r2c == NULL)
     {
-        SAFEALLOC(d->m->ws[0]->p_r2c, malloc(sizeof(fftw_plan)));
-        *(d->m->ws[0]->p_r2c) = fftw_plan_dft_r2c_2d(d->m->Nside, d->m->Nside,
-                                                     d->m->ws[0]->map,
-                                                     d->m->ws[0]->map_comp,
-                                                     FFTW_ESTIMATE);
+        SAFEALLOC(d->m->ws[0]->p_r2c, malloc(sizeof(mapfftw_plan)));
+        *(d->m->ws[0]->p_r2c) = MAPFFTW(plan_dft_r2c_2d)(d->m->Nside, d->m->Nside,
+                                                         d->m->ws[0]->map,
+                                                         d->m->ws[0]->map_comp,
+                                                         FFTW_ESTIMATE);
     }
 
     // copy the real space map into the 0th workspace
@@ -1065,11 +1656,11 @@ perform_map_FT(hmpdf_obj *d)
     {
         memcpy(d->m->ws[0]->map + ii*d->m->ws[0]->ldmap,
                d->m->map_real + ii*d->m->ldmap,
-               d->m->Nside * sizeof(double));
+               d->m->Nside * sizeof(mapfloat));
     }
 
     // create the fourier space map
-    fftw_execute(*(d->m->ws[0]->p_r2c));
+    MAPFFTW(execute)(*(d->m->ws[0]->p_r2c));
 
     ENDFCT
 }//}}}
@@ -1165,9 +1756,40 @@ hmpdf_get_map1(hmpdf_obj *d, double *map, int new_map)
 
     for (long ii=0; ii<d->m->Nside; ii++)
     {
+        #ifdef MAPS_SINGLE
+        for (long jj=0; jj<d->m->Nside; jj++)
+        {
+            map[ii*d->m->Nside+jj] = d->m->map_real[ii*d->m->ldmap+jj];
+        }
+        #else
         memcpy(map + ii*d->m->Nside,
                d->m->map_real + ii*d->m->ldmap,
                d->m->Nside * sizeof(double));
+        #endif
+    }
+
+    ENDFCT
+}//}}}
+
+int
+hmpdf_get_mapf1(hmpdf_obj *d, float *map, int new_map)
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(common_input_processing(d, new_map));
+
+    for (long ii=0; ii<d->m->Nside; ii++)
+    {
+        #ifdef MAPS_SINGLE
+        memcpy(map + ii*d->m->Nside,
+               d->m->map_real + ii*d->m->ldmap,
+               d->m->Nside * sizeof(float));
+        #else
+        for (long jj=0; jj<d->m->Nside; jj++)
+        {
+            map[ii*d->m->Nside+jj] = (float)d->m->map_real[ii*d->m->ldmap+jj];
+        }
+        #endif
     }
 
     ENDFCT
@@ -1196,3 +1818,25 @@ hmpdf_get_map(hmpdf_obj *d, double **map, long *Nside, int new_map)
 }//}}}
 
 
+
+int
+hmpdf_get_mapf(hmpdf_obj *d, float **map, long *Nside, int new_map)
+{//{{{
+    STARTFCT
+
+    // we need to know how large to allocate
+    SAFEHMPDF(create_sidelengths(d));
+
+    if (map != NULL)
+    {
+        SAFEALLOC(*map, malloc(d->m->Nside * d->m->Nside * sizeof(float)));
+        SAFEHMPDF(hmpdf_get_mapf1(d, *map, new_map));
+    }
+
+    if (Nside != NULL)
+    {
+        SAFEHMPDF(_get_Nside(d, Nside));
+    }
+
+    ENDFCT
+}//}}}
@@ -28,6 +28,7 @@ null_numerics(hmpdf_obj *d)
     d->n->lambdagrid_noisy = NULL;
     d->n->phigrid = NULL;
     d->n->phiweights = NULL;
+    d->n->source_bin = -1;
 
     ENDFCT
 }//}}}
@@ -1,10 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <complex.h>
+
 #include <class.h>
 
+#include <fftw3.h>
+
 #include <gsl/gsl_spline.h>
 #include <gsl/gsl_integration.h>
+#include <gsl/gsl_sf_gamma.h>
 
 #include "configs.h"
 #include "utils.h"
@@ -12,6 +17,7 @@
 #include "cosmology.h"
 #include "numerics.h"
 #include "power.h"
+#include "class_cache.h"
 
 #include "hmpdf.h"
 
@@ -21,6 +27,7 @@ null_power(hmpdf_obj *d)
     STARTFCT
 
     d->pwr->inited_power = 0;
+    d->pwr->Pk_lnP = NULL;
     d->pwr->ssq = NULL;
     d->pwr->created_corr = 0;
     d->pwr->corr_interp = NULL;
@@ -47,6 +54,7 @@ reset_power(hmpdf_obj *d)
         }
         free(d->pwr->ssq);
     }
+    if (d->pwr->Pk_lnP != NULL) { free(d->pwr->Pk_lnP); }
     if (d->pwr->corr_interp != NULL) { gsl_spline_free(d->pwr->corr_interp); }
     if (d->pwr->corr_accel != NULL)
     {
@@ -63,16 +71,12 @@ reset_power(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
-int
-Pk_linear(hmpdf_obj *d, double k, double *out)
-// k is logk if LOGK is defined
+static int
+Pk_class(hmpdf_obj *d, double k, double *out)
+// direct call to the CLASS interpolator
 {//{{{
     STARTFCT
 
-    #ifdef LOGK
-    k = exp(k);
-    #endif
-
     struct background *ba = (struct background *)d->cls->ba;
     struct primordial *pm = (struct primordial *)d->cls->pm;
     struct fourier *nl = (struct fourier *)d->cls->nl;
@@ -94,6 +98,142 @@ Pk_linear(hmpdf_obj *d, double k, double *out)
     ENDFCT
 }//}}}
 
+static int
+Pk_user_table(hmpdf_obj *d, double *lnP)
+// resample the user-supplied table on our uniform grid
+{//{{{
+    STARTFCT
+
+    class_interface_t *c = d->cls;
+
+    double *lnk_in, *lnP_in;
+    SAFEALLOC(lnk_in, malloc(c->Pk_N * sizeof(double)));
+    SAFEALLOC(lnP_in, malloc(c->Pk_N * sizeof(double)));
+    for (int ii=0; ii<c->Pk_N; ii++)
+    {
+        lnk_in[ii] = log(c->Pk_k[ii]);
+        lnP_in[ii] = log(c->Pk_P[ii]);
+    }
+
+    interp1d *interp;
+    SAFEHMPDF(new_interp1d(c->Pk_N, lnk_in, lnP_in, lnP_in[0], lnP_in[c->Pk_N-1],
+                           PKINTERP_TYPE, NULL, &interp));
+    for (int ii=0; ii<d->pwr->Pk_N; ii++)
+    {
+        double lnk = d->pwr->Pk_lnkmin + (double)ii * d->pwr->Pk_dlnk;
+        // avoid roundoff pushing us out of range at the edges
+        lnk = GSL_MIN(GSL_MAX(lnk, lnk_in[0]), lnk_in[c->Pk_N-1]);
+        SAFEHMPDF(interp1d_eval(interp, lnk, lnP+ii));
+    }
+
+    delete_interp1d(interp);
+    free(lnk_in);
+    free(lnP_in);
+
+    ENDFCT
+}//}}}
+
+static int
+create_Pk_table(hmpdf_obj *d)
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\tcreate_Pk_table\n");
+
+    d->pwr->Pk_N = PKTAB_N;
+    if (d->cls->use_tables)
+    {
+        d->pwr->Pk_lnkmin = log(d->cls->Pk_k[0]);
+        d->pwr->Pk_lnkmax = log(d->cls->Pk_k[d->cls->Pk_N-1]);
+    }
+    else
+    {
+        struct fourier *nl = (struct fourier *)d->cls->nl;
+        d->pwr->Pk_lnkmin = nl->ln_k[0];
+        // stay clear of the upper boundary, where CLASS returns zero
+        d->pwr->Pk_lnkmax = nl->ln_k[nl->k_size-1] - PKTAB_EDGE_EPS;
+    }
+    d->pwr->Pk_dlnk = (d->pwr->Pk_lnkmax - d->pwr->Pk_lnkmin)
+                      / (double)(d->pwr->Pk_N - 1);
+
+    double *lnP;
+    SAFEALLOC(lnP, malloc(d->pwr->Pk_N * sizeof(double)));
+    if (d->cls->use_tables)
+    {
+        SAFEHMPDF(Pk_user_table(d, lnP));
+    }
+    else
+    {
+        for (int ii=0; ii<d->pwr->Pk_N; ii++)
+        {
+            double lnk = d->pwr->Pk_lnkmin + (double)ii * d->pwr->Pk_dlnk;
+            SAFEHMPDF(Pk_class(d, exp(lnk), lnP+ii));
+            HMPDFCHECK(lnP[ii] <= 0.0, "non-positive linear power spectrum at k = %g", exp(lnk));
+            lnP[ii] = log(lnP[ii]);
+        }
+    }
+
+    d->pwr->Pk_slope_lo = (lnP[1] - lnP[0]) / d->pwr->Pk_dlnk;
+
+    // from now on, Pk_linear uses the table
+    d->pwr->Pk_lnP = lnP;
+
+    ENDFCT
+}//}}}
+
+static inline double
+Pk_table_eval(power_t *pwr, double lnk)
+// 4-point Lagrange interpolation of log P on the uniform grid,
+//     no search required
+{//{{{
+    if (UNLIKELY(lnk < pwr->Pk_lnkmin))
+    {
+        return exp(pwr->Pk_lnP[0] + pwr->Pk_slope_lo * (lnk - pwr->Pk_lnkmin));
+    }
+    if (UNLIKELY(lnk > pwr->Pk_lnkmax))
+    {
+        // consistent with the CLASS interface
+        return 0.0;
+    }
+
+    double x = (lnk - pwr->Pk_lnkmin) / pwr->Pk_dlnk;
+    // the stencil is shifted at the edges
+    int i0 = GSL_MIN(GSL_MAX((int)x - 1, 0), pwr->Pk_N - 4);
+    double t = x - (double)i0;
+    const double *y = pwr->Pk_lnP + i0;
+
+    return exp( - y[0] * (t-1.0)*(t-2.0)*(t-3.0) / 6.0
+                + y[1] * t*(t-2.0)*(t-3.0) / 2.0
+                - y[2] * t*(t-1.0)*(t-3.0) / 2.0
+                + y[3] * t*(t-1.0)*(t-2.0) / 6.0 );
+}//}}}
+
+int
+Pk_linear(hmpdf_obj *d, double k, double *out)
+// k is logk if LOGK is defined
+{//{{{
+    STARTFCT
+
+    if (LIKELY(d->pwr->Pk_lnP != NULL))
+    {
+        #ifdef LOGK
+        *out = Pk_table_eval(d->pwr, k);
+        #else
+        *out = Pk_table_eval(d->pwr, log(k));
+        #endif
+    }
+    else
+    {
+        #ifdef LOGK
+        SAFEHMPDF(Pk_class(d, exp(k), out));
+        #else
+        SAFEHMPDF(Pk_class(d, k, out));
+        #endif
+    }
+
+    ENDFCT
+}//}}}
+
 static int
 power_kernel(hmpdf_obj *d, double k, double *out)
 // kernel = k^2 P(k) / 2\pi^2
@@ -136,18 +276,16 @@ power_integral(hmpdf_obj *d, power_integrand_params *p, double *out)
 
     p->status = 0;
 
-    struct fourier *nl = (struct fourier *)d->cls->nl;
-
     gsl_function integrand;
     integrand.function = &power_integrand;
     integrand.params = p;
     double err;
     #ifdef LOGK
     double kmin = log(PKINTEGR_KMIN);
-    double kmax = nl->ln_k[nl->k_size-1];
+    double kmax = d->pwr->Pk_lnkmax;
     #else
     double kmin = PKINTEGR_KMIN;
-    double kmax = exp(nl->ln_k[nl->k_size-1]);
+    double kmax = exp(d->pwr->Pk_lnkmax);
     #endif
 
     gsl_integration_workspace *ws;
@@ -208,6 +346,170 @@ ssq(hmpdf_obj *d, double M, double *ssq, double *dssq)
     ENDFCT
 }//}}}
 
+static int
+tophat_Wsq_mellin(double q, double eta, double complex *out)
+// Mellin transform int_0^infty dx x^(s-1) W^2(x), s = q + i eta,
+//     of the squared top-hat window, valid for 0 < q < 4
+{//{{{
+    STARTFCT
+
+    // W^2 = 9 pi/2 x^-3 J_{3/2}^2, with lambda = 4 - s
+    double lr = 4.0 - q;
+    double li = -eta;
+    gsl_sf_result lnr1, arg1, lnr2, arg2, lnr3, arg3, lnr4, arg4;
+    SAFEGSL(gsl_sf_lngamma_complex_e(lr, li, &lnr1, &arg1));
+    SAFEGSL(gsl_sf_lngamma_complex_e(2.0-0.5*lr, -0.5*li, &lnr2, &arg2));
+    SAFEGSL(gsl_sf_lngamma_complex_e(0.5*(1.0+lr), 0.5*li, &lnr3, &arg3));
+    SAFEGSL(gsl_sf_lngamma_complex_e(2.0+0.5*lr, 0.5*li, &lnr4, &arg4));
+
+    double complex lnout = log(4.5*M_PI) - (lr + _Complex_I * li) * M_LN2
+                           + lnr1.val + lnr2.val - 2.0*lnr3.val - lnr4.val
+                           + _Complex_I * (arg1.val + arg2.val - 2.0*arg3.val - arg4.val);
+    *out = cexp(lnout);
+
+    ENDFCT
+}//}}}
+
+static int
+ssq_fftlog(hmpdf_obj *d)
+// computes sigma^2(R) and d sigma^2/dlogR on a logarithmic grid with a single FFTLog,
+//     then interpolates to the mass grid
+{//{{{
+    STARTFCT
+
+    double lnkmin = d->pwr->Pk_lnkmin - SSQFFTLOG_PAD;
+    double lnkmax = d->pwr->Pk_lnkmax + SSQFFTLOG_PAD;
+    int N = 2;
+    while ((lnkmax - lnkmin) / (double)(N-1) > SSQFFTLOG_DLNK)
+    {
+        N *= 2;
+    }
+    double dlnk = (lnkmax - lnkmin) / (double)(N-1);
+    // reciprocal output grid
+    double lnR0 = - lnkmax;
+
+    HMPDFPRINT(3, "\t\tusing %d points\n", N);
+
+    double *a;
+    double complex *c, *cprime;
+    SAFEALLOC(a,      fftw_malloc(N * sizeof(double)));
+    SAFEALLOC(c,      fftw_malloc((N/2+1) * sizeof(double complex)));
+    SAFEALLOC(cprime, fftw_malloc((N/2+1) * sizeof(double complex)));
+    fftw_plan r2c = fftw_plan_dft_r2c_1d(N, a, c, FFTW_ESTIMATE);
+    fftw_plan c2r = fftw_plan_dft_c2r_1d(N, c, a, FFTW_ESTIMATE);
+
+    // k^3 P(k) / 2pi^2 k^-q
+    for (int ii=0; ii<N; ii++)
+    {
+        double lnk = lnkmin + (double)ii * dlnk;
+        #ifdef LOGK
+        SAFEHMPDF(Pk_linear(d, lnk, a+ii));
+        #else
+        SAFEHMPDF(Pk_linear(d, exp(lnk), a+ii));
+        #endif
+        a[ii] *= exp((3.0-SSQFFTLOG_Q) * lnk) / 2.0 / M_PI / M_PI;
+    }
+
+    fftw_execute(r2c);
+
+    for (int m=0; m<=N/2; m++)
+    {
+        double eta = 2.0 * M_PI * (double)m / ((double)N * dlnk);
+        double complex u;
+        SAFEHMPDF(tophat_Wsq_mellin(SSQFFTLOG_Q, eta, &u));
+        // phase shift due to the offset of the output grid
+        u *= cexp(_Complex_I * eta * (double)(N-1) * dlnk);
+        // conjugation reverses the sign of the exponent in the c2r
+        cprime[m] = conj(-(SSQFFTLOG_Q + _Complex_I * eta) * c[m] * u);
+        c[m] = conj(c[m] * u);
+    }
+    // the Nyquist frequency needs to be real
+    c[N/2] = creal(c[N/2]);
+    cprime[N/2] = creal(cprime[N/2]);
+
+    // the range of radii we need, with a few points margin for the spline
+    double Rmin = cbrt(3.0*d->n->Mgrid[0]/4.0/M_PI/d->c->rho_m_0);
+    double Rmax = cbrt(3.0*d->n->Mgrid[d->n->NM-1]/4.0/M_PI/d->c->rho_m_0);
+    int nlo = (int)floor((log(Rmin) - lnR0) / dlnk) - 3;
+    int nhi = (int)ceil((log(Rmax) - lnR0) / dlnk) + 3;
+    HMPDFCHECK(nlo*dlnk < SSQFFTLOG_PAD || (N-1-nhi)*dlnk < SSQFFTLOG_PAD,
+               "mass range not covered by the FFTLog grid.");
+
+    int Nout = nhi - nlo + 1;
+    double *lnR, *lnssq, *dssq;
+    SAFEALLOC(lnR,   malloc(Nout * sizeof(double)));
+    SAFEALLOC(lnssq, malloc(Nout * sizeof(double)));
+    SAFEALLOC(dssq,  malloc(Nout * sizeof(double)));
+
+    fftw_execute(c2r);
+    for (int ii=0; ii<Nout; ii++)
+    {
+        lnR[ii] = lnR0 + (double)(nlo+ii) * dlnk;
+        double s = a[nlo+ii] * exp(-SSQFFTLOG_Q * lnR[ii]) / (double)N;
+        HMPDFCHECK(s <= 0.0, "sigma^2 not positive.");
+        lnssq[ii] = log(s);
+    }
+
+    fftw_execute_dft_c2r(c2r, cprime, a);
+    for (int ii=0; ii<Nout; ii++)
+    {
+        dssq[ii] = a[nlo+ii] * exp(-SSQFFTLOG_Q * lnR[ii]) / (double)N;
+    }
+
+    fftw_destroy_plan(r2c);
+    fftw_destroy_plan(c2r);
+    fftw_free(a);
+    fftw_free(c);
+    fftw_free(cprime);
+
+    interp1d *ssq_interp, *dssq_interp;
+    SAFEHMPDF(new_interp1d(Nout, lnR, lnssq, 0.0, 0.0, SSQINTERP_TYPE, NULL, &ssq_interp));
+    SAFEHMPDF(new_interp1d(Nout, lnR, dssq, 0.0, 0.0, SSQINTERP_TYPE, NULL, &dssq_interp));
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        double lnR1 = log(cbrt(3.0*d->n->Mgrid[M_index]/4.0/M_PI/d->c->rho_m_0));
+        SAFEHMPDF(interp1d_eval(ssq_interp, lnR1, d->pwr->ssq[M_index]+0));
+        d->pwr->ssq[M_index][0] = exp(d->pwr->ssq[M_index][0]);
+        SAFEHMPDF(interp1d_eval(dssq_interp, lnR1, d->pwr->ssq[M_index]+1));
+        // d/dlogM = 1/3 d/dlogR
+        d->pwr->ssq[M_index][1] /= 3.0;
+    }
+
+    delete_interp1d(ssq_interp);
+    delete_interp1d(dssq_interp);
+    free(lnR);
+    free(lnssq);
+    free(dssq);
+
+    ENDFCT
+}//}}}
+
+static int
+check_ssq_fftlog(hmpdf_obj *d, int *ok)
+// compares with direct integration for a few masses
+{//{{{
+    STARTFCT
+
+    *ok = 1;
+
+    for (int ii=0; ii<SSQFFTLOG_NCHECK; ii++)
+    {
+        int M_index = (ii * (d->n->NM-1)) / GSL_MAX(1, SSQFFTLOG_NCHECK-1);
+        double s, ds;
+        SAFEHMPDF(ssq(d, d->n->Mgrid[M_index], &s, &ds));
+
+        double err = GSL_MAX(fabs(d->pwr->ssq[M_index][0]/s - 1.0),
+                             fabs(d->pwr->ssq[M_index][1]/ds - 1.0));
+        HMPDFPRINT(3, "\t\tFFTLog sigma^2 error at M = %g Msun/h : %g\n",
+                      d->n->Mgrid[M_index]*d->c->h, err);
+
+        if (err > SSQFFTLOG_TOL) { *ok = 0; }
+    }
+
+    ENDFCT
+}//}}}
+
 static int
 create_ssq(hmpdf_obj *d)
 {//{{{
@@ -220,6 +522,24 @@ create_ssq(hmpdf_obj *d)
     for (int M_index=0; M_index<d->n->NM; M_index++)
     {
         SAFEALLOC(d->pwr->ssq[M_index], malloc(2 * sizeof(double)));
+    }
+
+    if (d->pwr->ssq_fftlog)
+    {
+        SAFEHMPDF(ssq_fftlog(d));
+
+        int ok;
+        SAFEHMPDF(check_ssq_fftlog(d, &ok));
+        if (ok) { return 0; }
+
+        // not an error, since we can recover
+        //     (HMPDFWARN would abort the run if warn_is_err is set)
+        HMPDFPRINT(0, "WARNING: FFTLog computation of sigma^2 not accurate enough, "
+                      "using direct integration.\n");
+    }
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
         SAFEHMPDF(ssq(d, d->n->Mgrid[M_index],
                       d->pwr->ssq[M_index]+0,
                       d->pwr->ssq[M_index]+1));
@@ -264,52 +584,119 @@ create_autocorr(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
+static int
+J0_mellin(double q, double eta, double complex *out)
+// Mellin transform int_0^infty dx x^(s-1) J_0(x), s = q + i eta,
+//     valid for 0 < q < 3/2
+{//{{{
+    STARTFCT
+
+    gsl_sf_result lnr1, arg1, lnr2, arg2;
+    SAFEGSL(gsl_sf_lngamma_complex_e(0.5*q, 0.5*eta, &lnr1, &arg1));
+    SAFEGSL(gsl_sf_lngamma_complex_e(1.0-0.5*q, -0.5*eta, &lnr2, &arg2));
+
+    double complex lnout = (q - 1.0 + _Complex_I * eta) * M_LN2
+                           + lnr1.val - lnr2.val
+                           + _Complex_I * (arg1.val - arg2.val);
+    *out = cexp(lnout);
+
+    ENDFCT
+}//}}}
+
 int
 create_corr(hmpdf_obj *d)
 // computes the z=0 matter correlation function
+//     zeta(r) = 1/2pi int dk k P(k) J_0(kr)
+//     with a single FFTLog over the whole tabulated k-range,
+//     so the result covers all pixel separations and source redshifts
 {//{{{
     STARTFCT
 
     if (d->pwr->created_corr) { return 0; }
 
     HMPDFPRINT(2, "\tcreate_corr_interp\n");
-    
-    d->pwr->corr_rmax = 1.1 * d->n->phimax * d->c->comoving[d->n->Nz-1];
-    gsl_dht *t;
-    SAFEALLOC(t, gsl_dht_new(CORRINTERP_N, 0, d->pwr->corr_rmax));
-    double *Pk;
-    double *r;
-    double *zeta;
-    SAFEALLOC(Pk,   malloc(CORRINTERP_N     * sizeof(double)));
-    SAFEALLOC(r,    malloc((CORRINTERP_N+1) * sizeof(double)));
-    SAFEALLOC(zeta, malloc((CORRINTERP_N+1) * sizeof(double)));
-    r[0] = 0.0;
-    zeta[0] = d->pwr->autocorr;
 
-    double hankel_norm = gsl_pow_2(gsl_dht_k_sample(t, 0)
-                                   / gsl_dht_x_sample(t, 0));
-    for (int ii=0; ii<CORRINTERP_N; ii++)
+    double lnkmin = d->pwr->Pk_lnkmin - CORRFFTLOG_PAD;
+    double lnkmax = d->pwr->Pk_lnkmax + CORRFFTLOG_PAD;
+    int N = 2;
+    while ((lnkmax - lnkmin) / (double)(N-1) > CORRFFTLOG_DLNK)
     {
+        N *= 2;
+    }
+    double dlnk = (lnkmax - lnkmin) / (double)(N-1);
+    // reciprocal output grid
+    double lnr0 = - lnkmax;
+
+    HMPDFPRINT(3, "\t\tusing %d points\n", N);
+
+    double *a;
+    double complex *c;
+    SAFEALLOC(a, fftw_malloc(N * sizeof(double)));
+    SAFEALLOC(c, fftw_malloc((N/2+1) * sizeof(double complex)));
+    fftw_plan r2c = fftw_plan_dft_r2c_1d(N, a, c, FFTW_ESTIMATE);
+    fftw_plan c2r = fftw_plan_dft_c2r_1d(N, c, a, FFTW_ESTIMATE);
+
+    // k^2 P(k) / 2pi k^-q
+    for (int ii=0; ii<N; ii++)
+    {
+        double lnk = lnkmin + (double)ii * dlnk;
         #ifdef LOGK
-        double k = log(gsl_dht_k_sample(t, ii));
+        SAFEHMPDF(Pk_linear(d, lnk, a+ii));
         #else
-        double k = gsl_dht_k_sample(t, ii);
+        SAFEHMPDF(Pk_linear(d, exp(lnk), a+ii));
         #endif
-        SAFEHMPDF(Pk_linear(d, k, Pk+ii));
-        r[ii+1] = gsl_dht_x_sample(t, ii);
+        a[ii] *= exp((2.0-CORRFFTLOG_Q) * lnk) / 2.0 / M_PI;
+
+        // the power spectrum is cut off at the end of the table,
+        //     smooth this to avoid ringing
+        double x = (lnk - (d->pwr->Pk_lnkmax - CORRFFTLOG_TAPER)) / CORRFFTLOG_TAPER;
+        if (x > 0.0)
+        {
+            a[ii] *= (x < 1.0) ? 0.5 * (1.0 + cos(M_PI * x)) : 0.0;
+        }
     }
-    SAFEGSL(gsl_dht_apply(t, Pk, zeta+1));
-    gsl_dht_free(t);
-    free(Pk);
 
-    // divide by 2\pi and fix Hankel normalization
-    for (int ii=1; ii<=CORRINTERP_N; ii++)
+    fftw_execute(r2c);
+
+    for (int m=0; m<=N/2; m++)
     {
-        zeta[ii] *= 0.5 * M_1_PI * hankel_norm;
+        double eta = 2.0 * M_PI * (double)m / ((double)N * dlnk);
+        double complex u;
+        SAFEHMPDF(J0_mellin(CORRFFTLOG_Q, eta, &u));
+        // phase shift due to the offset of the output grid
+        u *= cexp(_Complex_I * eta * (double)(N-1) * dlnk);
+        // conjugation reverses the sign of the exponent in the c2r
+        c[m] = conj(c[m] * u);
     }
+    // the Nyquist frequency needs to be real
+    c[N/2] = creal(c[N/2]);
+
+    fftw_execute(c2r);
+
+    // discard the padding, where the result is affected by the periodicity
+    int nlo = (int)ceil(CORRFFTLOG_PAD / dlnk);
+    int Nout = N - 2 * nlo;
+    double *lnr;
+    double *zeta;
+    SAFEALLOC(lnr,  malloc(Nout * sizeof(double)));
+    SAFEALLOC(zeta, malloc(Nout * sizeof(double)));
+    for (int ii=0; ii<Nout; ii++)
+    {
+        lnr[ii] = lnr0 + (double)(nlo+ii) * dlnk;
+        zeta[ii] = a[nlo+ii] * exp(-CORRFFTLOG_Q * lnr[ii]) / (double)N;
+    }
+
+    fftw_destroy_plan(r2c);
+    fftw_destroy_plan(c2r);
+    fftw_free(a);
+    fftw_free(c);
+
+    d->pwr->corr_rmin = exp(lnr[0]);
+    d->pwr->corr_rmax = exp(lnr[Nout-1]);
+    d->pwr->corr_zeta0 = zeta[0];
 
     SAFEALLOC(d->pwr->corr_interp,
-              gsl_spline_alloc(gsl_interp_cspline, CORRINTERP_N+1));
+              gsl_spline_alloc(interp1d_type(CORRINTERP_TYPE), Nout));
     d->pwr->Ncorr_accel = d->Ncores;
     SAFEALLOC(d->pwr->corr_accel,
               malloc(d->pwr->Ncorr_accel * sizeof(gsl_interp_accel *)));
@@ -318,9 +705,8 @@ create_corr(hmpdf_obj *d)
     {
         SAFEALLOC(d->pwr->corr_accel[ii], gsl_interp_accel_alloc());
     }
-    SAFEGSL(gsl_spline_init(d->pwr->corr_interp, r,
-                            zeta, CORRINTERP_N+1));
-    free(r);
+    SAFEGSL(gsl_spline_init(d->pwr->corr_interp, lnr, zeta, Nout));
+    free(lnr);
     free(zeta);
 
     d->pwr->created_corr = 1;
@@ -335,14 +721,22 @@ corr(hmpdf_obj *d, int z_index, double phi, double *out)
 
     double r = d->c->comoving[z_index] * phi;
 
-    HMPDFCHECK(r > d->pwr->corr_rmax,
-               "phi value out of interpolation range.\n"
-               "\tIt is suggested you increase hmpdf_phimax\n"
-               "\tor check the units.");
-
-    SAFEGSL(gsl_spline_eval_e(d->pwr->corr_interp, r,
-                              d->pwr->corr_accel[THIS_THREAD],
-                              out));
+    // the grid extends to 1/k_min and 1/k_max of the power spectrum table,
+    //     outside the correlation function is constant and zero, respectively
+    if (r < d->pwr->corr_rmin)
+    {
+        *out = d->pwr->corr_zeta0;
+    }
+    else if (r > d->pwr->corr_rmax)
+    {
+        *out = 0.0;
+    }
+    else
+    {
+        SAFEGSL(gsl_spline_eval_e(d->pwr->corr_interp, log(r),
+                                  d->pwr->corr_accel[THIS_THREAD],
+                                  out));
+    }
     *out *= d->c->Dsq[z_index];
     
     ENDFCT
@@ -355,6 +749,13 @@ init_power(hmpdf_obj *d)
 
     HMPDFPRINT(1, "init_power\n");
 
+    if (d->cls->from_cache)
+    {
+        SAFEHMPDF(class_cache_power(d));
+        return 0;
+    }
+
+    SAFEHMPDF(create_Pk_table(d));
     SAFEHMPDF(create_ssq(d));
     SAFEHMPDF(create_autocorr(d));
 
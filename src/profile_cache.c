@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "configs.h"
+#include "utils.h"
+#include "object.h"
+#include "power.h"
+#include "profiles.h"
+#include "profile_cache.h"
+
+#include "hmpdf.h"
+
+typedef struct
+{//{{{
+    char magic[8]; // "HMPDFPRC"
+    uint64_t key;
+    int Nz;
+    int NM;
+    long stride; // length of each profile
+}//}}}
+cache_header_t;
+
+static const char *
+cache_name(profile_cache_e which)
+{//{{{
+    switch (which)
+    {
+        case cache_profiles          : return "profiles";
+        case cache_conj_profiles     : return "conj_profiles";
+        case cache_filtered_profiles : return "filtered_profiles";
+        default                      : return NULL;
+    }
+}//}}}
+
+static double ****
+cache_target(hmpdf_obj *d, profile_cache_e which, long *stride)
+{//{{{
+    switch (which)
+    {
+        case cache_profiles          : *stride = d->p->Ntheta + 2;
+                                       return &(d->p->profiles);
+        case cache_conj_profiles     : *stride = d->p->Ntheta + 1;
+                                       return &(d->p->conj_profiles);
+        case cache_filtered_profiles : *stride = d->p->Ntheta + 2;
+                                       return &(d->p->filtered_profiles);
+        default                      : return NULL;
+    }
+}//}}}
+
+static int
+cache_key(hmpdf_obj *d, profile_cache_e which, int *cacheable, uint64_t *key)
+// hashes everything the profiles depend on
+{//{{{
+    STARTFCT
+
+    // we cannot hash user-supplied functions,
+    // and the tot_profiles output is a side effect of create_profiles
+    *cacheable = d->p->mass_resc == NULL
+                 && d->h->conc_resc == NULL
+                 && d->p->tot_profiles_N == 0;
+    if (which == cache_filtered_profiles)
+    {
+        *cacheable = *cacheable
+                     && d->f->custom_ell == NULL
+                     && d->f->custom_k == NULL;
+    }
+    if (!*cacheable) { return 0; }
+
+    uint64_t h = HASH_INIT;
+    int version = PROFCACHE_VERSION;
+    HASH_VAL(h, version);
+    HASH_VAL(h, which);
+
+    // numerics
+    HASH_VAL(h, d->n->Nz);
+    HASH_VAL(h, d->n->NM);
+    HASH_ARR(h, d->n->zgrid, d->n->Nz);
+    HASH_ARR(h, d->n->Mgrid, d->n->NM);
+    HASH_ARR(h, d->n->signalgrid, 2); // sets the integration tolerance
+    HASH_VAL(h, d->p->Ntheta);
+
+    // background cosmology
+    HASH_VAL(h, d->c->h);
+    HASH_VAL(h, d->c->Om_0);
+    HASH_VAL(h, d->c->Ob_0);
+    HASH_VAL(h, d->c->rho_c_0);
+    HASH_ARR(h, d->c->angular_diameter, d->n->Nz);
+    HASH_ARR(h, d->c->invScrit, d->n->Nz);
+    HASH_ARR(h, d->c->rho_m, d->n->Nz);
+    HASH_ARR(h, d->c->rho_c, d->n->Nz);
+
+    // halo model
+    HASH_ARR(h, d->h->Duffy08_params, 12);
+    if (d->h->DM_conc_params != NULL) { HASH_ARR(h, d->h->DM_conc_params, 12); }
+    if (d->h->bar_conc_params != NULL) { HASH_ARR(h, d->h->bar_conc_params, 12); }
+
+    // profile options
+    HASH_VAL(h, d->p->stype);
+    HASH_VAL(h, d->p->rout_scale);
+    HASH_VAL(h, d->p->rout_def);
+    HASH_ARR(h, d->p->Battaglia12_params, 15);
+    HASH_VAL(h, d->p->mass_z_fix);
+    HASH_VAL(h, d->p->min_mass_fix);
+    HASH_VAL(h, d->p->max_z_fix);
+    HASH_VAL(h, d->p->tsz_table);
+    HASH_VAL(h, d->p->los_fixed_order);
+    HASH_VAL(h, d->p->Mstride);
+    HASH_VAL(h, d->p->theta_adaptive);
+    // the requested option, not whether the Abel projection fell back
+    //     (which is decided only when the profiles are computed)
+    HASH_VAL(h, d->p->bcm_abel);
+
+    // baryonic correction model, which also depends on the linear power spectrum
+    if (d->bcm->Arico20_params != NULL)
+    {
+        HASH_VAL(h, d->bcm->Arico20_Nz);
+        HASH_ARR(h, d->bcm->Arico20_params, d->bcm->Arico20_Nz * hmpdf_Arico20_Nparams);
+        if (d->bcm->Arico20_z != NULL)
+        {
+            HASH_ARR(h, d->bcm->Arico20_z, d->bcm->Arico20_Nz);
+        }
+        for (int ii=0; ii<PROFCACHE_NPK; ii++)
+        {
+            double logk = log(PROFCACHE_KMIN)
+                          + (double)ii * log(PROFCACHE_KMAX/PROFCACHE_KMIN)
+                            / (double)(PROFCACHE_NPK-1);
+            double Pk;
+            #ifdef LOGK
+            SAFEHMPDF(Pk_linear(d, logk, &Pk));
+            #else
+            SAFEHMPDF(Pk_linear(d, exp(logk), &Pk));
+            #endif
+            HASH_VAL(h, Pk);
+        }
+    }
+
+    if (which == cache_conj_profiles || which == cache_filtered_profiles)
+    {
+        HASH_VAL(h, d->p->fftlog);
+    }
+
+    if (which == cache_filtered_profiles)
+    {
+        HASH_VAL(h, d->f->Nfilters);
+        HASH_VAL(h, d->f->pixelside);
+        HASH_VAL(h, d->f->tophat_radius);
+        HASH_VAL(h, d->f->gaussian_sigma);
+    }
+
+    *key = h;
+
+    ENDFCT
+}//}}}
+
+static int
+cache_fname(hmpdf_obj *d, profile_cache_e which, uint64_t key, char **fname)
+{//{{{
+    STARTFCT
+
+    size_t len = strlen(d->p->cache_dir) + 64;
+    SAFEALLOC(*fname, malloc(len));
+    snprintf(*fname, len, "%s/%s_%016llx.bin",
+             d->p->cache_dir, cache_name(which), (unsigned long long)key);
+
+    ENDFCT
+}//}}}
+
+int
+profile_cache_load(hmpdf_obj *d, profile_cache_e which, int *found)
+// if a matching cache file exists, allocates and fills the target
+{//{{{
+    STARTFCT
+
+    *found = 0;
+
+    int cacheable;
+    uint64_t key;
+    SAFEHMPDF(cache_key(d, which, &cacheable, &key));
+    if (!cacheable) { return 0; }
+
+    char *fname;
+    SAFEHMPDF(cache_fname(d, which, key, &fname));
+
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0)
+    {
+        HMPDFPRINT(3, "\t\t%s not found in cache\n", cache_name(which));
+        free(fname);
+        return 0;
+    }
+
+    long stride;
+    double ****target = cache_target(d, which, &stride);
+
+    // check that the file is complete
+    struct stat st;
+    size_t len = sizeof(cache_header_t)
+                 + (size_t)(d->n->Nz * d->n->NM * stride) * sizeof(double);
+    if (fstat(fd, &st) || (size_t)st.st_size != len)
+    {
+        HMPDFPRINT(1, "\t\tprofile cache file %s has wrong size, ignoring it.\n", fname);
+        close(fd);
+        free(fname);
+        return 0;
+    }
+
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        HMPDFPRINT(1, "\t\tfailed to mmap %s, ignoring it.\n", fname);
+        free(fname);
+        errno = 0;
+        return 0;
+    }
+
+    cache_header_t *hdr = (cache_header_t *)map;
+    if (memcmp(hdr->magic, "HMPDFPRC", 8) || hdr->key != key
+        || hdr->Nz != d->n->Nz || hdr->NM != d->n->NM || hdr->stride != stride)
+    {
+        HMPDFPRINT(1, "\t\tprofile cache file %s is inconsistent, ignoring it.\n", fname);
+        munmap(map, len);
+        free(fname);
+        return 0;
+    }
+
+    // the profiles are stored in a single slab, so we can copy in one go
+    SAFEHMPDF(new_profile_slab(d, stride, target));
+    memcpy((*target)[0][0], (char *)map + sizeof(cache_header_t),
+           len - sizeof(cache_header_t));
+
+    munmap(map, len);
+
+    HMPDFPRINT(2, "\t\tloaded %s from %s\n", cache_name(which), fname);
+    free(fname);
+
+    *found = 1;
+
+    ENDFCT
+}//}}}
+
+int
+profile_cache_save(hmpdf_obj *d, profile_cache_e which)
+// writes to a temporary file first and renames it,
+//     so concurrent processes never see an incomplete file
+{//{{{
+    STARTFCT
+
+    int cacheable;
+    uint64_t key;
+    SAFEHMPDF(cache_key(d, which, &cacheable, &key));
+    if (!cacheable) { return 0; }
+
+    if (mkdir(d->p->cache_dir, 0755) && errno != EEXIST)
+    {
+        HMPDFPRINT(1, "\t\tfailed to create profile cache directory %s, "
+                      "not saving.\n", d->p->cache_dir);
+        errno = 0;
+        return 0;
+    }
+    errno = 0;
+
+    char *fname;
+    SAFEHMPDF(cache_fname(d, which, key, &fname));
+    char *tmpname;
+    SAFEALLOC(tmpname, malloc(strlen(fname) + 32));
+    sprintf(tmpname, "%s.tmp.%ld", fname, (long)getpid());
+
+    long stride;
+    double ****target = cache_target(d, which, &stride);
+
+    FILE *fp = fopen(tmpname, "wb");
+    if (fp == NULL)
+    {
+        HMPDFPRINT(1, "\t\tfailed to open %s for writing, not saving.\n", tmpname);
+        free(fname);
+        free(tmpname);
+        errno = 0;
+        return 0;
+    }
+
+    cache_header_t hdr;
+    memset(&hdr, 0, sizeof(cache_header_t));
+    memcpy(hdr.magic, "HMPDFPRC", 8);
+    hdr.key = key;
+    hdr.Nz = d->n->Nz;
+    hdr.NM = d->n->NM;
+    hdr.stride = stride;
+
+    size_t written = fwrite(&hdr, sizeof(cache_header_t), 1, fp);
+    written += fwrite((*target)[0][0], sizeof(double),
+                      d->n->Nz * d->n->NM * stride, fp);
+    fclose(fp);
+
+    if (written != 1 + (size_t)(d->n->Nz * d->n->NM * stride)
+        || rename(tmpname, fname))
+    {
+        remove(tmpname);
+        HMPDFPRINT(1, "\t\tfailed to write profile cache file %s.\n", fname);
+        errno = 0;
+    }
+    else
+    {
+        HMPDFPRINT(2, "\t\twrote %s to %s\n", cache_name(which), fname);
+    }
+
+    free(fname);
+    free(tmpname);
+
+    ENDFCT
+}//}}}
@@ -14,6 +14,9 @@
 #include <gsl/gsl_dht.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_fit.h>
+#include <gsl/gsl_sf_gamma.h>
+
+#include <fftw3.h>
 
 #include "configs.h"
 #include "utils.h"
@@ -23,6 +26,7 @@
 #include "filter.h"
 #include "bcm.h"
 #include "profiles.h"
+#include "profile_cache.h"
 
 #include "hmpdf.h"
 
@@ -39,19 +43,52 @@ null_profiles(hmpdf_obj *d)
     d->p->reci_tgrid = NULL;
     d->p->created_segments = 0;
     d->p->segment_boundaries = NULL;
+    d->p->segment_offsets = NULL;
     d->p->dht_ws = NULL;
     d->p->profiles = NULL;
     d->p->created_conj_profiles = 0;
     d->p->conj_profiles = NULL;
     d->p->created_filtered_profiles = 0;
     d->p->filtered_profiles = NULL;
+    d->p->created_pixelavg_profiles = 0;
+    d->p->pixelavg_profiles = NULL;
+    d->p->bcm_abel_fallback = 0;
+    d->p->created_gnfw_tables = 0;
+    d->p->Ngnfw_tables = 0;
+    d->p->gnfw_tables = NULL;
+    d->p->losquad_x = NULL;
+    d->p->fftlog_u = NULL;
+    d->p->fftlog_r2c = NULL;
+    d->p->fftlog_c2r = NULL;
+    d->p->losquad_w = NULL;
     d->p->incr_tgrid_accel = NULL;
     d->p->reci_tgrid_accel = NULL;
     d->p->tot_profiles_indices = NULL;
+    d->p->zM_cost = NULL;
 
     ENDFCT
 }//}}}
 
+static void
+free_segments(hmpdf_obj *d)
+// the segments depend on the profile normalization,
+//     so they are also freed when the profiles are rescaled
+{//{{{
+    if (d->p->segment_boundaries != NULL)
+    {
+        free(d->p->segment_boundaries[0][0]); // the slab
+        free(d->p->segment_boundaries[0]);
+        free(d->p->segment_boundaries);
+        d->p->segment_boundaries = NULL;
+    }
+    if (d->p->segment_offsets != NULL)
+    {
+        free(d->p->segment_offsets);
+        d->p->segment_offsets = NULL;
+    }
+    d->p->created_segments = 0;
+}//}}}
+
 int
 reset_profiles(hmpdf_obj *d)
 {//{{{
@@ -75,85 +112,112 @@ reset_profiles(hmpdf_obj *d)
         }
         free(d->p->incr_tgrid_accel);
     }
-    if (d->p->reci_tgrid_accel != NULL) { gsl_interp_accel_free(d->p->reci_tgrid_accel); }
-    if (d->p->profiles != NULL)
+    if (d->p->reci_tgrid_accel != NULL)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        for (int ii=0; ii<d->Ncores; ii++)
         {
-            if (d->p->profiles[z_index] != NULL)
+            if (d->p->reci_tgrid_accel[ii] != NULL)
             {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
-                {
-                    if (d->p->profiles[z_index][M_index] != NULL)
-                    {
-                        free(d->p->profiles[z_index][M_index]);
-                    }
-                }
-                free(d->p->profiles[z_index]);
+                gsl_interp_accel_free(d->p->reci_tgrid_accel[ii]);
             }
         }
-        free(d->p->profiles);
+        free(d->p->reci_tgrid_accel);
     }
-    if (d->p->conj_profiles != NULL)
+    if (d->p->profiles != NULL) { delete_profile_slab(d->p->profiles); }
+    if (d->p->conj_profiles != NULL) { delete_profile_slab(d->p->conj_profiles); }
+    if (d->p->filtered_profiles != NULL) { delete_profile_slab(d->p->filtered_profiles); }
+    if (d->p->pixelavg_profiles != NULL) { delete_profile_slab(d->p->pixelavg_profiles); }
+    free_segments(d);
+    if (d->p->gnfw_tables != NULL)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        for (int ii=0; ii<d->p->Ngnfw_tables; ii++)
         {
-            if (d->p->conj_profiles[z_index] != NULL)
+            gnfw_table_t *t = d->p->gnfw_tables + ii;
+            if (t->tabs != NULL)
             {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
+                for (int jj=0; jj<t->Nbeta; jj++)
                 {
-                    if (d->p->conj_profiles[z_index][M_index] != NULL)
-                    {
-                        free(d->p->conj_profiles[z_index][M_index]);
-                    }
+                    if (t->tabs[jj] != NULL) { gsl_spline2d_free(t->tabs[jj]); }
                 }
-                free(d->p->conj_profiles[z_index]);
+                free(t->tabs);
             }
         }
-        free(d->p->conj_profiles);
+        free(d->p->gnfw_tables);
     }
-    if (d->p->filtered_profiles != NULL)
+    if (d->p->losquad_x != NULL) { free(d->p->losquad_x); }
+    if (d->p->losquad_w != NULL) { free(d->p->losquad_w); }
+    if (d->p->dht_ws != NULL) { gsl_dht_free(d->p->dht_ws); }
+    if (d->p->fftlog_u != NULL) { free(d->p->fftlog_u); }
+    if (d->p->fftlog_r2c != NULL)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
-        {
-            if (d->p->filtered_profiles[z_index] != NULL)
-            {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
-                {
-                    if (d->p->filtered_profiles[z_index][M_index] != NULL)
-                    {
-                        free(d->p->filtered_profiles[z_index][M_index]);
-                    }
-                }
-                free(d->p->filtered_profiles[z_index]);
-            }
-        }
-        free(d->p->filtered_profiles);
+        fftw_destroy_plan(*(d->p->fftlog_r2c));
+        free(d->p->fftlog_r2c);
     }
-    if (d->p->segment_boundaries != NULL)
+    if (d->p->fftlog_c2r != NULL)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
-        {
-            if (d->p->segment_boundaries[z_index] != NULL)
-            {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
-                {
-                    if (d->p->segment_boundaries[z_index][M_index] != NULL)
-                    {
-                        free(d->p->segment_boundaries[z_index][M_index]);
-                    }
-                }
-                free(d->p->segment_boundaries[z_index]);
-            }
-        }
-        free(d->p->segment_boundaries);
+        fftw_destroy_plan(*(d->p->fftlog_c2r));
+        free(d->p->fftlog_c2r);
     }
-    if (d->p->dht_ws != NULL) { gsl_dht_free(d->p->dht_ws); }
     if (d->p->tot_profiles_indices != NULL) { free(d->p->tot_profiles_indices); }
+    if (d->p->zM_cost != NULL) { free(d->p->zM_cost); }
+
+    ENDFCT
+}//}}}
+
+// frees whatever new_profile_slab already holds if an allocation fails
+#define NEWPRSLAB_SAFEALLOC(var, expr)                             \
+    do {                                                           \
+        var = expr;                                                \
+        if (UNLIKELY(!(var)))                                      \
+        {                                                          \
+            free(slab);                                            \
+            if (ptrs != NULL)                                      \
+            { free(ptrs); }                                        \
+            HMPDFERR_NORETURN("failed to allocate profile slab."); \
+            return 1;                                              \
+        }                                                          \
+    } while (0)
+
+int
+new_profile_slab(hmpdf_obj *d, long stride, double ****out)
+// allocates Nz x NM arrays of length stride in a single aligned block,
+//     (*out)[z_index][M_index] = (*out)[0][0] + (z_index*NM + M_index) * stride
+{//{{{
+    STARTFCT
+
+    void *slab;
+    if (UNLIKELY(posix_memalign(&slab, PRSLAB_ALIGN,
+                                d->n->Nz * d->n->NM * stride * sizeof(double))))
+    {
+        HMPDFERR_NORETURN("failed to allocate profile slab.");
+        return 1;
+    }
+    double **ptrs = NULL;
+    NEWPRSLAB_SAFEALLOC(ptrs, malloc(d->n->Nz * d->n->NM * sizeof(double *)));
+    NEWPRSLAB_SAFEALLOC(*out, malloc(d->n->Nz * sizeof(double **)));
+
+    for (int ii=0; ii<d->n->Nz * d->n->NM; ii++)
+    {
+        ptrs[ii] = (double *)slab + ii * stride;
+    }
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
+        (*out)[z_index] = ptrs + z_index * d->n->NM;
+    }
 
     ENDFCT
 }//}}}
 
+#undef NEWPRSLAB_SAFEALLOC
+
+void
+delete_profile_slab(double ***x)
+{//{{{
+    free(x[0][0]); // the slab
+    free(x[0]);    // the pointer table
+    free(x);
+}//}}}
+
 static int
 create_angle_grids(hmpdf_obj *d)
 {//{{{
@@ -191,11 +255,14 @@ create_angle_grids(hmpdf_obj *d)
     SAFEALLOC(d->p->incr_tgrid_accel,
               malloc(d->Ncores * sizeof(gsl_interp_accel *)));
     SETARRNULL(d->p->incr_tgrid_accel, d->Ncores);
+    SAFEALLOC(d->p->reci_tgrid_accel,
+              malloc(d->Ncores * sizeof(gsl_interp_accel *)));
+    SETARRNULL(d->p->reci_tgrid_accel, d->Ncores);
     for (int ii=0; ii<d->Ncores; ii++)
     {
         SAFEALLOC(d->p->incr_tgrid_accel[ii], gsl_interp_accel_alloc());
+        SAFEALLOC(d->p->reci_tgrid_accel[ii], gsl_interp_accel_alloc());
     }
-    SAFEALLOC(d->p->reci_tgrid_accel, gsl_interp_accel_alloc());
 
     ENDFCT
 }//}}}
@@ -308,6 +375,144 @@ kappa_profile(hmpdf_obj *d, int z_index, int M_index,
     ENDFCT
 }//}}}
 
+// fixed-order line-of-sight quadrature {{{
+typedef int (*los_integrand_f)(hmpdf_obj *, void *, long, double *, double *);
+
+static int
+create_losquad(hmpdf_obj *d)
+// Gauss-Legendre nodes and weights on [0,1],
+//     first LOSQUAD_N high order ones, then LOSQUAD_N/2 low order ones
+{//{{{
+    STARTFCT
+
+    if (!d->p->los_fixed_order) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_losquad\n");
+
+    int Nq = LOSQUAD_N + LOSQUAD_N/2;
+    SAFEALLOC(d->p->losquad_x, malloc(Nq * sizeof(double)));
+    SAFEALLOC(d->p->losquad_w, malloc(Nq * sizeof(double)));
+
+    int N[2] = { LOSQUAD_N, LOSQUAD_N/2, };
+    for (int ii=0, offset=0; ii<2; offset+=N[ii++])
+    {
+        gsl_integration_glfixed_table *t;
+        SAFEALLOC(t, gsl_integration_glfixed_table_alloc(N[ii]));
+        for (int jj=0; jj<N[ii]; jj++)
+        {
+            SAFEGSL(gsl_integration_glfixed_point(0.0, 1.0, jj,
+                                                  d->p->losquad_x+offset+jj,
+                                                  d->p->losquad_w+offset+jj, t));
+        }
+        gsl_integration_glfixed_table_free(t);
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+los_batch(hmpdf_obj *d, int N, double *rproj, double *lout,
+          los_integrand_f f, void *params, double epsabs,
+          double *out, int *fallback)
+// computes int_0^lout dz f(sqrt(z^2 + rproj^2)) for N projected radii at once.
+// With z = rproj sinh(u) the integrand is smooth even for cuspy profiles,
+//     so a fixed Gauss-Legendre rule in u suffices in most cases.
+// The difference to a rule of half the order serves as error estimate,
+//     fallback[ii] is set where it exceeds the tolerance.
+{//{{{
+    STARTFCT
+
+    int Nq = LOSQUAD_N + LOSQUAD_N/2;
+    double *r, *w, *val;
+    SAFEALLOC(r,   malloc(N * Nq * sizeof(double)));
+    SAFEALLOC(w,   malloc(N * Nq * sizeof(double)));
+    SAFEALLOC(val, malloc(N * Nq * sizeof(double)));
+
+    for (int ii=0; ii<N; ii++)
+    {
+        double U = asinh(lout[ii] / rproj[ii]);
+        for (int jj=0; jj<Nq; jj++)
+        {
+            r[ii*Nq+jj] = rproj[ii] * cosh(U * d->p->losquad_x[jj]);
+            // dz = rproj cosh(u) du
+            w[ii*Nq+jj] = U * d->p->losquad_w[jj] * r[ii*Nq+jj];
+        }
+    }
+
+    SAFEHMPDF(f(d, params, N * Nq, r, val));
+
+    for (int ii=0; ii<N; ii++)
+    {
+        double hi = 0.0;
+        double lo = 0.0;
+        for (int jj=0; jj<LOSQUAD_N; jj++)
+        {
+            hi += w[ii*Nq+jj] * val[ii*Nq+jj];
+        }
+        for (int jj=LOSQUAD_N; jj<Nq; jj++)
+        {
+            lo += w[ii*Nq+jj] * val[ii*Nq+jj];
+        }
+        out[ii] = hi;
+        fallback[ii] = fabs(hi - lo) > GSL_MAX(epsabs, BATTINTEGR_EPSREL * fabs(hi));
+    }
+
+    free(r);
+    free(w);
+    free(val);
+
+    ENDFCT
+}//}}}
+
+static int
+los_batch_masked(hmpdf_obj *d, double *rproj, double Rout, const int *mask,
+                 los_integrand_f f, void *params, double epsabs,
+                 double *out, int *fallback)
+// calls los_batch for the angles 1..Ntheta-1 where mask is set (all if mask == NULL),
+//     rproj, out and fallback are indexed like the profile
+{//{{{
+    STARTFCT
+
+    int *indices;
+    double *rproj1, *lout1, *out1;
+    int *fallback1;
+    SAFEALLOC(indices,   malloc(d->p->Ntheta * sizeof(int)));
+    SAFEALLOC(rproj1,    malloc(d->p->Ntheta * sizeof(double)));
+    SAFEALLOC(lout1,     malloc(d->p->Ntheta * sizeof(double)));
+    SAFEALLOC(out1,      malloc(d->p->Ntheta * sizeof(double)));
+    SAFEALLOC(fallback1, malloc(d->p->Ntheta * sizeof(int)));
+
+    int N = 0;
+    for (int ii=1; ii<d->p->Ntheta; ii++)
+    {
+        if (mask != NULL && !mask[ii]) { continue; }
+        indices[N] = ii;
+        rproj1[N] = rproj[ii];
+        lout1[N] = sqrt(Rout*Rout - rproj[ii]*rproj[ii]);
+        ++N;
+    }
+
+    if (N > 0)
+    {
+        SAFEHMPDF(los_batch(d, N, rproj1, lout1, f, params, epsabs, out1, fallback1));
+    }
+
+    for (int ii=0; ii<N; ii++)
+    {
+        out[indices[ii]] = out1[ii];
+        fallback[indices[ii]] = fallback1[ii];
+    }
+
+    free(indices);
+    free(rproj1);
+    free(lout1);
+    free(out1);
+    free(fallback1);
+
+    ENDFCT
+}//}}}
+// }}}
+
 // kappa BCM profiles {{{
 typedef struct
 {
@@ -329,10 +534,147 @@ kappabcm_integrand(double z, void *params)
 }
 
 static int
-kappabcm_profile(hmpdf_obj *d, int z_index, int M_index,
-                 double mass_resc,
-                 double theta_out, double Rout, double *p)
-{
+kappabcm_batch(hmpdf_obj *d, void *params, long N, double *r, double *out)
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(bcm_density_profile_batch(d, (bcm_ws *)params, N, r, out));
+
+    ENDFCT
+}//}}}
+
+// tabulated 3D density for the Abel projection (hmpdf_bcm_abel)
+typedef struct
+{//{{{
+    double rproj; // for the adaptive integration
+    int err;
+    double lnr_split; // log(R200c), the density jumps there
+    int Nseg; // one or two segments
+    int N[2];
+    double *lnr[2];
+    double *lnrho[2];
+    interp1d *interp[2];
+}//}}}
+bcm_rhotab_t;
+
+static int
+bcm_rhotab_new(hmpdf_obj *d, bcm_ws *ws, double rmin, double rmax, bcm_rhotab_t *t)
+// samples the density on a logarithmic grid between rmin and rmax,
+//     separately inside and outside R200c
+{//{{{
+    STARTFCT
+
+    t->lnr_split = log(ws->R200c);
+    double lnrmin = log(rmin);
+    double lnrmax = log(rmax);
+
+    double edges[3];
+    if (t->lnr_split > lnrmin && t->lnr_split < lnrmax)
+    {
+        t->Nseg = 2;
+        edges[0] = lnrmin; edges[1] = t->lnr_split; edges[2] = lnrmax;
+    }
+    else
+    {
+        t->Nseg = 1;
+        edges[0] = lnrmin; edges[1] = lnrmax;
+    }
+
+    for (int seg=0; seg<t->Nseg; seg++)
+    {
+        t->N[seg] = GSL_MAX(BCMABEL_NMIN,
+                            (int)(BCMABEL_NR * (edges[seg+1]-edges[seg])
+                                  / (lnrmax-lnrmin)));
+        SAFEALLOC(t->lnr[seg],   malloc(t->N[seg] * sizeof(double)));
+        SAFEALLOC(t->lnrho[seg], malloc(t->N[seg] * sizeof(double)));
+        SAFEHMPDF(linspace(t->N[seg], edges[seg], edges[seg+1], t->lnr[seg]));
+
+        double *r = t->lnrho[seg]; // use as temporary storage
+        for (int ii=0; ii<t->N[seg]; ii++)
+        {
+            r[ii] = exp(t->lnr[seg][ii]);
+        }
+        // make sure we evaluate on the correct side of the jump
+        if (t->Nseg == 2)
+        {
+            if (seg == 0) { r[t->N[seg]-1] *= 1.0 - BCMABEL_SPLIT_EPS; }
+            else          { r[0] *= 1.0 + BCMABEL_SPLIT_EPS; }
+        }
+        SAFEHMPDF(bcm_density_profile_batch(d, ws, t->N[seg], r, t->lnrho[seg]));
+        for (int ii=0; ii<t->N[seg]; ii++)
+        {
+            t->lnrho[seg][ii] = log(t->lnrho[seg][ii]);
+        }
+
+        // constant extrapolation only guards against roundoff at the edges
+        SAFEHMPDF(new_interp1d(t->N[seg], t->lnr[seg], t->lnrho[seg],
+                               t->lnrho[seg][0], t->lnrho[seg][t->N[seg]-1],
+                               BCMABEL_INTERP_TYPE, NULL, t->interp+seg));
+    }
+
+    t->err = 0;
+
+    ENDFCT
+}//}}}
+
+static void
+bcm_rhotab_free(bcm_rhotab_t *t)
+{//{{{
+    for (int seg=0; seg<t->Nseg; seg++)
+    {
+        free(t->lnr[seg]);
+        free(t->lnrho[seg]);
+        delete_interp1d(t->interp[seg]);
+    }
+}//}}}
+
+static inline int
+bcm_rhotab_eval(bcm_rhotab_t *t, double r, double *out)
+{//{{{
+    STARTFCT
+
+    double lnr = log(r);
+    int seg = (t->Nseg == 2 && lnr > t->lnr_split) ? 1 : 0;
+
+    SAFEHMPDF(interp1d_eval(t->interp[seg], lnr, out));
+    *out = exp(*out);
+
+    ENDFCT
+}//}}}
+
+static double
+bcm_rhotab_integrand(double z, void *params)
+{//{{{
+    bcm_rhotab_t *t = (bcm_rhotab_t *)params;
+    double out;
+    t->err = bcm_rhotab_eval(t, hypot(z, t->rproj), &out);
+    return out;
+}//}}}
+
+static int
+bcm_rhotab_batch(hmpdf_obj *d, void *params, long N, double *r, double *out)
+{//{{{
+    STARTFCT
+
+    (void)d;
+    bcm_rhotab_t *t = (bcm_rhotab_t *)params;
+    for (long ii=0; ii<N; ii++)
+    {
+        SAFEHMPDF(bcm_rhotab_eval(t, r[ii], out+ii));
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+kappabcm_profile_1(hmpdf_obj *d, int z_index, int M_index,
+                   double mass_resc,
+                   double theta_out, double Rout, const int *mask,
+                   int abel, double *p)
+// if mask != NULL, only computes the angles where it is set.
+// If abel, the density is tabulated first and projected
+//     with the fixed-order quadrature (adaptive only where necessary)
+{//{{{
     STARTFCT
 
     bcm_ws *ws = d->bcm->ws[THIS_THREAD];
@@ -344,9 +686,25 @@ kappabcm_profile(hmpdf_obj *d, int z_index, int M_index,
     par.err = 0;
     par.ws = ws;
 
+    double *rproj;
+    SAFEALLOC(rproj, malloc(d->p->Ntheta * sizeof(double)));
+    for (int ii=1; ii<d->p->Ntheta; ii++)
+    {
+        double t = d->p->decr_tgrid[ii] * theta_out;
+        rproj[ii] = tan(t) * d->c->angular_diameter[z_index];
+    }
+
+    bcm_rhotab_t tab;
+    if (abel)
+    {
+        // the smallest radius in the line-of-sight integrals is the smallest
+        //     projected radius
+        SAFEHMPDF(bcm_rhotab_new(d, ws, 0.5 * rproj[d->p->Ntheta-1], Rout, &tab));
+    }
+
     gsl_function integrand;
-    integrand.function = &kappabcm_integrand;
-    integrand.params = &par;
+    integrand.function = (abel) ? &bcm_rhotab_integrand : &kappabcm_integrand;
+    integrand.params = (abel) ? (void *)&tab : (void *)&par;
 
     gsl_integration_workspace *integr_ws;
     SAFEALLOC(integr_ws, gsl_integration_workspace_alloc(BATTINTEGR_LIMIT));
@@ -357,29 +715,52 @@ kappabcm_profile(hmpdf_obj *d, int z_index, int M_index,
     double epsabs = BATTINTEGR_EPSABS * (d->n->signalgrid[1]-d->n->signalgrid[0])
                     / d->c->invScrit[z_index]; // note rescaling of integrals
 
+    int *fallback = NULL;
+    if (d->p->los_fixed_order || abel)
+    {
+        SAFEALLOC(fallback, malloc(d->p->Ntheta * sizeof(int)));
+        if (abel)
+        {
+            SAFEHMPDF(los_batch_masked(d, rproj, Rout, mask,
+                                       &bcm_rhotab_batch, &tab, epsabs, p, fallback));
+        }
+        else
+        {
+            SAFEHMPDF(los_batch_masked(d, rproj, Rout, mask,
+                                       &kappabcm_batch, ws, epsabs, p, fallback));
+        }
+    }
+
     // loop over angles
     for (int ii=1/*start one inside, outermost value=0*/; ii<d->p->Ntheta; ii++)
     {
-        double t = d->p->decr_tgrid[ii] * theta_out;
-        par.rproj = tan(t) * d->c->angular_diameter[z_index];
+        if (mask != NULL && !mask[ii]) { continue; }
+
+        par.rproj = tab.rproj = rproj[ii];
         double lout = sqrt(Rout*Rout - par.rproj*par.rproj);
-        double err;
 
-        int errqag = gsl_integration_qag(&integrand, 0.0, lout,
-                                         epsabs, BATTINTEGR_EPSREL,
-                                         BATTINTEGR_LIMIT, BATTINTEGR_KEY,
-                                         integr_ws, p+ii, &err);
-        
-        if (errqag)
-        // QAG has failed (happens close to the center typically),
-        // in which case we turn to the more expensive CQUAD for help
+        if (fallback == NULL || fallback[ii])
+        // adaptive integration, either by choice
+        //     or because the fixed-order quadrature was not accurate enough
         {
-            SAFEGSL(gsl_integration_cquad(&integrand, 0.0, lout,
-                                          epsabs, BATTINTEGR_EPSREL,
-                                          cquad_ws, p+ii, NULL, NULL));
-        }
+            double err;
+            int errqag = gsl_integration_qag(&integrand, 0.0, lout,
+                                             epsabs, BATTINTEGR_EPSREL,
+                                             BATTINTEGR_LIMIT, BATTINTEGR_KEY,
+                                             integr_ws, p+ii, &err);
+            
+            if (errqag)
+            // QAG has failed (happens close to the center typically),
+            // in which case we turn to the more expensive CQUAD for help
+            {
+                SAFEGSL(gsl_integration_cquad(&integrand, 0.0, lout,
+                                              epsabs, BATTINTEGR_EPSREL,
+                                              cquad_ws, p+ii, NULL, NULL));
+            }
 
-        SAFEHMPDF(par.err);
+            SAFEHMPDF(par.err);
+            if (abel) { SAFEHMPDF(tab.err); }
+        }
 
         p[ii] *= 2.0; // symmetry
         p[ii] -= 2.0*lout*d->c->rho_m[z_index];
@@ -390,38 +771,137 @@ kappabcm_profile(hmpdf_obj *d, int z_index, int M_index,
 
     gsl_integration_cquad_workspace_free(cquad_ws);
 
+    if (fallback != NULL) { free(fallback); }
+    if (abel) { bcm_rhotab_free(&tab); }
+    free(rproj);
+
     ENDFCT
-}
+}//}}}
+
+static int
+kappabcm_profile(hmpdf_obj *d, int z_index, int M_index,
+                 double mass_resc,
+                 double theta_out, double Rout, const int *mask, double *p)
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(kappabcm_profile_1(d, z_index, M_index, mass_resc,
+                                 theta_out, Rout, mask,
+                                 d->p->bcm_abel && !d->p->bcm_abel_fallback, p));
+
+    ENDFCT
+}//}}}
 // }}}
 
-// Battaglia profiles{{{
+static int
+profile_outer(hmpdf_obj *d, int z_index, int M_index,
+              double *mass_resc, double *theta_out, double *Rout);
 
-static double
-Battaglia12_tsz_params_fid[] = { 18.1  ,  0.154  , -0.758,   // P0
-                                  0.497, -0.00865,  0.731,   // xc
-                                  1.0  ,  0.0    ,  0.0  ,   // alpha
-                                  4.35 ,  0.0393 ,  0.415,   // beta
-                                 -0.3  ,  0.0    ,  0.0  , };// gamma
+static int
+check_bcm_abel(hmpdf_obj *d)
+// compares the Abel projection of the tabulated density with the direct
+//     line-of-sight integration for a few halos,
+//     falls back to the latter if the difference is too large
+{//{{{
+    STARTFCT
 
-typedef struct
-{
-    double alpha;
-    double beta;
-    double gamma;
-    double rproj;
-}
-Battmodel_params;
+    if (!d->p->bcm_abel || d->bcm->Arico20_params == NULL) { return 0; }
 
-static inline double
-Battmodel_primitive(hmpdf_obj *d, double M200c, double z, int n)
-{
-    if (d->p->mass_z_fix>0 && M200c>=d->p->min_mass_fix && z<=d->p->max_z_fix){
-    
-    return Battaglia12_tsz_params_fid[n*3+0]
-           * pow(M200c/1e14, Battaglia12_tsz_params_fid[n*3+1])
-           * pow(1.0+z, Battaglia12_tsz_params_fid[n*3+2]);
-    }
-    
+    double *p_abel, *p_direct;
+    SAFEALLOC(p_abel,   malloc(d->p->Ntheta * sizeof(double)));
+    SAFEALLOC(p_direct, malloc(d->p->Ntheta * sizeof(double)));
+
+    int ok = 1;
+    for (int ii=0; ii<BCMABEL_NCHECK; ii++)
+    {
+        // spread over redshifts and masses
+        int z_index = (ii * (d->n->Nz-1)) / GSL_MAX(1, BCMABEL_NCHECK-1);
+        int M_index = (ii * (d->n->NM-1)) / GSL_MAX(1, BCMABEL_NCHECK-1);
+
+        double mass_resc, theta_out, Rout;
+        SAFEHMPDF(profile_outer(d, z_index, M_index, &mass_resc, &theta_out, &Rout));
+        SAFEHMPDF(kappabcm_profile_1(d, z_index, M_index, mass_resc,
+                                     theta_out, Rout, NULL, 1, p_abel));
+        SAFEHMPDF(kappabcm_profile_1(d, z_index, M_index, mass_resc,
+                                     theta_out, Rout, NULL, 0, p_direct));
+
+        double maxp = 0.0;
+        double maxerr = 0.0;
+        for (int jj=1; jj<d->p->Ntheta; jj++)
+        {
+            maxp = GSL_MAX(maxp, fabs(p_direct[jj]));
+            maxerr = GSL_MAX(maxerr, fabs(p_abel[jj] - p_direct[jj]));
+        }
+
+        HMPDFPRINT(3, "\t\tAbel projection error at z = %g, M = %g Msun/h : %g\n",
+                      d->n->zgrid[z_index], d->n->Mgrid[M_index]*d->c->h,
+                      maxerr/maxp);
+
+        if (maxerr > BCMABEL_TOL * maxp) { ok = 0; }
+    }
+
+    free(p_abel);
+    free(p_direct);
+
+    if (!ok)
+    {
+        HMPDFPRINT(0, "WARNING: Abel projection of the tabulated BCM density "
+                      "is not accurate enough, using direct line-of-sight integration.\n");
+        d->p->bcm_abel_fallback = 1;
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+profile_outer(hmpdf_obj *d, int z_index, int M_index,
+              double *mass_resc, double *theta_out, double *Rout)
+// finds the outer radius and the corresponding angle on the sky
+{//{{{
+    STARTFCT
+
+    *mass_resc = (d->p->mass_resc == NULL)
+                 ? 1.0
+                 : d->p->mass_resc(d->n->zgrid[z_index],
+                                   d->n->Mgrid[M_index] * d->c->h,
+                                   d->p->mass_resc_params);
+
+    double M, c;
+    SAFEHMPDF(Mconv(d, z_index, M_index, d->p->rout_def, *mass_resc, &M, Rout, &c));
+    *Rout *= d->p->rout_scale;
+    *theta_out = atan(*Rout/d->c->angular_diameter[z_index]);
+
+    ENDFCT
+}//}}}
+
+// Battaglia profiles{{{
+
+static double
+Battaglia12_tsz_params_fid[] = { 18.1  ,  0.154  , -0.758,   // P0
+                                  0.497, -0.00865,  0.731,   // xc
+                                  1.0  ,  0.0    ,  0.0  ,   // alpha
+                                  4.35 ,  0.0393 ,  0.415,   // beta
+                                 -0.3  ,  0.0    ,  0.0  , };// gamma
+
+typedef struct
+{
+    double alpha;
+    double beta;
+    double gamma;
+    double rproj;
+}
+Battmodel_params;
+
+static inline double
+Battmodel_primitive(hmpdf_obj *d, double M200c, double z, int n)
+{
+    if (d->p->mass_z_fix>0 && M200c>=d->p->min_mass_fix && z<=d->p->max_z_fix){
+    
+    return Battaglia12_tsz_params_fid[n*3+0]
+           * pow(M200c/1e14, Battaglia12_tsz_params_fid[n*3+1])
+           * pow(1.0+z, Battaglia12_tsz_params_fid[n*3+2]);
+    }
+    
     else {
     return d->p->Battaglia12_params[n*3+0]
            * pow(M200c/1e14, d->p->Battaglia12_params[n*3+1])
@@ -437,10 +917,28 @@ Battmodel_integrand(double z, void *params)
     return pow(r, p->gamma) / pow(1.0 + pow(r, p->alpha), p->beta);
 }
 static int
-tsz_profile(hmpdf_obj *d, int z_index, int M_index,
-            double mass_resc,
-            double theta_out, double Rout, double *p)
-{
+Battmodel_batch(hmpdf_obj *d, void *params, long N, double *r, double *out)
+{//{{{
+    STARTFCT
+
+    (void)d; // only required by the signature
+
+    Battmodel_params *p = (Battmodel_params *)params;
+    for (long ii=0; ii<N; ii++)
+    {
+        out[ii] = pow(r[ii], p->gamma) / pow(1.0 + pow(r[ii], p->alpha), p->beta);
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+Battmodel_setup(hmpdf_obj *d, int z_index, int M_index, double mass_resc,
+                Battmodel_params *par, double *rscale, double *scaling)
+// fills the shape parameters,
+//     the length scale R200c*xc in which the integrand is dimensionless,
+//     and the rescaling from integration units to physical Compton-y
+{//{{{
     STARTFCT
 
     // convert to 200c
@@ -449,198 +947,1341 @@ tsz_profile(hmpdf_obj *d, int z_index, int M_index,
     SAFEHMPDF(Mconv(d, z_index, M_index, hmpdf_mdef_c, mass_resc, &M200c, &R200c, &c200c));
     double P0 = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 0);
     double xc = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 1);
-    Rout /= R200c * xc;
+    *rscale = R200c * xc;
     
-    
-    // prepare the integration
-    Battmodel_params par;
-    par.alpha = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 2);
-    par.beta  = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 3);
-    par.gamma = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 4);
+    par->alpha = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 2);
+    par->beta  = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 3);
+    par->gamma = Battmodel_primitive(d, M200c, d->n->zgrid[z_index], 4);
+
+    *scaling = P0 * xc * M200c * 200.0
+               * d->c->rho_c[z_index] * d->c->Ob_0 / d->c->Om_0
+               * GNEWTON * SIGMATHOMSON / MELECTRON / gsl_pow_2(SPEEDOFLIGHT)
+               / 1.932/*convert from thermal to electron pressure*/;
+
+    ENDFCT
+}//}}}
+
+static int
+Battmodel_los(Battmodel_params *par, double a, double b,
+              double epsabs, gsl_integration_workspace *ws,
+              gsl_integration_cquad_workspace *cquad_ws, double *out)
+// line-of-sight integral of the dimensionless profile from a to b
+{//{{{
+    STARTFCT
 
-    
     gsl_function integrand;
     integrand.function = &Battmodel_integrand;
-    integrand.params = &par;
-    gsl_integration_workspace *ws;
-    SAFEALLOC(ws, gsl_integration_workspace_alloc(BATTINTEGR_LIMIT));
+    integrand.params = par;
+
+    double err;
+    int errqag = gsl_integration_qag(&integrand, a, b,
+                                     epsabs, BATTINTEGR_EPSREL,
+                                     BATTINTEGR_LIMIT, BATTINTEGR_KEY,
+                                     ws, out, &err);
+    if (errqag && cquad_ws != NULL)
+    // fall back to the more robust CQUAD
+    {
+        SAFEGSL(gsl_integration_cquad(&integrand, a, b,
+                                      epsabs, BATTINTEGR_EPSREL,
+                                      cquad_ws, out, NULL, NULL));
+    }
+    else
+    {
+        SAFEGSL(errqag);
+    }
 
-    // rescaling from integration units to physical Compton-y
-    double scaling = P0 * xc * M200c * 200.0
-                     * d->c->rho_c[z_index] * d->c->Ob_0 / d->c->Om_0
-                     * GNEWTON * SIGMATHOMSON / MELECTRON / gsl_pow_2(SPEEDOFLIGHT)
-                     / 1.932/*convert from thermal to electron pressure*/;
+    ENDFCT
+}//}}}
 
-    // loop over angles
-    for (int ii=1/*start one inside, outermost value=0*/; ii<d->p->Ntheta; ii++)
+static void
+delete_gnfw_table(gnfw_table_t *t)
+{//{{{
+    if (t->tabs != NULL)
     {
-        double t = d->p->decr_tgrid[ii] * theta_out;
-        par.rproj = tan(t) * d->c->angular_diameter[z_index] / R200c / xc;
-        double lout = sqrt(Rout*Rout - par.rproj*par.rproj);
-        
-        double err;
-        SAFEGSL(gsl_integration_qag(&integrand, 0.0, lout,
-                                    BATTINTEGR_EPSABS
-                                    * (d->n->signalgrid[1]-d->n->signalgrid[0]) / scaling,
-                                    BATTINTEGR_EPSREL,
-                                    BATTINTEGR_LIMIT, BATTINTEGR_KEY,
-                                    ws, p+ii, &err));
+        for (int ii=0; ii<t->Nbeta; ii++)
+        {
+            if (t->tabs[ii] != NULL) { gsl_spline2d_free(t->tabs[ii]); }
+        }
+        free(t->tabs);
+        t->tabs = NULL;
+    }
+}//}}}
 
-        // normalize
-        p[ii] *= scaling;
+static int
+gnfw_table_eval(gnfw_table_t *t, double beta, double rproj, double l, double *out)
+// cubic Lagrange interpolation in beta of the bicubic (log rproj, log l) tables
+{//{{{
+    STARTFCT
+
+    double x = GSL_MAX(t->logrmin, GSL_MIN(t->logrmax, log(rproj)));
+    double y = GSL_MAX(t->loglmin, GSL_MIN(t->loglmax, log(l)));
+
+    if (t->Nbeta == 1)
+    {
+        SAFEGSL(gsl_spline2d_eval_e(t->tabs[0], x, y, NULL, NULL, out));
+    }
+    else
+    {
+        double u = (beta - t->beta0) / t->dbeta;
+        // nodes k-1 ... k+2, where u is between k and k+1
+        int k = GSL_MAX(1, GSL_MIN(t->Nbeta-3, (int)floor(u)));
+        u -= (double)k;
+        double w[4] = { -u*(u-1.0)*(u-2.0)/6.0,
+                        (u+1.0)*(u-1.0)*(u-2.0)/2.0,
+                        -(u+1.0)*u*(u-2.0)/2.0,
+                        (u+1.0)*u*(u-1.0)/6.0, };
+        *out = 0.0;
+        for (int ii=0; ii<4; ii++)
+        {
+            double temp;
+            SAFEGSL(gsl_spline2d_eval_e(t->tabs[k-1+ii], x, y, NULL, NULL, &temp));
+            *out += w[ii] * temp;
+        }
     }
 
-    gsl_integration_workspace_free(ws);
+    *out = exp(*out);
 
     ENDFCT
-}
-//}}}
+}//}}}
 
 static int
-profile(hmpdf_obj *d, int z_index, int M_index, double *p)
-// returns theta_out and writes the profile into return value
+fill_gnfw_table(hmpdf_obj *d, gnfw_table_t *t, double *range,
+                int Nr, int Nl, double dbeta)
+// range = { beta_min, beta_max, rproj_min, rproj_max, l_min, l_max }
 {//{{{
     STARTFCT
 
-    double mass_resc = (d->p->mass_resc == NULL)
-                       ? 1.0
-                       : d->p->mass_resc(d->n->zgrid[z_index],
-                                         d->n->Mgrid[M_index] * d->c->h,
-                                         d->p->mass_resc_params);
+    if (range[1] > range[0])
+    {
+        int Nint = (int)ceil((range[1] - range[0]) / dbeta);
+        t->dbeta = (range[1] - range[0]) / (double)Nint;
+        // one node padding below and above, so the interpolation stencil
+        //     is always available
+        t->Nbeta = Nint + 3;
+        t->beta0 = range[0] - t->dbeta;
+    }
+    else
+    {
+        t->Nbeta = 1;
+        t->dbeta = 0.0;
+        t->beta0 = range[0];
+    }
 
-    // find the outer radius on the sky
-    double M, Rout, c;
-    SAFEHMPDF(Mconv(d, z_index, M_index, d->p->rout_def, mass_resc, &M, &Rout, &c));
-    Rout *= d->p->rout_scale;
-    double theta_out = atan(Rout/d->c->angular_diameter[z_index]);
+    t->logrmin = log(range[2]);
+    t->logrmax = log(range[3]);
+    t->loglmin = log(range[4]);
+    t->loglmax = log(range[5]);
 
-    if (d->p->stype == hmpdf_kappa
-        && d->bcm->Arico20_params == NULL)
+    double *logr, *logl, *vals;
+    SAFEALLOC(logr, malloc(Nr * sizeof(double)));
+    SAFEALLOC(logl, malloc(Nl * sizeof(double)));
+    SAFEALLOC(vals, malloc(t->Nbeta * Nr * Nl * sizeof(double)));
+    SAFEHMPDF(linspace(Nr, t->logrmin, t->logrmax, logr));
+    SAFEHMPDF(linspace(Nl, t->loglmin, t->loglmax, logl));
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int ii=0; ii<t->Nbeta*Nr; ii++)
     {
-        SAFEHMPDF(kappa_profile(d, z_index, M_index,
-                                mass_resc,
-                                theta_out, Rout, p+1));
+        CONTINUE_IF_ERR
+
+        int kk = ii / Nr;
+        int ir = ii % Nr;
+
+        Battmodel_params par;
+        par.alpha = t->alpha;
+        par.beta  = t->beta0 + (double)kk * t->dbeta;
+        par.gamma = t->gamma;
+        par.rproj = exp(logr[ir]);
+
+        gsl_integration_workspace *ws;
+        SAFEALLOC_NORETURN(ws, gsl_integration_workspace_alloc(BATTINTEGR_LIMIT));
+        CONTINUE_IF_ERR
+        gsl_integration_cquad_workspace *cquad_ws;
+        SAFEALLOC_NORETURN(cquad_ws, gsl_integration_cquad_workspace_alloc(BATTINTEGR_LIMIT));
+        CONTINUE_IF_ERR
+
+        // accumulate along the line of sight
+        double integral = 0.0;
+        for (int il=0; il<Nl; il++)
+        {
+            CONTINUE_IF_ERR
+            double a = (il) ? exp(logl[il-1]) : 0.0;
+            double dI;
+            SAFEHMPDF_NORETURN(Battmodel_los(&par, a, exp(logl[il]),
+                                             1e-3 * GNFWTAB_TOL * integral,
+                                             ws, cquad_ws, &dI));
+            integral += dI;
+            vals[kk*Nr*Nl + il*Nr + ir] = log(integral);
+        }
+
+        gsl_integration_workspace_free(ws);
+        gsl_integration_cquad_workspace_free(cquad_ws);
     }
-    else if (d->p->stype == hmpdf_kappa
-             && d->bcm->Arico20_params != NULL)
+
+    SAFEALLOC(t->tabs, malloc(t->Nbeta * sizeof(gsl_spline2d *)));
+    SETARRNULL(t->tabs, t->Nbeta);
+    for (int kk=0; kk<t->Nbeta; kk++)
     {
-        SAFEHMPDF(kappabcm_profile(d, z_index, M_index,
-                                   mass_resc,
-                                   theta_out, Rout, p+1));
+        SAFEALLOC(t->tabs[kk], gsl_spline2d_alloc(gsl_interp2d_bicubic, Nr, Nl));
+        SAFEGSL(gsl_spline2d_init(t->tabs[kk], logr, logl, vals+kk*Nr*Nl, Nr, Nl));
     }
-    else if (d->p->stype == hmpdf_tsz)
+
+    free(logr);
+    free(logl);
+    free(vals);
+
+    ENDFCT
+}//}}}
+
+static int
+check_gnfw_table(hmpdf_obj *d, gnfw_table_t *t, double *range,
+                 int Nr, int Nl, double *maxerr)
+// compares the table with direct integration at points in between the nodes,
+//     returns the maximum relative error
+{//{{{
+    STARTFCT
+
+    int Nbetacheck = (t->Nbeta == 1) ? 1 : t->Nbeta - 3;
+    int Nrcheck = (Nr - 1) / GNFWTAB_CHECK_STRIDE;
+    int Nlcheck = (Nl - 1) / GNFWTAB_CHECK_STRIDE;
+    double dlogr = (t->logrmax - t->logrmin) / (double)(Nr - 1);
+    double dlogl = (t->loglmax - t->loglmin) / (double)(Nl - 1);
+
+    *maxerr = 0.0;
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int ii=0; ii<Nbetacheck*Nrcheck; ii++)
     {
+        CONTINUE_IF_ERR
+
+        int kk = ii / Nrcheck;
+        int ir = ii % Nrcheck;
+
+        Battmodel_params par;
+        par.alpha = t->alpha;
+        // in between the beta nodes (or the unique one)
+        par.beta  = (t->Nbeta == 1) ? t->beta0
+                    : GSL_MIN(range[1], range[0] + ((double)kk + 0.5) * t->dbeta);
+        par.gamma = t->gamma;
+        par.rproj = exp(t->logrmin + ((double)(ir*GNFWTAB_CHECK_STRIDE) + 0.5) * dlogr);
+
+        gsl_integration_workspace *ws;
+        SAFEALLOC_NORETURN(ws, gsl_integration_workspace_alloc(BATTINTEGR_LIMIT));
+        CONTINUE_IF_ERR
+        gsl_integration_cquad_workspace *cquad_ws;
+        SAFEALLOC_NORETURN(cquad_ws, gsl_integration_cquad_workspace_alloc(BATTINTEGR_LIMIT));
+        CONTINUE_IF_ERR
 
-        SAFEHMPDF(tsz_profile(d, z_index, M_index,
-                              mass_resc,
-                              theta_out, Rout, p+1));
+        double err = 0.0;
+        for (int il=0; il<Nlcheck; il++)
+        {
+            CONTINUE_IF_ERR
+            double l = exp(t->loglmin + ((double)(il*GNFWTAB_CHECK_STRIDE) + 0.5) * dlogl);
+            double exact, interp;
+            SAFEHMPDF_NORETURN(Battmodel_los(&par, 0.0, l, 0.0,
+                                             ws, cquad_ws, &exact));
+            CONTINUE_IF_ERR
+            SAFEHMPDF_NORETURN(gnfw_table_eval(t, par.beta, par.rproj, l, &interp));
+            err = GSL_MAX(err, fabs(interp/exact - 1.0));
+        }
+
+        gsl_integration_workspace_free(ws);
+        gsl_integration_cquad_workspace_free(cquad_ws);
+
+        #ifdef _OPENMP
+        #   pragma omp critical(CheckGNFWTable)
+        #endif
+        {
+            *maxerr = GSL_MAX(*maxerr, err);
+        }
     }
-    else
+
+    ENDFCT
+}//}}}
+
+static int
+create_gnfw_tables(hmpdf_obj *d)
+// tabulates the projected GNFW profiles for each unique (alpha, gamma)
+{//{{{
+    STARTFCT
+
+    if (d->p->created_gnfw_tables) { return 0; }
+    if (!d->p->tsz_table || d->p->stype != hmpdf_tsz) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_gnfw_tables\n");
+
+    // find the parameter ranges covered by the halos
+    //     alpha, gamma, beta, rproj_min, rproj_max, l_min, l_max
+    int Nbins = d->n->Nz * d->n->NM;
+    double *dom;
+    SAFEALLOC(dom, malloc(Nbins * 7 * sizeof(double)));
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int ii=0; ii<Nbins; ii++)
     {
-        HMPDFERR("unkown signal type.");
+        CONTINUE_IF_ERR
+
+        int z_index = ii / d->n->NM;
+        int M_index = ii % d->n->NM;
+
+        double mass_resc, theta_out, Rout;
+        SAFEHMPDF_NORETURN(profile_outer(d, z_index, M_index,
+                                         &mass_resc, &theta_out, &Rout));
+        CONTINUE_IF_ERR
+        Battmodel_params par;
+        double rscale, scaling;
+        SAFEHMPDF_NORETURN(Battmodel_setup(d, z_index, M_index, mass_resc,
+                                           &par, &rscale, &scaling));
+        CONTINUE_IF_ERR
+        Rout /= rscale;
+
+        // the outermost sampled angle is ii=1, the innermost ii=Ntheta-1
+        double rmax = tan(d->p->decr_tgrid[1] * theta_out)
+                      * d->c->angular_diameter[z_index] / rscale;
+        double rmin = tan(d->p->decr_tgrid[d->p->Ntheta-1] * theta_out)
+                      * d->c->angular_diameter[z_index] / rscale;
+
+        double *this = dom + 7*ii;
+        this[0] = par.alpha;
+        this[1] = par.gamma;
+        this[2] = par.beta;
+        this[3] = rmin;
+        this[4] = rmax;
+        this[5] = sqrt(Rout*Rout - rmax*rmax);
+        this[6] = sqrt(Rout*Rout - rmin*rmin);
     }
 
-    p[0] = theta_out;
+    // find the unique (alpha, gamma) pairs
+    SAFEALLOC(d->p->gnfw_tables, malloc(Nbins * sizeof(gnfw_table_t)));
+    double *ranges;
+    SAFEALLOC(ranges, malloc(Nbins * 6 * sizeof(double)));
+    d->p->Ngnfw_tables = 0;
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        double *this = dom + 7*ii;
+        int tt;
+        for (tt=0; tt<d->p->Ngnfw_tables; tt++)
+        {
+            if (d->p->gnfw_tables[tt].alpha == this[0]
+                && d->p->gnfw_tables[tt].gamma == this[1])
+            {
+                break;
+            }
+        }
+
+        double *range = ranges + 6*tt;
+        if (tt == d->p->Ngnfw_tables)
+        {
+            d->p->gnfw_tables[tt].alpha = this[0];
+            d->p->gnfw_tables[tt].gamma = this[1];
+            d->p->gnfw_tables[tt].Nbeta = 0;
+            d->p->gnfw_tables[tt].tabs = NULL;
+            ++d->p->Ngnfw_tables;
+            range[0] = range[1] = this[2];
+            range[2] = this[3];
+            range[3] = this[4];
+            range[4] = this[5];
+            range[5] = this[6];
+        }
+        else
+        {
+            range[0] = GSL_MIN(range[0], this[2]);
+            range[1] = GSL_MAX(range[1], this[2]);
+            range[2] = GSL_MIN(range[2], this[3]);
+            range[3] = GSL_MAX(range[3], this[4]);
+            range[4] = GSL_MIN(range[4], this[5]);
+            range[5] = GSL_MAX(range[5], this[6]);
+        }
+    }
+
+    free(dom);
+
+    // tabulate, refining until the requested accuracy is reached
+    //     (tables that don't reach it are dropped, tsz_profile then integrates directly)
+    int Nkept = 0;
+    for (int tt=0; tt<d->p->Ngnfw_tables; tt++)
+    {
+        gnfw_table_t *t = d->p->gnfw_tables + tt;
+        double *range = ranges + 6*tt;
+        int Nr = GNFWTAB_NR;
+        int Nl = GNFWTAB_NL;
+        double dbeta = GNFWTAB_DBETA;
+        double maxerr;
+        for (int refine=0; ; refine++)
+        {
+            SAFEHMPDF(fill_gnfw_table(d, t, range, Nr, Nl, dbeta));
+            SAFEHMPDF(check_gnfw_table(d, t, range, Nr, Nl, &maxerr));
+            HMPDFPRINT(3, "\t\tGNFW table (alpha=%g, gamma=%g) : "
+                          "%d x %d x %d, max. rel. error %.2e\n",
+                          t->alpha, t->gamma, t->Nbeta, Nr, Nl, maxerr);
+
+            if (maxerr < GNFWTAB_TOL || refine == GNFWTAB_MAXREFINE)
+            {
+                break;
+            }
+
+            delete_gnfw_table(t);
+            Nr = 2*Nr - 1;
+            Nl = 2*Nl - 1;
+            dbeta *= 0.5;
+        }
+
+        if (maxerr > GNFWTAB_TOL)
+        {
+            // not an error, since we can recover
+            HMPDFPRINT(0, "WARNING: tabulated tSZ profiles (alpha=%g, gamma=%g) "
+                          "only reached relative accuracy %.2e, "
+                          "using line-of-sight integration for them instead.\n",
+                          t->alpha, t->gamma, maxerr);
+            delete_gnfw_table(t);
+        }
+        else
+        {
+            d->p->gnfw_tables[Nkept] = *t;
+            // so that reset_profiles does not free it twice if we fail later
+            if (Nkept != tt) { t->tabs = NULL; }
+            ++Nkept;
+        }
+    }
+    d->p->Ngnfw_tables = Nkept;
+
+    free(ranges);
+
+    d->p->created_gnfw_tables = 1;
 
     ENDFCT
 }//}}}
 
 static int
-tot_profiles_to_file(hmpdf_obj *d, int z_index, int M_index, char *fname)
+tsz_profile(hmpdf_obj *d, int z_index, int M_index,
+            double mass_resc,
+            double theta_out, double Rout, const int *mask, double *p)
+// if mask != NULL, only computes the angles where it is set
 {
     STARTFCT
 
-    FILE *fp = fopen(fname, "w");
-    HMPDFCHECK(!fp, "failed to open file %s", fname);
+    Battmodel_params par;
+    double rscale, scaling;
+    SAFEHMPDF(Battmodel_setup(d, z_index, M_index, mass_resc,
+                              &par, &rscale, &scaling));
+    Rout /= rscale;
+
+    // look for the tabulated projection
+    gnfw_table_t *tab = NULL;
+    for (int ii=0; ii<d->p->Ngnfw_tables; ii++)
+    {
+        if (d->p->gnfw_tables[ii].alpha == par.alpha
+            && d->p->gnfw_tables[ii].gamma == par.gamma)
+        {
+            tab = d->p->gnfw_tables + ii;
+            break;
+        }
+    }
 
-    double mass_resc = (d->p->mass_resc == NULL)
-                       ? 1.0
-                       : d->p->mass_resc(d->n->zgrid[z_index],
-                                         d->n->Mgrid[M_index] * d->c->h,
-                                         d->p->mass_resc_params);
+    double epsabs = BATTINTEGR_EPSABS
+                    * (d->n->signalgrid[1]-d->n->signalgrid[0]) / scaling;
 
-    double M200c, R200c, c200c;
-    SAFEHMPDF(Mconv(d, z_index, M_index, hmpdf_mdef_c, mass_resc, &M200c, &R200c, &c200c));
-    fprintf(fp, "# z=%.18e\n# M200m[Msun/h]=%.18e\n# R200c[Mpc]=%.18e\n\n",
-                d->n->zgrid[z_index], d->n->Mgrid[M_index]*d->c->h, R200c);
-    fprintf(fp, "# r[Mpc], rho_nfw[Msun/Mpc^3]\n");
+    int *fallback = NULL;
+    if (tab == NULL && d->p->los_fixed_order)
+    {
+        SAFEALLOC(fallback, malloc(d->p->Ntheta * sizeof(int)));
+        double *rproj;
+        SAFEALLOC(rproj, malloc(d->p->Ntheta * sizeof(double)));
+        for (int ii=1; ii<d->p->Ntheta; ii++)
+        {
+            double t = d->p->decr_tgrid[ii] * theta_out;
+            rproj[ii] = tan(t) * d->c->angular_diameter[z_index] / rscale;
+        }
+        SAFEHMPDF(los_batch_masked(d, rproj, Rout, mask,
+                                   &Battmodel_batch, &par, epsabs, p, fallback));
+        free(rproj);
+    }
+
+    gsl_integration_workspace *ws = NULL;
+    if (tab == NULL)
+    {
+        SAFEALLOC(ws, gsl_integration_workspace_alloc(BATTINTEGR_LIMIT));
+    }
+
+    // loop over angles
+    for (int ii=1/*start one inside, outermost value=0*/; ii<d->p->Ntheta; ii++)
+    {
+        if (mask != NULL && !mask[ii]) { continue; }
+
+        double t = d->p->decr_tgrid[ii] * theta_out;
+        par.rproj = tan(t) * d->c->angular_diameter[z_index] / rscale;
+        double lout = sqrt(Rout*Rout - par.rproj*par.rproj);
+        
+        if (tab != NULL)
+        {
+            SAFEHMPDF(gnfw_table_eval(tab, par.beta, par.rproj, lout, p+ii));
+        }
+        else if (fallback == NULL || fallback[ii])
+        {
+            SAFEHMPDF(Battmodel_los(&par, 0.0, lout, epsabs,
+                                    ws, NULL, p+ii));
+        }
+
+        // normalize
+        p[ii] *= scaling;
+    }
+
+    if (ws != NULL)
+    {
+        gsl_integration_workspace_free(ws);
+    }
+
+    if (fallback != NULL) { free(fallback); }
+
+    ENDFCT
+}
+//}}}
+
+// adaptive angular sampling {{{
+typedef int (*profile_f)(hmpdf_obj *, int, int, double, double, double,
+                         const int *, double *);
+
+static double
+interp_samples(hmpdf_obj *d, const int *sampled, const double *p, int ii)
+// cubic Lagrange interpolation in theta through the (up to) two closest
+//     sampled angles on each side of ii
+{//{{{
+    int nodes[4];
+    int n = 0;
+    for (int jj=ii-1, found=0; jj>0 && found<2; jj--)
+    {
+        if (sampled[jj]) { nodes[n++] = jj; ++found; }
+    }
+    for (int jj=ii+1, found=0; jj<d->p->Ntheta && found<2; jj++)
+    {
+        if (sampled[jj]) { nodes[n++] = jj; ++found; }
+    }
+
+    double x = d->p->decr_tgrid[ii];
+    double out = 0.0;
+    for (int aa=0; aa<n; aa++)
+    {
+        double w = 1.0;
+        for (int bb=0; bb<n; bb++)
+        {
+            if (bb == aa) { continue; }
+            w *= (x - d->p->decr_tgrid[nodes[bb]])
+                 / (d->p->decr_tgrid[nodes[aa]] - d->p->decr_tgrid[nodes[bb]]);
+        }
+        out += w * p[nodes[aa]];
+    }
+    return out;
+}//}}}
+
+static int
+sample_profile(hmpdf_obj *d, profile_f f, int z_index, int M_index,
+               double mass_resc, double theta_out, double Rout, double *p)
+// if theta_adaptive is set, only evaluates the profile at a subset of the angles:
+//     starting from every PRADAPT_STRIDE-th angle, intervals are bisected
+//     until the interpolation error at the midpoint is below tolerance,
+//     then the remaining angles are interpolated.
+{//{{{
+    STARTFCT
+
+    int N = d->p->Ntheta;
+
+    if (!d->p->theta_adaptive || N <= 2*PRADAPT_STRIDE)
+    {
+        SAFEHMPDF(f(d, z_index, M_index, mass_resc, theta_out, Rout, NULL, p));
+        return 0;
+    }
+
+    int *mask, *sampled, *converged;
+    double *pred;
+    SAFEALLOC(mask,      calloc(N, sizeof(int)));
+    SAFEALLOC(sampled,   calloc(N, sizeof(int)));
+    SAFEALLOC(converged, calloc(N, sizeof(int))); // for the interval starting here
+    SAFEALLOC(pred,      malloc(N * sizeof(double)));
+
+    double epsabs = PRADAPT_EPSABS * (d->n->signalgrid[1]-d->n->signalgrid[0]);
+
+    // initial coarse sampling
+    for (int ii=1; ii<N; ii+=PRADAPT_STRIDE)
+    {
+        mask[ii] = 1;
+    }
+    mask[N-1] = 1;
+
+    for (int first=1; ; first=0)
+    {
+        SAFEHMPDF(f(d, z_index, M_index, mass_resc, theta_out, Rout, mask, p));
+
+        // compare the new midpoints with the predictions made before evaluation
+        for (int ii=1; !first && ii<N; ii++)
+        {
+            if (!mask[ii]) { continue; }
+            if (fabs(pred[ii] - p[ii]) < GSL_MAX(epsabs, PRADAPT_EPSREL*fabs(p[ii])))
+            {
+                // both halves of the bisected interval
+                converged[ii] = 1;
+                for (int jj=ii-1; jj>0; jj--)
+                {
+                    if (sampled[jj]) { converged[jj] = 1; break; }
+                }
+            }
+        }
+
+        int Nnew = 0;
+        for (int ii=1; ii<N; ii++)
+        {
+            sampled[ii] |= mask[ii];
+            mask[ii] = 0;
+        }
+
+        // bisect the intervals that are not converged yet
+        for (int lo=1, hi; lo<N-1; lo=hi)
+        {
+            for (hi=lo+1; hi<N-1 && !sampled[hi]; hi++);
+            if (hi-lo > 1 && !converged[lo])
+            {
+                mask[(lo+hi)/2] = 1;
+                ++Nnew;
+            }
+        }
+
+        if (Nnew == 0) { break; }
+
+        for (int ii=1; ii<N; ii++)
+        {
+            if (mask[ii]) { pred[ii] = interp_samples(d, sampled, p, ii); }
+        }
+    }
+
+    // fill the remaining angles
+    int Nsampled = 0;
+    for (int ii=1; ii<N; ii++)
+    {
+        if (sampled[ii]) { ++Nsampled; continue; }
+        p[ii] = interp_samples(d, sampled, p, ii);
+    }
+
+    HMPDFPRINT(4, "\t\t\tz = %g, M = %g Msun/h : evaluated %d of %d angles\n",
+                  d->n->zgrid[z_index], d->n->Mgrid[M_index]*d->c->h,
+                  Nsampled, N-1);
+
+    free(mask);
+    free(sampled);
+    free(converged);
+    free(pred);
+
+    ENDFCT
+}//}}}
+//}}}
+
+static int
+profile(hmpdf_obj *d, int z_index, int M_index, double *p)
+// returns theta_out and writes the profile into return value
+{//{{{
+    STARTFCT
+
+    double mass_resc, theta_out, Rout;
+    SAFEHMPDF(profile_outer(d, z_index, M_index, &mass_resc, &theta_out, &Rout));
+
+    if (d->p->stype == hmpdf_kappa
+        && d->bcm->Arico20_params == NULL)
+    {
+        SAFEHMPDF(kappa_profile(d, z_index, M_index,
+                                mass_resc,
+                                theta_out, Rout, p+1));
+    }
+    else if (d->p->stype == hmpdf_kappa
+             && d->bcm->Arico20_params != NULL)
+    {
+        SAFEHMPDF(sample_profile(d, &kappabcm_profile, z_index, M_index,
+                                 mass_resc,
+                                 theta_out, Rout, p+1));
+    }
+    else if (d->p->stype == hmpdf_tsz)
+    {
+        SAFEHMPDF(sample_profile(d, &tsz_profile, z_index, M_index,
+                                 mass_resc,
+                                 theta_out, Rout, p+1));
+    }
+    else
+    {
+        HMPDFERR("unkown signal type.");
+    }
+
+    p[0] = theta_out;
+
+    ENDFCT
+}//}}}
+
+static int
+tot_profiles_to_file(hmpdf_obj *d, int z_index, int M_index, char *fname)
+{
+    STARTFCT
+
+    FILE *fp = fopen(fname, "w");
+    HMPDFCHECK(!fp, "failed to open file %s", fname);
+
+    double mass_resc = (d->p->mass_resc == NULL)
+                       ? 1.0
+                       : d->p->mass_resc(d->n->zgrid[z_index],
+                                         d->n->Mgrid[M_index] * d->c->h,
+                                         d->p->mass_resc_params);
+
+    double M200c, R200c, c200c;
+    SAFEHMPDF(Mconv(d, z_index, M_index, hmpdf_mdef_c, mass_resc, &M200c, &R200c, &c200c));
+    fprintf(fp, "# z=%.18e\n# M200m[Msun/h]=%.18e\n# R200c[Mpc]=%.18e\n\n",
+                d->n->zgrid[z_index], d->n->Mgrid[M_index]*d->c->h, R200c);
+    fprintf(fp, "# r[Mpc], rho_nfw[Msun/Mpc^3]\n");
+
+    double rhos, rs;
+    SAFEHMPDF(NFW_fundamental(d, z_index, M_index, mass_resc, d->h->Duffy08_params, &rhos, &rs));
+
+    for (int ii=0; ii<d->p->tot_profiles_Nr; ii++)
+    {
+        double r = R200c * d->p->tot_profiles_r[ii];
+        double x = r / rs;
+        double rho = rhos / (x * gsl_pow_2(1.0+x));
+        fprintf(fp, "%.18e %.18e\n", r, rho);
+    }
+
+    fclose(fp);
+
+    ENDFCT
+}
+
+static int
+exact_profile(hmpdf_obj *d, int z_index, int M_index, double *p)
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(profile(d, z_index, M_index, p));
+    SAFEHMPDF(fix_endpoints(d->p->Ntheta, d->p->decr_tgrid, p+1));
+
+    ENDFCT
+}//}}}
+
+// mass-interpolated profiles {{{
+// the coarse masses are 0, Mstride, 2*Mstride, ..., NM-1
+static inline int
+use_minterp(hmpdf_obj *d)
+{//{{{
+    return d->p->Mstride > 1 && d->n->NM > 2;
+}//}}}
+
+static inline int
+Ncoarse_masses(hmpdf_obj *d)
+{//{{{
+    return (d->n->NM-2) / d->p->Mstride + 2;
+}//}}}
+
+static inline int
+coarse_mass(hmpdf_obj *d, int k)
+{//{{{
+    return GSL_MIN(k * d->p->Mstride, d->n->NM-1);
+}//}}}
+
+static inline int
+is_coarse_mass(hmpdf_obj *d, int M_index)
+{//{{{
+    return !use_minterp(d)
+           || M_index % d->p->Mstride == 0
+           || M_index == d->n->NM-1;
+}//}}}
+
+static int
+interp_profile(hmpdf_obj *d, int z_index, int M_index, double *p)
+// Lagrange interpolation in log(M) between the (exactly computed) coarse masses,
+//     at fixed theta/theta_out.
+//     Where the profiles are positive, the logarithm is interpolated.
+{//{{{
+    STARTFCT
+
+    double mass_resc, theta_out, Rout;
+    SAFEHMPDF(profile_outer(d, z_index, M_index, &mass_resc, &theta_out, &Rout));
+    p[0] = theta_out;
+
+    int Ncoarse = Ncoarse_masses(d);
+    int n = GSL_MIN(PRMINTERP_ORDER, Ncoarse);
+    int k0 = M_index / d->p->Mstride - (n/2 - 1);
+    k0 = GSL_MAX(0, GSL_MIN(k0, Ncoarse-n));
+
+    double x = log(d->n->Mgrid[M_index]);
+    double w[PRMINTERP_ORDER];
+    double *pc[PRMINTERP_ORDER];
+    for (int ii=0; ii<n; ii++)
+    {
+        double xi = log(d->n->Mgrid[coarse_mass(d, k0+ii)]);
+        pc[ii] = d->p->profiles[z_index][coarse_mass(d, k0+ii)];
+        w[ii] = 1.0;
+        for (int jj=0; jj<n; jj++)
+        {
+            if (jj == ii) { continue; }
+            double xj = log(d->n->Mgrid[coarse_mass(d, k0+jj)]);
+            w[ii] *= (x - xj) / (xi - xj);
+        }
+    }
+
+    // includes the extrapolated central value
+    for (int ii=1; ii<d->p->Ntheta+2; ii++)
+    {
+        int positive = 1;
+        for (int jj=0; jj<n; jj++)
+        {
+            positive = positive && pc[jj][ii] > 0.0;
+        }
+
+        p[ii] = 0.0;
+        for (int jj=0; jj<n; jj++)
+        {
+            p[ii] += w[jj] * ((positive) ? log(pc[jj][ii]) : pc[jj][ii]);
+        }
+
+        if (positive)
+        {
+            p[ii] = exp(p[ii]);
+        }
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+check_interp_profiles(hmpdf_obj *d, int *ok)
+// compares the interpolated profiles at a few held-out masses
+//     (in the middle between coarse masses) with the exact ones
+{//{{{
+    STARTFCT
+
+    *ok = 1;
+
+    double *exact;
+    SAFEALLOC(exact, malloc((d->p->Ntheta+2) * sizeof(double)));
+
+    int Ncoarse = Ncoarse_masses(d);
+    for (int ii=0; ii<PRMINTERP_NCHECK; ii++)
+    {
+        // spread over redshifts and masses
+        int z_index = (PRMINTERP_NCHECK > 1)
+                      ? (ii * (d->n->Nz-1)) / (PRMINTERP_NCHECK-1)
+                      : 0;
+        int k = ((2*ii+1) * (Ncoarse-1)) / (2*PRMINTERP_NCHECK);
+        int M_index = (coarse_mass(d, k) + coarse_mass(d, k+1)) / 2;
+        if (is_coarse_mass(d, M_index)) { continue; }
+
+        SAFEHMPDF(exact_profile(d, z_index, M_index, exact));
+
+        double *interp = d->p->profiles[z_index][M_index];
+        double maxp = 0.0;
+        double maxerr = 0.0;
+        for (int jj=1; jj<=d->p->Ntheta; jj++)
+        {
+            maxp = GSL_MAX(maxp, fabs(exact[jj]));
+            maxerr = GSL_MAX(maxerr, fabs(interp[jj] - exact[jj]));
+        }
+
+        HMPDFPRINT(3, "\t\tmass interpolation error at z = %g, M = %g Msun/h : %g\n",
+                      d->n->zgrid[z_index], d->n->Mgrid[M_index]*d->c->h,
+                      maxerr/maxp);
+
+        if (maxerr > PRMINTERP_TOL * maxp) { *ok = 0; }
+
+        // we have it now, so use the exact one
+        memcpy(interp, exact, (d->p->Ntheta+2) * sizeof(double));
+    }
+
+    free(exact);
+
+    ENDFCT
+}//}}}
+//}}}
+
+// (z,M) task scheduling {{{
+typedef struct
+{//{{{
+    double cost;
+    int indx;
+}//}}}
+zM_task_t;
+
+static int
+zM_task_cmp(const void *a, const void *b)
+// sorts in order of decreasing cost, ties in the original order
+{//{{{
+    const zM_task_t *ta = (const zM_task_t *)a;
+    const zM_task_t *tb = (const zM_task_t *)b;
+    if (ta->cost != tb->cost) { return (ta->cost < tb->cost) - (ta->cost > tb->cost); }
+    return (ta->indx > tb->indx) - (ta->indx < tb->indx);
+}//}}}
+
+static int
+seed_zM_cost(hmpdf_obj *d)
+// cost model for the (z,M) tasks before any timings are available.
+//     The line-of-sight integrals run out to the outer radius,
+//     and the larger halos need more subdivisions to reach the absolute tolerance,
+//     so we use the physical extent.
+{//{{{
+    STARTFCT
+
+    SAFEALLOC(d->p->zM_cost, malloc(d->n->Nz * d->n->NM * sizeof(double)));
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
+    #endif
+    for (int ii=0; ii<d->n->Nz*d->n->NM; ii++)
+    {
+        CONTINUE_IF_ERR
+        double mass_resc, theta_out, Rout;
+        SAFEHMPDF_NORETURN(profile_outer(d, ii/d->n->NM, ii%d->n->NM,
+                                         &mass_resc, &theta_out, &Rout));
+        d->p->zM_cost[ii] = Rout;
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+zM_tasks(hmpdf_obj *d, int **order)
+// flattened (z,M) indices, z_index*NM+M_index,
+//     the most expensive ones first.
+//     Together with dynamic scheduling, this keeps all threads busy until the end.
+{//{{{
+    STARTFCT
+
+    int Nbins = d->n->Nz * d->n->NM;
+    SAFEALLOC(*order, malloc(Nbins * sizeof(int)));
+
+    if (d->p->zM_cost == NULL)
+    {
+        SAFEHMPDF(seed_zM_cost(d));
+    }
+
+    zM_task_t *tasks;
+    SAFEALLOC(tasks, malloc(Nbins * sizeof(zM_task_t)));
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        tasks[ii].cost = d->p->zM_cost[ii];
+        tasks[ii].indx = ii;
+    }
+    qsort(tasks, Nbins, sizeof(zM_task_t), zM_task_cmp);
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        (*order)[ii] = tasks[ii].indx;
+    }
+    free(tasks);
+
+    ENDFCT
+}//}}}
+//}}}
+
+static int
+fill_profiles(hmpdf_obj *d, int coarse, int exact)
+// computes the profiles for all masses that are (not) on the coarse grid,
+//     either exactly or by interpolation.
+//     The time taken by the exact computations replaces the model costs in zM_cost.
+{//{{{
+    STARTFCT
+
+    int *order;
+    SAFEHMPDF(zM_tasks(d, &order));
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int ii=0; ii<d->n->Nz*d->n->NM; ii++)
+    {
+        CONTINUE_IF_ERR
+        int z_index = order[ii] / d->n->NM;
+        int M_index = order[ii] % d->n->NM;
+        if (is_coarse_mass(d, M_index) != coarse) { continue; }
+
+        if (exact)
+        {
+            #ifdef _OPENMP
+            double t0 = omp_get_wtime();
+            #endif
+            SAFEHMPDF_NORETURN(exact_profile(d, z_index, M_index,
+                                             d->p->profiles[z_index][M_index]));
+            #ifdef _OPENMP
+            d->p->zM_cost[order[ii]] = omp_get_wtime() - t0;
+            #endif
+        }
+        else
+        {
+            SAFEHMPDF_NORETURN(interp_profile(d, z_index, M_index,
+                                              d->p->profiles[z_index][M_index]));
+        }
+    }
+
+    free(order);
+
+    ENDFCT
+}//}}}
+
+static int
+create_profiles(hmpdf_obj *d)
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\tcreate_profiles\n");
+
+    if (d->p->cache_dir != NULL)
+    {
+        int found;
+        SAFEHMPDF(profile_cache_load(d, cache_profiles, &found));
+        if (found) { return 0; }
+    }
+
+    SAFEHMPDF(create_gnfw_tables(d));
+    SAFEHMPDF(check_bcm_abel(d));
+    
+    SAFEHMPDF(new_profile_slab(d, d->p->Ntheta+2, &(d->p->profiles)));
+
+    // without mass interpolation, all masses are coarse
+    SAFEHMPDF(fill_profiles(d, 1, 1));
+
+    if (use_minterp(d))
+    {
+        #ifdef _OPENMP
+        // estimate the cost of the other masses from the closest coarse one
+        //     (only relevant if we need to compute them exactly later),
+        //     so that they are on the same scale as the measured ones
+        for (int ii=0; ii<d->n->Nz*d->n->NM; ii++)
+        {
+            int M_index = ii % d->n->NM;
+            if (is_coarse_mass(d, M_index)) { continue; }
+            d->p->zM_cost[ii]
+                = d->p->zM_cost[ii - M_index
+                                + coarse_mass(d, M_index/d->p->Mstride)];
+        }
+        #endif
+
+        SAFEHMPDF(fill_profiles(d, 0, 0));
+
+        int ok;
+        SAFEHMPDF(check_interp_profiles(d, &ok));
+        if (!ok)
+        {
+            // not an error, since we can recover
+            HMPDFPRINT(0, "WARNING: mass interpolation of the profiles is not accurate enough, "
+                          "computing all of them exactly. "
+                          "You should decrease hmpdf_profile_Mstride.\n");
+            SAFEHMPDF(fill_profiles(d, 0, 1));
+        }
+    }
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
+        CONTINUE_IF_ERR
+        for (int M_index=0; M_index<d->n->NM; M_index++)
+        {
+	        #ifdef SAVE_PROF
+            char buffer[512];
+            sprintf(buffer, "/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/profiles/profile_%.8f_%.8f.bin", d->n->zgrid[z_index], d->n->Mgrid[M_index]);
+            FILE *fp = fopen(buffer, "w");
+	        double theta_max=d->p->profiles[z_index][M_index][0];
+	        fwrite(&theta_max, sizeof(double), 1, fp);
+	        fwrite(d->p->decr_tgrid,sizeof(double),d->p->Ntheta, fp);
+	        fwrite(d->p->profiles[z_index][M_index]+1, sizeof(double), d->p->Ntheta, fp);
+            fclose(fp);
+            #endif
+
+            CONTINUE_IF_ERR
+            // if requested, save corresponding profiles to file
+            if (d->p->tot_profiles_indices)
+            {
+                int do_it = -1;
+                for (int ii=0; ii<d->p->tot_profiles_N; ii++)
+                    if (   z_index == d->p->tot_profiles_indices[2*ii]
+                        && M_index == d->p->tot_profiles_indices[2*ii+1])
+                    {
+                        do_it = ii;
+                        break;
+                    }
+
+                if (do_it >= 0)
+                    SAFEHMPDF_NORETURN(tot_profiles_to_file(d, z_index, M_index, d->p->tot_profiles_fnames[do_it]));
+            }
+        }
+    }
+
+    if (d->p->cache_dir != NULL)
+    {
+        SAFEHMPDF(profile_cache_save(d, cache_profiles));
+    }
+
+    ENDFCT
+}//}}}
+
+// FFTLog Hankel transforms {{{
+static int
+create_fftlog(hmpdf_obj *d)
+// prepares the zeroth order FFTLog on a logarithmic grid
+//     from decr_tgrid[Ntheta-1]/FFTLOG_PAD to FFTLOG_PAD
+//     (in units of the outer radius)
+{//{{{
+    STARTFCT
+
+    if (!d->p->fftlog || d->p->fftlog_u != NULL) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_fftlog\n");
+
+    double lnxlo = log(d->p->decr_tgrid[d->p->Ntheta-1] / FFTLOG_PAD);
+    double lnxhi = log(FFTLOG_PAD);
+
+    // sufficient resolution close to the outer radius
+    int N = 2;
+    while (N < FFTLOG_OVERSAMPLING * d->p->Ntheta * (lnxhi - lnxlo))
+    {
+        N *= 2;
+    }
+    d->p->fftlog_N = N;
+    d->p->fftlog_lnx0 = lnxlo;
+    d->p->fftlog_dlnx = (lnxhi - lnxlo) / (double)(N - 1);
+
+    HMPDFPRINT(3, "\t\tusing %d points\n", N);
+
+    // the Mellin transform of J_0, including the phase shift
+    //     due to the offset of the output grid
+    SAFEALLOC(d->p->fftlog_u, malloc((N/2+1) * sizeof(double complex)));
+    for (int m=0; m<=N/2; m++)
+    {
+        double eta = 2.0 * M_PI * (double)m / ((double)N * d->p->fftlog_dlnx);
+        gsl_sf_result lnr1, arg1, lnr2, arg2;
+        SAFEGSL(gsl_sf_lngamma_complex_e(0.5*FFTLOG_Q, 0.5*eta, &lnr1, &arg1));
+        SAFEGSL(gsl_sf_lngamma_complex_e(1.0-0.5*FFTLOG_Q, -0.5*eta, &lnr2, &arg2));
+        double complex lnu = (FFTLOG_Q - 1.0 + _Complex_I * eta) * M_LN2
+                             + lnr1.val - lnr2.val
+                             + _Complex_I * (arg1.val - arg2.val
+                                             + eta * (double)(N-1) * d->p->fftlog_dlnx);
+        d->p->fftlog_u[m] = cexp(lnu);
+    }
+    // the Nyquist frequency needs to be real
+    d->p->fftlog_u[N/2] = creal(d->p->fftlog_u[N/2]);
+
+    // batched transforms, all masses at once
+    double *buf;
+    SAFEALLOC(buf, fftw_malloc(d->n->NM * (N+2) * sizeof(double)));
+    SAFEALLOC(d->p->fftlog_r2c, malloc(sizeof(fftw_plan)));
+    *(d->p->fftlog_r2c) = fftw_plan_many_dft_r2c(1, &N, d->n->NM,
+                                                 buf, NULL, 1, N+2,
+                                                 (double complex *)buf, NULL, 1, N/2+1,
+                                                 FFTW_ESTIMATE);
+    SAFEALLOC(d->p->fftlog_c2r, malloc(sizeof(fftw_plan)));
+    *(d->p->fftlog_c2r) = fftw_plan_many_dft_c2r(1, &N, d->n->NM,
+                                                 (double complex *)buf, NULL, 1, N/2+1,
+                                                 buf, NULL, 1, N+2,
+                                                 FFTW_ESTIMATE);
+    fftw_free(buf);
+
+    ENDFCT
+}//}}}
+
+static int
+fftlog_hankel(hmpdf_obj *d, double lny0, double *buf)
+// computes int_0^infty dy y g(y) J_0(w y) in place for NM arrays (with stride N+2),
+//     input  g on ln(y) = lny0 + n*dlnx
+//     output on ln(w) = -lny0 - (N-1-n)*dlnx
+// thread safe
+{//{{{
+    STARTFCT
+
+    int N = d->p->fftlog_N;
+    double complex *c = (double complex *)buf;
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        for (int n=0; n<N; n++)
+        {
+            buf[M_index*(N+2)+n] *= exp((2.0-FFTLOG_Q) * (lny0 + (double)n * d->p->fftlog_dlnx));
+        }
+    }
+
+    fftw_execute_dft_r2c(*(d->p->fftlog_r2c), buf, c);
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        for (int m=0; m<=N/2; m++)
+        {
+            // conjugation reverses the sign of the exponent in the c2r
+            c[M_index*(N/2+1)+m] = conj(c[M_index*(N/2+1)+m] * d->p->fftlog_u[m]);
+        }
+    }
+
+    fftw_execute_dft_c2r(*(d->p->fftlog_c2r), c, buf);
+
+    double lnw0 = - lny0 - (double)(N-1) * d->p->fftlog_dlnx;
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        for (int n=0; n<N; n++)
+        {
+            buf[M_index*(N+2)+n] *= exp(-FFTLOG_Q * (lnw0 + (double)n * d->p->fftlog_dlnx))
+                                    / (double)N;
+        }
+    }
+
+    ENDFCT
+}//}}}
+
+static int
+fftlog_profiles(hmpdf_obj *d, int z_index, double *buf)
+// writes the conjugate space profiles at this redshift into buf,
+//     sampled on the logarithmic grid reciprocal to the FFTLog theta grid
+// thread safe
+{//{{{
+    STARTFCT
+
+    int N = d->p->fftlog_N;
+
+    double *temp;
+    SAFEALLOC(temp, malloc((d->p->Ntheta+1) * sizeof(double)));
+    gsl_spline *spl;
+    SAFEALLOC(spl, gsl_spline_alloc(gsl_interp_cspline, d->p->Ntheta+1));
+    gsl_interp_accel *acc;
+    SAFEALLOC(acc, gsl_interp_accel_alloc());
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        // profile with theta increasing, including theta=0
+        reverse(d->p->Ntheta+1, d->p->profiles[z_index][M_index]+1, temp);
+        SAFEGSL(gsl_spline_init(spl, d->p->incr_tgrid, temp, d->p->Ntheta+1));
+
+        for (int n=0; n<N; n++)
+        {
+            double x = exp(d->p->fftlog_lnx0 + (double)n * d->p->fftlog_dlnx);
+            if (x < d->p->incr_tgrid[d->p->Ntheta])
+            {
+                SAFEGSL(gsl_spline_eval_e(spl, x, acc, buf+M_index*(N+2)+n));
+            }
+            else
+            {
+                buf[M_index*(N+2)+n] = 0.0;
+            }
+        }
+    }
+
+    free(temp);
+    gsl_spline_free(spl);
+    gsl_interp_accel_free(acc);
+
+    SAFEHMPDF(fftlog_hankel(d, d->p->fftlog_lnx0, buf));
+
+    ENDFCT
+}//}}}
+
+static int
+fftlog_interp(hmpdf_obj *d, double lny0, double *in, int Nout, double *y, double *out)
+// interpolates in (on the FFTLog grid starting at lny0) to the Nout points y
+{//{{{
+    STARTFCT
+
+    int N = d->p->fftlog_N;
+
+    double *lny;
+    SAFEALLOC(lny, malloc(N * sizeof(double)));
+    for (int n=0; n<N; n++)
+    {
+        lny[n] = lny0 + (double)n * d->p->fftlog_dlnx;
+    }
+
+    gsl_spline *spl;
+    SAFEALLOC(spl, gsl_spline_alloc(gsl_interp_cspline, N));
+    SAFEGSL(gsl_spline_init(spl, lny, in, N));
+    gsl_interp_accel *acc;
+    SAFEALLOC(acc, gsl_interp_accel_alloc());
+
+    for (int ii=0; ii<Nout; ii++)
+    {
+        SAFEGSL(gsl_spline_eval_e(spl, log(y[ii]), acc, out+ii));
+    }
+
+    free(lny);
+    gsl_spline_free(spl);
+    gsl_interp_accel_free(acc);
+
+    ENDFCT
+}//}}}
+
+static int
+fftlog_conj_profiles(hmpdf_obj *d, int z_index)
+// FFTLog version of the conjugate profiles, interpolated to reci_tgrid
+{//{{{
+    STARTFCT
+
+    int N = d->p->fftlog_N;
+    double lnk0 = - d->p->fftlog_lnx0 - (double)(N-1) * d->p->fftlog_dlnx;
 
-    double rhos, rs;
-    SAFEHMPDF(NFW_fundamental(d, z_index, M_index, mass_resc, d->h->Duffy08_params, &rhos, &rs));
+    double *buf;
+    SAFEALLOC(buf, fftw_malloc(d->n->NM * (N+2) * sizeof(double)));
+    SAFEHMPDF(fftlog_profiles(d, z_index, buf));
 
-    for (int ii=0; ii<d->p->tot_profiles_Nr; ii++)
+    for (int M_index=0; M_index<d->n->NM; M_index++)
     {
-        double r = R200c * d->p->tot_profiles_r[ii];
-        double x = r / rs;
-        double rho = rhos / (x * gsl_pow_2(1.0+x));
-        fprintf(fp, "%.18e %.18e\n", r, rho);
+        SAFEHMPDF(fftlog_interp(d, lnk0, buf+M_index*(N+2),
+                                d->p->Ntheta, d->p->reci_tgrid,
+                                d->p->conj_profiles[z_index][M_index]+1));
+        d->p->conj_profiles[z_index][M_index][0]
+            = 1.0 / d->p->profiles[z_index][M_index][0];
     }
 
-    fclose(fp);
+    fftw_free(buf);
 
     ENDFCT
-}
+}//}}}
 
 static int
-create_profiles(hmpdf_obj *d)
+fftlog_filtered_profiles(hmpdf_obj *d, int z_index, double **out)
+// FFTLog version of the filtered profiles,
+//     interpolated to decr_tgrid
 {//{{{
     STARTFCT
 
-    HMPDFPRINT(2, "\tcreate_profiles\n");
-    
-    SAFEALLOC(d->p->profiles, malloc(d->n->Nz * sizeof(double **)));
-    SETARRNULL(d->p->profiles, d->n->Nz);
-    #ifdef _OPENMP
-    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
-    #endif
-    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    int N = d->p->fftlog_N;
+    double lnk0 = - d->p->fftlog_lnx0 - (double)(N-1) * d->p->fftlog_dlnx;
+
+    double *buf;
+    SAFEALLOC(buf, fftw_malloc(d->n->NM * (N+2) * sizeof(double)));
+    SAFEHMPDF(fftlog_profiles(d, z_index, buf));
+
+    // multiply with the window functions
+    double *ell;
+    SAFEALLOC(ell, malloc(N * sizeof(double)));
+    for (int M_index=0; M_index<d->n->NM; M_index++)
     {
-        CONTINUE_IF_ERR
-        SAFEALLOC_NORETURN(d->p->profiles[z_index], malloc(d->n->NM * sizeof(double *)));
-        SETARRNULL(d->p->profiles[z_index], d->n->NM);
-        for (int M_index=0; M_index<d->n->NM; M_index++)
+        for (int n=0; n<N; n++)
         {
-            CONTINUE_IF_ERR
-            SAFEALLOC_NORETURN(d->p->profiles[z_index][M_index],
-                               malloc((d->p->Ntheta+2) * sizeof(double)));
-            CONTINUE_IF_ERR 
-            SAFEHMPDF_NORETURN(profile(d, z_index, M_index,
-                                       d->p->profiles[z_index][M_index]));
-            CONTINUE_IF_ERR
-            SAFEHMPDF_NORETURN(fix_endpoints(d->p->Ntheta, d->p->decr_tgrid,
-                                             d->p->profiles[z_index][M_index]+1));
-	        #ifdef SAVE_PROF
-            char buffer[512];
-            sprintf(buffer, "/scratch/07833/tg871330/tSZ_maps/hmpdf_maps/profiles/profile_%.8f_%.8f.bin", d->n->zgrid[z_index], d->n->Mgrid[M_index]);
-            FILE *fp = fopen(buffer, "w");
-	        double theta_max=d->p->profiles[z_index][M_index][0];
-	        fwrite(&theta_max, sizeof(double), 1, fp);
-	        fwrite(d->p->decr_tgrid,sizeof(double),d->p->Ntheta, fp);
-	        fwrite(d->p->profiles[z_index][M_index]+1, sizeof(double), d->p->Ntheta, fp);
-            fclose(fp);
-            #endif
+            ell[n] = exp(lnk0 + (double)n * d->p->fftlog_dlnx)
+                     / d->p->profiles[z_index][M_index][0];
+        }
 
-            CONTINUE_IF_ERR
-            // if requested, save corresponding profiles to file
-            if (d->p->tot_profiles_indices)
-            {
-                int do_it = -1;
-                for (int ii=0; ii<d->p->tot_profiles_N; ii++)
-                    if (   z_index == d->p->tot_profiles_indices[2*ii]
-                        && M_index == d->p->tot_profiles_indices[2*ii+1])
-                    {
-                        do_it = ii;
-                        break;
-                    }
+        SAFEHMPDF(apply_filters(d, N, ell, buf+M_index*(N+2),
+                                buf+M_index*(N+2), 1, filter_pdf, &z_index));
+    }
+    free(ell);
 
-                if (do_it >= 0)
-                    SAFEHMPDF_NORETURN(tot_profiles_to_file(d, z_index, M_index, d->p->tot_profiles_fnames[do_it]));
-            }
-        }
+    // transform back to real space
+    SAFEHMPDF(fftlog_hankel(d, lnk0, buf));
+
+    for (int M_index=0; M_index<d->n->NM; M_index++)
+    {
+        out[M_index][0] = d->p->profiles[z_index][M_index][0];
+        SAFEHMPDF(fftlog_interp(d, d->p->fftlog_lnx0, buf+M_index*(N+2),
+                                d->p->Ntheta, d->p->decr_tgrid, out[M_index]+1));
+        SAFEHMPDF(fix_endpoints(d->p->Ntheta, d->p->decr_tgrid, out[M_index]+1));
     }
 
+    fftw_free(buf);
+
     ENDFCT
 }//}}}
+//}}}
 
 int
 create_conj_profiles(hmpdf_obj *d)
@@ -654,43 +2295,74 @@ create_conj_profiles(hmpdf_obj *d)
     
     // prepare the Hankel transform work space
     SAFEALLOC(d->p->dht_ws, gsl_dht_new(d->p->Ntheta, 0, 1.0));
-    SAFEALLOC(d->p->conj_profiles, malloc(d->n->Nz * sizeof(double **)));
-    SETARRNULL(d->p->conj_profiles, d->n->Nz);
-    #ifdef _OPENMP
-    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
-    #endif
-    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    SAFEHMPDF(create_fftlog(d));
+
+    if (d->p->cache_dir != NULL)
     {
-        CONTINUE_IF_ERR
-        // need buffer to store the profiles with theta increasing
-        // allocate inside z-loop for thread safety
-        double *temp;
-        SAFEALLOC_NORETURN(temp, malloc(d->p->Ntheta * sizeof(double)));
-        CONTINUE_IF_ERR
-        SAFEALLOC_NORETURN(d->p->conj_profiles[z_index],
-                           malloc(d->n->NM * sizeof(double *)));
-        CONTINUE_IF_ERR
-        SETARRNULL(d->p->conj_profiles[z_index], d->n->NM);
-        for (int M_index=0; M_index<d->n->NM; M_index++)
+        int found;
+        SAFEHMPDF(profile_cache_load(d, cache_conj_profiles, &found));
+        if (found)
+        {
+            d->p->created_conj_profiles = 1;
+            return 0;
+        }
+    }
+
+    SAFEHMPDF(new_profile_slab(d, d->p->Ntheta+1, &(d->p->conj_profiles)));
+
+    if (d->p->fftlog)
+    // FFTLog is batched over masses
+    {
+        #ifdef _OPENMP
+        #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+        #endif
+        for (int z_index=0; z_index<d->n->Nz; z_index++)
         {
             CONTINUE_IF_ERR
-            SAFEALLOC_NORETURN(d->p->conj_profiles[z_index][M_index],
-                               malloc((d->p->Ntheta+1) * sizeof(double)));
+            SAFEHMPDF_NORETURN(fftlog_conj_profiles(d, z_index));
+        }
+    }
+    else
+    {
+        // need buffer to store the profiles with theta increasing,
+        //     one per thread
+        double *temp;
+        SAFEALLOC(temp, malloc(d->Ncores * d->p->Ntheta * sizeof(double)));
+
+        // same ordering as for the real space profiles
+        int *order;
+        SAFEHMPDF(zM_tasks(d, &order));
+
+        #ifdef _OPENMP
+        #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+        #endif
+        for (int ii=0; ii<d->n->Nz*d->n->NM; ii++)
+        {
             CONTINUE_IF_ERR
-            reverse(d->p->Ntheta, d->p->profiles[z_index][M_index]+1, temp);
+            int z_index = order[ii] / d->n->NM;
+            int M_index = order[ii] % d->n->NM;
+            double *temp1 = temp + THIS_THREAD * d->p->Ntheta;
+
+            reverse(d->p->Ntheta, d->p->profiles[z_index][M_index]+1, temp1);
             // dht_ws is const under gsl_dht_apply, so this is thread safe
-            SAFEGSL_NORETURN(gsl_dht_apply(d->p->dht_ws, temp,
+            SAFEGSL_NORETURN(gsl_dht_apply(d->p->dht_ws, temp1,
                                            d->p->conj_profiles[z_index][M_index]+1));
             CONTINUE_IF_ERR
             d->p->conj_profiles[z_index][M_index][0]
                 = 1.0 / d->p->profiles[z_index][M_index][0];
         }
-        CONTINUE_IF_ERR
+
+        free(order);
         free(temp);
     }
 
     d->p->created_conj_profiles = 1;
 
+    if (d->p->cache_dir != NULL)
+    {
+        SAFEHMPDF(profile_cache_save(d, cache_conj_profiles));
+    }
+
     ENDFCT
 }//}}}
 
@@ -704,31 +2376,55 @@ create_filtered_profiles(hmpdf_obj *d)
 
     HMPDFPRINT(2, "\tcreate_filtered_profiles\n");
 
-    SAFEALLOC(d->p->filtered_profiles, malloc(d->n->Nz * sizeof(double **)));
-    SETARRNULL(d->p->filtered_profiles, d->n->Nz);
+    if (d->p->cache_dir != NULL)
+    {
+        int found;
+        SAFEHMPDF(profile_cache_load(d, cache_filtered_profiles, &found));
+        if (found)
+        {
+            d->p->created_filtered_profiles = 1;
+            return 0;
+        }
+    }
 
-    #ifdef _OPENMP
-    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
-    #endif
-    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    SAFEHMPDF(new_profile_slab(d, d->p->Ntheta+2, &(d->p->filtered_profiles)));
+
+    if (d->p->fftlog)
+    // FFTLog is batched over masses
     {
-        CONTINUE_IF_ERR
-        SAFEALLOC_NORETURN(d->p->filtered_profiles[z_index],
-                           malloc(d->n->NM * sizeof(double *)));
-        CONTINUE_IF_ERR
-        SETARRNULL(d->p->filtered_profiles[z_index], d->n->NM);
-        double *ell;
-        SAFEALLOC_NORETURN(ell, malloc(d->p->Ntheta * sizeof(double)));
-        CONTINUE_IF_ERR
-        double *temp;
-        SAFEALLOC_NORETURN(temp, malloc(d->p->Ntheta * sizeof(double))); // buffer
-        CONTINUE_IF_ERR
-        for (int M_index=0; M_index<d->n->NM; M_index++)
+        #ifdef _OPENMP
+        #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+        #endif
+        for (int z_index=0; z_index<d->n->Nz; z_index++)
         {
             CONTINUE_IF_ERR
-            SAFEALLOC_NORETURN(d->p->filtered_profiles[z_index][M_index],
-                               malloc((d->p->Ntheta+2) * sizeof(double)));
+            SAFEHMPDF_NORETURN(fftlog_filtered_profiles(d, z_index,
+                                                        d->p->filtered_profiles[z_index]));
+        }
+    }
+    else
+    {
+        // buffers, one per thread
+        double *ell_buf;
+        SAFEALLOC(ell_buf, malloc(d->Ncores * d->p->Ntheta * sizeof(double)));
+        double *temp_buf;
+        SAFEALLOC(temp_buf, malloc(d->Ncores * d->p->Ntheta * sizeof(double)));
+
+        // same ordering as for the real space profiles
+        int *order;
+        SAFEHMPDF(zM_tasks(d, &order));
+
+        #ifdef _OPENMP
+        #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+        #endif
+        for (int jj=0; jj<d->n->Nz*d->n->NM; jj++)
+        {
             CONTINUE_IF_ERR
+            int z_index = order[jj] / d->n->NM;
+            int M_index = order[jj] % d->n->NM;
+            double *ell = ell_buf + THIS_THREAD * d->p->Ntheta;
+            double *temp = temp_buf + THIS_THREAD * d->p->Ntheta;
+
             // set the outer radius
             d->p->filtered_profiles[z_index][M_index][0]
                 = d->p->profiles[z_index][M_index][0];
@@ -761,16 +2457,152 @@ create_filtered_profiles(hmpdf_obj *d)
             SAFEHMPDF_NORETURN(fix_endpoints(d->p->Ntheta, d->p->decr_tgrid,
                                              d->p->filtered_profiles[z_index][M_index]+1));
         }
-        CONTINUE_IF_ERR
-        free(temp);
-        free(ell);
+
+        free(order);
+        free(temp_buf);
+        free(ell_buf);
     }
 
     d->p->created_filtered_profiles = 1;
 
+    if (d->p->cache_dir != NULL)
+    {
+        SAFEHMPDF(profile_cache_save(d, cache_filtered_profiles));
+    }
+
+    ENDFCT
+}//}}}
+
+int
+create_pixelavg_profiles(hmpdf_obj *d)
+// computes the profiles averaged over a pixel,
+//     as a function of separation between halo and pixel center.
+// Uses the azimuthally averaged pixel window,
+//     consistent with the one-point PDF computation.
+// The averaging extends the support by half the pixel diagonal,
+//     so these profiles are tabulated out to this larger radius (stored in the zero entry).
+{//{{{
+    STARTFCT
+
+    if (d->p->created_pixelavg_profiles) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_pixelavg_profiles\n");
+
+    SAFEHMPDF(create_conj_profiles(d));
+
+    SAFEHMPDF(new_profile_slab(d, d->p->Ntheta+2, &(d->p->pixelavg_profiles)));
+
+    // The FFTLog grid only extends to FFTLOG_PAD outer radii,
+    //     which is not enough for halos much smaller than a pixel,
+    //     so we always interpolate the conjugate profiles and use the DHT.
+
+    // buffers, one per thread
+    double *ell_buf;
+    SAFEALLOC(ell_buf, malloc(d->Ncores * d->p->Ntheta * sizeof(double)));
+    double *temp_buf;
+    SAFEALLOC(temp_buf, malloc(d->Ncores * d->p->Ntheta * sizeof(double)));
+
+    // same ordering as for the real space profiles
+    int *order;
+    SAFEHMPDF(zM_tasks(d, &order));
+
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #endif
+    for (int jj=0; jj<d->n->Nz*d->n->NM; jj++)
+    {
+        CONTINUE_IF_ERR
+        int z_index = order[jj] / d->n->NM;
+        int M_index = order[jj] % d->n->NM;
+        double *ell = ell_buf + THIS_THREAD * d->p->Ntheta;
+        double *temp = temp_buf + THIS_THREAD * d->p->Ntheta;
+
+        double theta_ext = d->p->profiles[z_index][M_index][0]
+                           + M_SQRT1_2 * d->f->pixelside;
+        d->p->pixelavg_profiles[z_index][M_index][0] = theta_ext;
+
+        for (int ii=0; ii<d->p->Ntheta; ii++)
+        {
+            ell[ii] = d->p->reci_tgrid[ii] / theta_ext;
+        }
+
+        SAFEHMPDF_NORETURN(s_of_ell(d, z_index, M_index, d->p->Ntheta, ell, temp));
+        CONTINUE_IF_ERR
+        // s_of_ell includes the Hankel normalization,
+        //     the DHT below works in units of theta_ext
+        for (int ii=0; ii<d->p->Ntheta; ii++)
+        {
+            temp[ii] /= 2.0 * M_PI * gsl_pow_2(theta_ext);
+        }
+
+        SAFEHMPDF_NORETURN(apply_pixelfilter(d, d->p->Ntheta, ell, temp, temp));
+        CONTINUE_IF_ERR
+        SAFEGSL_NORETURN(gsl_dht_apply(d->p->dht_ws, temp,
+                                       d->p->pixelavg_profiles[z_index][M_index]+1));
+        CONTINUE_IF_ERR
+        reverse(d->p->Ntheta, d->p->pixelavg_profiles[z_index][M_index]+1,
+                              d->p->pixelavg_profiles[z_index][M_index]+1);
+        for (int ii=0; ii<d->p->Ntheta; ii++)
+        {
+            d->p->pixelavg_profiles[z_index][M_index][ii+1]
+                *= gsl_pow_2(d->p->reci_tgrid[d->p->Ntheta-1]);
+        }
+
+        SAFEHMPDF_NORETURN(fix_endpoints(d->p->Ntheta, d->p->decr_tgrid,
+                                         d->p->pixelavg_profiles[z_index][M_index]+1));
+    }
+
+    free(order);
+    free(temp_buf);
+    free(ell_buf);
+
+    d->p->created_pixelavg_profiles = 1;
+
     ENDFCT
 }//}}}
 
+static int
+find_segments(int Ntheta, double *pr, int *out)
+// returns the number of monotonic segments of the profile pr,
+//     if out != NULL, also writes the segment boundaries into it:
+//     0th element stores the number of segments,
+//     then the lower ends (sign encodes the gradient), then the last upper end
+{//{{{
+    // there's at least one segment
+    int Nsegments = 1;
+
+    // the first segment starts at the radial cut-off
+    if (out != NULL) { out[1] = 1; }
+
+    for (int ii=1; ii<Ntheta; ii++)
+    {
+        int sgn_lo = GSL_SIGN(pr[ii+1] - pr[ii]);
+        int sgn_hi = GSL_SIGN(pr[ii+2] - pr[ii+1]);
+        if (sgn_lo != sgn_hi) // change in gradient
+        {
+            ++Nsegments;
+            if (out != NULL)
+            {
+                out[Nsegments] = ii + 1;
+
+                // the sign of the segment lower ends encodes the gradient
+                out[Nsegments-1] *= sgn_lo;
+            }
+        }
+    }
+
+    if (out != NULL)
+    {
+        out[0] = Nsegments;
+        // the last segment ends at the cluster centre
+        out[Nsegments+1] = Ntheta + 1;
+        // get sign for last segment correct
+        out[Nsegments] *= GSL_SIGN(pr[Ntheta + 1] - pr[Ntheta]);
+    }
+
+    return Nsegments;
+}//}}}
+
 int
 create_segments(hmpdf_obj *d)
 {//{{{
@@ -780,95 +2612,111 @@ create_segments(hmpdf_obj *d)
 
     HMPDFPRINT(2, "\tcreate_segments\n");
 
-    SAFEALLOC(d->p->segment_boundaries,
-              malloc(d->n->Nz * sizeof(int **)));
-    SETARRNULL(d->p->segment_boundaries, d->n->Nz);
-
     // find the profiles we need to create the segments for
     double ***pr = (d->p->created_filtered_profiles) ?
                    d->p->filtered_profiles
                    : d->p->profiles;
 
+    // first pass : count the segments, so everything fits into one slab
+    int Nbins = d->n->Nz * d->n->NM;
+    SAFEALLOC(d->p->segment_offsets, malloc((Nbins+1) * sizeof(long)));
+    d->p->segment_offsets[0] = 0;
+
     #ifdef _OPENMP
-    #   pragma omp parallel for num_threads(d->Ncores) schedule(dynamic)
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
     #endif
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        // number of segments + lower ends + last upper end
+        d->p->segment_offsets[ii+1]
+            = 2 + find_segments(d->p->Ntheta, pr[ii/d->n->NM][ii%d->n->NM], NULL);
+    }
+
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        d->p->segment_offsets[ii+1] += d->p->segment_offsets[ii];
+    }
+
+    int *slab;
+    SAFEALLOC(slab, malloc(d->p->segment_offsets[Nbins] * sizeof(int)));
+    int **ptrs;
+    SAFEALLOC(ptrs, malloc(Nbins * sizeof(int *)));
+    SAFEALLOC(d->p->segment_boundaries, malloc(d->n->Nz * sizeof(int **)));
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        ptrs[ii] = slab + d->p->segment_offsets[ii];
+    }
     for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
-        CONTINUE_IF_ERR
-        SAFEALLOC_NORETURN(d->p->segment_boundaries[z_index],
-                           malloc(d->n->NM * sizeof(int *)));
-        CONTINUE_IF_ERR
-        SETARRNULL(d->p->segment_boundaries[z_index], d->n->NM);
-        for (int M_index=0; M_index<d->n->NM; M_index++)
-        {
-            CONTINUE_IF_ERR
-            int len = 10;
-            SAFEALLOC_NORETURN(d->p->segment_boundaries[z_index][M_index],
-                               malloc(len * sizeof(int)));
-            CONTINUE_IF_ERR
+        d->p->segment_boundaries[z_index] = ptrs + z_index * d->n->NM;
+    }
+
+    // second pass : fill the boundaries
+    #ifdef _OPENMP
+    #   pragma omp parallel for num_threads(d->Ncores) schedule(static)
+    #endif
+    for (int ii=0; ii<Nbins; ii++)
+    {
+        find_segments(d->p->Ntheta, pr[ii/d->n->NM][ii%d->n->NM], ptrs[ii]);
+    }
+
+    d->p->created_segments = 1;
+
+    ENDFCT
+}//}}}
+
+int
+rescale_profiles(hmpdf_obj *d, const double *invScrit)
+// changes the normalization of all existing convergence profiles
+//     from d->c->invScrit to invScrit (which is then copied into the former),
+//     the segments have to be recomputed afterwards
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\trescale_profiles\n");
+
+    double ***slabs[] = { d->p->profiles, d->p->conj_profiles,
+                          d->p->filtered_profiles, d->p->pixelavg_profiles, };
+    long strides[] = { d->p->Ntheta+2, d->p->Ntheta+1,
+                       d->p->Ntheta+2, d->p->Ntheta+2, };
+
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
+    {
+        if (d->c->invScrit[z_index] == 0.0) { continue; } // profiles are all zero
 
-            // 0th element stores the number of segments, it's at least one
-            d->p->segment_boundaries[z_index][M_index][0] = 1;
+        double r = invScrit[z_index] / d->c->invScrit[z_index];
 
-            // the first segment starts at the radial cut-off
-            d->p->segment_boundaries[z_index][M_index][1] = 1;
+        for (int ii=0; ii<(int)(sizeof slabs / sizeof slabs[0]); ii++)
+        {
+            if (slabs[ii] == NULL) { continue; }
 
-            for (int ii=1; ii<d->p->Ntheta; ii++)
+            for (int M_index=0; M_index<d->n->NM; M_index++)
             {
-                int sgn_lo = GSL_SIGN(pr[z_index][M_index][ii+1]
-                                      - pr[z_index][M_index][ii]);
-                int sgn_hi = GSL_SIGN(pr[z_index][M_index][ii+2]
-                                      - pr[z_index][M_index][ii+1]);
-                if (sgn_lo != sgn_hi) // change in gradient
+                // zero entry is the angular scale
+                for (long jj=1; jj<strides[ii]; jj++)
                 {
-                    ++(d->p->segment_boundaries[z_index][M_index][0]);
-                    
-                    // check if we still have enough space
-                    if (d->p->segment_boundaries[z_index][M_index][0]+2 >= len)
-                    {
-                        len *= 2;
-                        SAFEALLOC_NORETURN(d->p->segment_boundaries[z_index][M_index],
-                                           realloc(d->p->segment_boundaries[z_index][M_index],
-                                           len * sizeof(int)));
-                        CONTINUE_IF_ERR
-                    }
-                    d->p->segment_boundaries[z_index][M_index]
-                        [d->p->segment_boundaries[z_index][M_index][0]] = ii + 1;
-
-                    // the sign of the segment lower ends encodes the gradient
-                    d->p->segment_boundaries[z_index][M_index]
-                        [d->p->segment_boundaries[z_index][M_index][0]-1] *= sgn_lo;
+                    slabs[ii][z_index][M_index][jj] *= r;
                 }
             }
-
-            // the last segment ends at the cluster centre
-            d->p->segment_boundaries[z_index][M_index]
-                [d->p->segment_boundaries[z_index][M_index][0]+1] = d->p->Ntheta + 1;
-            // get sign for last segment correct
-            d->p->segment_boundaries[z_index][M_index]
-                [d->p->segment_boundaries[z_index][M_index][0]]
-                *= GSL_SIGN(pr[z_index][M_index][d->p->Ntheta + 1]
-                            - pr[z_index][M_index][d->p->Ntheta]);
         }
+
+        d->c->invScrit[z_index] = invScrit[z_index];
     }
 
-    d->p->created_segments = 1;
+    free_segments(d);
 
     ENDFCT
 }//}}}
 
-int
-s_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s)
-// returns signal(t) at z_index, M_index
-// t is in the rescaled units (by outer radius)
-// NOTE : this function is currently only used in the maps,
-//        so we are ALWAYS interpolating the un-filtered profiles
+static int
+s_of_t_1(hmpdf_obj *d, double *pr, long Nt, double *t, double *s)
+// interpolates the profile pr (as stored in d->p->profiles)
 {//{{{
     STARTFCT
 
     double *temp;
     SAFEALLOC(temp, malloc((d->p->Ntheta+1) * sizeof(double)));
-    reverse(d->p->Ntheta+1, d->p->profiles[z_index][M_index]+1, temp);
+    reverse(d->p->Ntheta+1, pr+1, temp);
     interp1d *interp;
     SAFEHMPDF(new_interp1d(d->p->Ntheta+1, d->p->incr_tgrid, temp, temp[0], 0.0,
                            PRINTERP_TYPE, d->p->incr_tgrid_accel[THIS_THREAD], &interp));
@@ -883,6 +2731,32 @@ s_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s)
     ENDFCT
 }//}}}
 
+int
+s_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s)
+// returns signal(t) at z_index, M_index
+// t is in the rescaled units (by outer radius)
+// NOTE : this function is currently only used in the maps,
+//        so we are ALWAYS interpolating the un-filtered profiles
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(s_of_t_1(d, d->p->profiles[z_index][M_index], Nt, t, s));
+
+    ENDFCT
+}//}}}
+
+int
+s_pixelavg_of_t(hmpdf_obj *d, int z_index, int M_index, long Nt, double *t, double *s)
+// same as s_of_t, but returns the signal averaged over a pixel
+//     whose center is at separation t
+{//{{{
+    STARTFCT
+
+    SAFEHMPDF(s_of_t_1(d, d->p->pixelavg_profiles[z_index][M_index], Nt, t, s));
+
+    ENDFCT
+}//}}}
+
 int
 s_of_ell(hmpdf_obj *d, int z_index, int M_index, int Nell, double *ell, double *s)
 // returns the conjugate space profile at z_index, M_index,
@@ -894,7 +2768,7 @@ s_of_ell(hmpdf_obj *d, int z_index, int M_index, int Nell, double *ell, double *
     SAFEHMPDF(new_interp1d(d->p->Ntheta, d->p->reci_tgrid,
                            d->p->conj_profiles[z_index][M_index]+1,
                            d->p->conj_profiles[z_index][M_index][1]/*low l*/, 0.0/*high l*/,
-                           SELL_INTERP_TYPE, d->p->reci_tgrid_accel, &interp));
+                           SELL_INTERP_TYPE, d->p->reci_tgrid_accel[THIS_THREAD], &interp));
     double hankel_norm = 2.0 * M_PI * gsl_pow_2(d->p->profiles[z_index][M_index][0]);
     for (int ii=0; ii<Nell; ii++)
     {
@@ -993,6 +2867,19 @@ inv_profile(hmpdf_obj *d, int z_index, int M_index, int segment,
 {//{{{
     STARTFCT
 
+    SAFEHMPDF(inv_profile_scaled(d, z_index, M_index, segment, mode, 1.0, b));
+
+    ENDFCT
+}//}}}
+
+int
+inv_profile_scaled(hmpdf_obj *d, int z_index, int M_index, int segment,
+                   inv_profile_e mode, double scale, batch_t *b)
+// same as inv_profile, but for the profile multiplied by scale > 0
+//     (which has the same segments), used for other source bins
+{//{{{
+    STARTFCT
+
     b->len = 0;
     b->data = NULL;
 
@@ -1009,7 +2896,7 @@ inv_profile(hmpdf_obj *d, int z_index, int M_index, int segment,
 
     // check if there is anything interesting here
     if (all_zero(len, pr+start,
-                 1e-1*(d->n->signalgrid[1]-d->n->signalgrid[0]))
+                 1e-1*(d->n->signalgrid[1]-d->n->signalgrid[0])/scale)
         || (len < min_size))
     {
         ENDFCT
@@ -1026,6 +2913,13 @@ inv_profile(hmpdf_obj *d, int z_index, int M_index, int segment,
     {
         reverse(len, pr+start, temp);
     }
+    if (scale != 1.0)
+    {
+        for (int ii=0; ii<len; ii++)
+        {
+            temp[ii] *= scale;
+        }
+    }
 
     double *ordinate;
     SAFEALLOC(ordinate, malloc(len * sizeof(double)));
@@ -1130,6 +3024,7 @@ init_profiles(hmpdf_obj *d)
     }
 
     SAFEHMPDF(create_angle_grids(d));
+    SAFEHMPDF(create_losquad(d));
     SAFEHMPDF(create_profiles(d));
 
     d->p->inited_profiles = 1;
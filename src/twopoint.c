@@ -13,6 +13,7 @@
 #include "power.h"
 #include "profiles.h"
 #include "onepoint.h"
+#include "covariance.h"
 
 #include "hmpdf.h"
 
@@ -26,6 +27,12 @@ null_twopoint(hmpdf_obj *d)
     d->tp->t = NULL;
     d->tp->ac = NULL;
     d->tp->au = NULL;
+    d->tp->bin2 = -1;
+    d->tp->dtsq2 = NULL;
+    d->tp->t2 = NULL;
+    d->tp->ac2 = NULL;
+    d->tp->au2 = NULL;
+    d->tp->PDFc2 = NULL;
     d->tp->ws = NULL;
     d->tp->last_phi = -1.0;
     d->tp->pdf = NULL;
@@ -34,72 +41,61 @@ null_twopoint(hmpdf_obj *d)
     ENDFCT
 }//}}}
 
-int
-reset_twopoint(hmpdf_obj *d)
+static void
+delete_batches(hmpdf_obj *d, batch_t ***x)
 {//{{{
-    STARTFCT
-
-    HMPDFPRINT(2, "\treset_twopoint\n");
-
-    if (d->tp->dtsq != NULL)
-    {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
-        {
-            if (d->tp->dtsq[z_index] != NULL)
-            {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
-                {
-                    if (d->tp->dtsq[z_index][M_index] != NULL)
-                    {
-                        for (int segment=0;
-                             segment<d->p->segment_boundaries[z_index][M_index][0];
-                             segment++)
-                        {
-                            delete_batch(d->tp->dtsq[z_index][M_index]+segment);
-                        }
-                        free(d->tp->dtsq[z_index][M_index]);
-                    }
-                }
-                free(d->tp->dtsq[z_index]);
-            }
-        }
-        free(d->tp->dtsq);
-    }
-    if (d->tp->t != NULL)
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        if (x[z_index] != NULL)
         {
-            if (d->tp->t[z_index] != NULL)
+            for (int M_index=0; M_index<d->n->NM; M_index++)
             {
-                for (int M_index=0; M_index<d->n->NM; M_index++)
+                if (x[z_index][M_index] != NULL)
                 {
-                    if (d->tp->t[z_index][M_index] != NULL)
+                    for (int segment=0;
+                         segment<d->p->segment_boundaries[z_index][M_index][0];
+                         segment++)
                     {
-                        for (int segment=0;
-                             segment<d->p->segment_boundaries[z_index][M_index][0];
-                             segment++)
-                        {
-                            delete_batch(d->tp->t[z_index][M_index]+segment);
-                        }
-                        free(d->tp->t[z_index][M_index]);
+                        delete_batch(x[z_index][M_index]+segment);
                     }
+                    free(x[z_index][M_index]);
                 }
-                free(d->tp->t[z_index]);
             }
+            free(x[z_index]);
         }
-        free(d->tp->t);
     }
-    if (d->tp->ac != NULL)
+    free(x);
+}//}}}
+
+static void
+delete_ac(hmpdf_obj *d, double complex **x)
+{//{{{
+    for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
-        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        if (x[z_index] != NULL)
         {
-            if (d->tp->ac[z_index] != NULL)
-            {
-                free(d->tp->ac[z_index]);
-            }
+            free(x[z_index]);
         }
-        free(d->tp->ac);
     }
+    free(x);
+}//}}}
+
+int
+reset_twopoint(hmpdf_obj *d)
+{//{{{
+    STARTFCT
+
+    HMPDFPRINT(2, "\treset_twopoint\n");
+
+    // the second pixel's quantities are only separate for another source bin
+    if (d->tp->dtsq2 != NULL && d->tp->dtsq2 != d->tp->dtsq) { delete_batches(d, d->tp->dtsq2); }
+    if (d->tp->t2 != NULL && d->tp->t2 != d->tp->t) { delete_batches(d, d->tp->t2); }
+    if (d->tp->ac2 != NULL && d->tp->ac2 != d->tp->ac) { delete_ac(d, d->tp->ac2); }
+    if (d->tp->au2 != NULL && d->tp->au2 != d->tp->au) { fftw_free(d->tp->au2); }
+    if (d->tp->PDFc2 != NULL) { fftw_free(d->tp->PDFc2); }
+    if (d->tp->dtsq != NULL) { delete_batches(d, d->tp->dtsq); }
+    if (d->tp->t != NULL) { delete_batches(d, d->tp->t); }
+    if (d->tp->ac != NULL) { delete_ac(d, d->tp->ac); }
     if (d->tp->au != NULL) { fftw_free(d->tp->au); }
     if (d->tp->ws != NULL)
     {
@@ -144,24 +140,22 @@ correct_phase2d(hmpdf_obj *d, double complex *x, int sgn)
     ENDFCT
 }//}}}
 
-int
-create_phi_indep(hmpdf_obj *d)
-// computes tp->dtsq, tp->t, tp->ac
+static int
+phi_indep_1(hmpdf_obj *d, const double *scale,
+            batch_t ****dtsq, batch_t ****t, double complex ***ac, double complex **au)
+// computes dtsq, t, ac, au for the profiles multiplied by scale[z_index]
+//     (NULL for the profiles as they are)
 {//{{{
     STARTFCT
 
-    if (d->tp->created_phi_indep) { return 0; }
-
-    HMPDFPRINT(2, "\tcreate_phi_indep\n");
-    
-    SAFEALLOC(d->tp->dtsq, malloc(d->n->Nz * sizeof(batch_t **)));
-    SETARRNULL(d->tp->dtsq, d->n->Nz);
-    SAFEALLOC(d->tp->t,    malloc(d->n->Nz * sizeof(batch_t **)));
-    SETARRNULL(d->tp->t,    d->n->Nz);
-    SAFEALLOC(d->tp->ac,   malloc(d->n->Nz * sizeof(double complex *)));
-    SETARRNULL(d->tp->ac,   d->n->Nz);
-    SAFEALLOC(d->tp->au,   fftw_malloc((d->n->Nsignal/2+1) * sizeof(double complex)));
-    double *au_real = (double *)(d->tp->au);
+    SAFEALLOC(*dtsq, malloc(d->n->Nz * sizeof(batch_t **)));
+    SETARRNULL(*dtsq, d->n->Nz);
+    SAFEALLOC(*t,    malloc(d->n->Nz * sizeof(batch_t **)));
+    SETARRNULL(*t,    d->n->Nz);
+    SAFEALLOC(*ac,   malloc(d->n->Nz * sizeof(double complex *)));
+    SETARRNULL(*ac,   d->n->Nz);
+    SAFEALLOC(*au,   fftw_malloc((d->n->Nsignal/2+1) * sizeof(double complex)));
+    double *au_real = (double *)(*au);
 
     double *tempc_real;
     SAFEALLOC(tempc_real, fftw_malloc((d->n->Nsignal+2)*sizeof(double)));
@@ -169,18 +163,18 @@ create_phi_indep(hmpdf_obj *d)
     fftw_plan plan_c = fftw_plan_dft_r2c_1d(d->n->Nsignal, tempc_real,
                                             tempc_comp, FFTW_MEASURE);
     fftw_plan plan_u = fftw_plan_dft_r2c_1d(d->n->Nsignal, au_real,
-                                            d->tp->au, FFTW_MEASURE);
+                                            *au, FFTW_MEASURE);
 
     // zero the unclustered array
-    zero_comp(d->n->Nsignal/2+1, d->tp->au);
+    zero_comp(d->n->Nsignal/2+1, *au);
 
     for (int z_index=0; z_index<d->n->Nz; z_index++)
     {
-        SAFEALLOC(d->tp->dtsq[z_index], malloc(d->n->NM * sizeof(batch_t *)));
-        SETARRNULL(d->tp->dtsq[z_index], d->n->NM);
-        SAFEALLOC(d->tp->t[z_index],    malloc(d->n->NM * sizeof(batch_t *)));
-        SETARRNULL(d->tp->t[z_index],    d->n->NM);
-        SAFEALLOC(d->tp->ac[z_index],   malloc((d->n->Nsignal/2+1) * sizeof(double complex)));
+        SAFEALLOC((*dtsq)[z_index], malloc(d->n->NM * sizeof(batch_t *)));
+        SETARRNULL((*dtsq)[z_index], d->n->NM);
+        SAFEALLOC((*t)[z_index],    malloc(d->n->NM * sizeof(batch_t *)));
+        SETARRNULL((*t)[z_index],    d->n->NM);
+        SAFEALLOC((*ac)[z_index],   malloc((d->n->Nsignal/2+1) * sizeof(double complex)));
 
         // zero the FFT array
         zero_real(d->n->Nsignal+2, tempc_real);
@@ -192,10 +186,10 @@ create_phi_indep(hmpdf_obj *d)
             double n = d->h->hmf[z_index][M_index];
             double b = d->h->bias[z_index][M_index];
 
-            SAFEALLOC(d->tp->dtsq[z_index][M_index],
+            SAFEALLOC((*dtsq)[z_index][M_index],
                       malloc(d->p->segment_boundaries[z_index][M_index][0]
                              * sizeof(batch_t)));
-            SAFEALLOC(d->tp->t[z_index][M_index],
+            SAFEALLOC((*t)[z_index][M_index],
                       malloc(d->p->segment_boundaries[z_index][M_index][0]
                              * sizeof(batch_t)));
 
@@ -203,29 +197,31 @@ create_phi_indep(hmpdf_obj *d)
                  segment<d->p->segment_boundaries[z_index][M_index][0];
                  segment++)
             {
-                SAFEHMPDF(inv_profile(d, z_index, M_index, segment,
-                                      dtsq_of_s, d->tp->dtsq[z_index][M_index]+segment));
-                SAFEHMPDF(inv_profile(d, z_index, M_index, segment,
-                                      t_of_s, d->tp->t[z_index][M_index]+segment));
+                SAFEHMPDF(inv_profile_scaled(d, z_index, M_index, segment, dtsq_of_s,
+                                             (scale == NULL) ? 1.0 : scale[z_index],
+                                             (*dtsq)[z_index][M_index]+segment));
+                SAFEHMPDF(inv_profile_scaled(d, z_index, M_index, segment, t_of_s,
+                                             (scale == NULL) ? 1.0 : scale[z_index],
+                                             (*t)[z_index][M_index]+segment));
 
                 // sanity check
-                HMPDFCHECK(not_monotonic(d->tp->t[z_index][M_index][segment].len,
-                                         d->tp->t[z_index][M_index][segment].data,
+                HMPDFCHECK(not_monotonic((*t)[z_index][M_index][segment].len,
+                                         (*t)[z_index][M_index][segment].data,
                                          -1),
                            "theta values not monotonically decreasing in "
                            "z = %d, M = %d, segment = %d",
                            z_index, M_index, segment);
 
-                for (long signalindex=d->tp->t[z_index][M_index][segment].start, ii=0;
-                     ii < d->tp->t[z_index][M_index][segment].len;
-                     signalindex += d->tp->t[z_index][M_index][segment].incr, ii++)
+                for (long signalindex=(*t)[z_index][M_index][segment].start, ii=0;
+                     ii < (*t)[z_index][M_index][segment].len;
+                     signalindex += (*t)[z_index][M_index][segment].incr, ii++)
                 {
                     au_real[signalindex] += M_PI * n
-                                            * d->tp->dtsq[z_index][M_index][segment].data[ii]
+                                            * (*dtsq)[z_index][M_index][segment].data[ii]
                                             * d->n->Mweights[M_index] * d->n->zweights[z_index]
                                             * gsl_pow_2(d->c->comoving[z_index]) / d->c->hubble[z_index];
                     tempc_real[signalindex] += M_PI * n * b
-                                               * d->tp->dtsq[z_index][M_index][segment].data[ii]
+                                               * (*dtsq)[z_index][M_index][segment].data[ii]
                                                * d->n->Mweights[M_index];
                 }
             }
@@ -238,22 +234,109 @@ create_phi_indep(hmpdf_obj *d)
         // write into the output array, subtracting the zero mode
         for (int ii=0; ii<(int)d->n->Nsignal/2+1; ii++)
         {
-            d->tp->ac[z_index][ii] = tempc_comp[ii] - tempc_comp[0];
+            (*ac)[z_index][ii] = tempc_comp[ii] - tempc_comp[0];
         }
     }
     // perform FFT for unclustered term
     fftw_execute(plan_u);
     // correct phases
-    SAFEHMPDF(correct_phase1d(d, d->tp->au, 1));
+    SAFEHMPDF(correct_phase1d(d, *au, 1));
     // subtract zero mode of unclustered contribution
     for (int ii=(int)d->n->Nsignal/2; ii>=0; ii--)
     {
-        d->tp->au[ii] -= d->tp->au[0];
+        (*au)[ii] -= (*au)[0];
     }
     fftw_free(tempc_real);
     fftw_destroy_plan(plan_c);
     fftw_destroy_plan(plan_u);
 
+    ENDFCT
+}//}}}
+
+static double
+bin2_scale(hmpdf_obj *d, int z_index)
+// ratio of the profiles in the second pixel's source bin to the current ones
+{//{{{
+    if (d->c->invScrit[z_index] == 0.0) { return 1.0; } // profiles are all zero
+
+    return d->c->invScrit_bins[d->tp->bin2*d->n->Nz+z_index] / d->c->invScrit[z_index];
+}//}}}
+
+static int
+create_op_bin2(hmpdf_obj *d)
+// one-point PDF in the second pixel's source bin,
+//     assembled from the phi-independent quantities
+{//{{{
+    STARTFCT
+
+    SAFEALLOC(d->tp->PDFc2, fftw_malloc((d->n->Nsignal + 2) * sizeof(double)));
+    double complex *PDFc2_comp = (double complex *)d->tp->PDFc2;
+    fftw_plan plan = fftw_plan_dft_c2r_1d(d->n->Nsignal, PDFc2_comp, d->tp->PDFc2, FFTW_ESTIMATE);
+
+    for (long ii=0; ii<d->n->Nsignal/2+1; ii++)
+    {
+        double complex temp = d->tp->au2[ii];
+        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        {
+            temp += 0.5 * d->c->Dsq[z_index] * d->pwr->autocorr
+                    * gsl_pow_4(d->c->comoving[z_index])
+                    / d->c->hubble[z_index] * d->n->zweights[z_index]
+                    * d->tp->ac2[z_index][ii] * d->tp->ac2[z_index][ii];
+        }
+        PDFc2_comp[ii] = cexp(temp)/(double)(d->n->Nsignal);
+    }
+
+    SAFEHMPDF(correct_phase1d(d, PDFc2_comp, -1));
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    double norm = 0.0;
+    d->tp->signalmeanc2 = 0.0;
+    for (long ii=0; ii<d->n->Nsignal; ii++)
+    {
+        d->tp->signalmeanc2 += d->tp->PDFc2[ii] * d->n->signalgrid[ii];
+        norm += d->tp->PDFc2[ii];
+    }
+    d->tp->signalmeanc2 /= norm;
+
+    ENDFCT
+}//}}}
+
+int
+create_phi_indep(hmpdf_obj *d)
+// computes tp->dtsq, tp->t, tp->ac,
+//     and the same for the second pixel if it is in another source bin
+{//{{{
+    STARTFCT
+
+    if (d->tp->created_phi_indep) { return 0; }
+
+    HMPDFPRINT(2, "\tcreate_phi_indep\n");
+
+    SAFEHMPDF(phi_indep_1(d, NULL, &d->tp->dtsq, &d->tp->t, &d->tp->ac, &d->tp->au));
+
+    if (d->tp->bin2 < 0)
+    {
+        d->tp->dtsq2 = d->tp->dtsq;
+        d->tp->t2 = d->tp->t;
+        d->tp->ac2 = d->tp->ac;
+        d->tp->au2 = d->tp->au;
+    }
+    else
+    // the profiles only differ by a z-dependent factor, so the segments are the same
+    {
+        double *scale;
+        SAFEALLOC(scale, malloc(d->n->Nz * sizeof(double)));
+        for (int z_index=0; z_index<d->n->Nz; z_index++)
+        {
+            scale[z_index] = bin2_scale(d, z_index);
+        }
+        SAFEHMPDF(phi_indep_1(d, scale, &d->tp->dtsq2, &d->tp->t2, &d->tp->ac2, &d->tp->au2));
+        free(scale);
+
+        SAFEHMPDF(create_op_bin2(d));
+    }
+
     d->tp->created_phi_indep = 1;
 
     ENDFCT
@@ -276,6 +359,13 @@ tp_segmentsum(hmpdf_obj *d, int z_index, int M_index, double phi, twopoint_works
     double n = d->h->hmf[z_index][M_index];
     double b = d->h->bias[z_index][M_index];
 
+    // the pixels can be in different source bins
+    batch_t *tb1 = d->tp->t[z_index][M_index];
+    batch_t *tb2 = d->tp->t2[z_index][M_index];
+    batch_t *dtsqb1 = d->tp->dtsq[z_index][M_index];
+    batch_t *dtsqb2 = d->tp->dtsq2[z_index][M_index];
+    int symm = d->tp->bin2 < 0;
+
     for (int segment1 = 0;
          segment1 < d->p->segment_boundaries[z_index][M_index][0];
          segment1++)
@@ -286,25 +376,25 @@ tp_segmentsum(hmpdf_obj *d, int z_index, int M_index, double phi, twopoint_works
         {
             // loop such that the theta values are always monotonically decreasing
             // so that we know when to break
-            for (long signalindex1 = d->tp->t[z_index][M_index][segment1].start, ii=0;
-                 ii < d->tp->t[z_index][M_index][segment1].len;
-                 signalindex1 += d->tp->t[z_index][M_index][segment1].incr, ii++)
+            for (long signalindex1 = tb1[segment1].start, ii=0;
+                 ii < tb1[segment1].len;
+                 signalindex1 += tb1[segment1].incr, ii++)
             // loop over the direction that is Nsignal long
             {
-                double t1 = d->tp->t[z_index][M_index][segment1].data[ii];
+                double t1 = tb1[segment1].data[ii];
                 // t1 is monotonically decreasing with ii
 
                 // check if no triangle can be formed anymore, since t1 only decreases
                 if (phi >= t1 + d->p->profiles[z_index][M_index][0]) { break; }
 
-                for (long signalindex2 = d->tp->t[z_index][M_index][segment2].start, jj=0;
-                     (jj < d->tp->t[z_index][M_index][segment2].len)
-                      && (signalindex2 <= signalindex1);
-                     // compute only half of the matrix, because it's symmetric
-                     signalindex2 += d->tp->t[z_index][M_index][segment2].incr, jj++)
+                for (long signalindex2 = tb2[segment2].start, jj=0;
+                     (jj < tb2[segment2].len)
+                      && (!symm || signalindex2 <= signalindex1);
+                     // compute only half of the matrix if it's symmetric
+                     signalindex2 += tb2[segment2].incr, jj++)
                 // loop over the direction that is Nsignal+2 long
                 {
-                    double t2 = d->tp->t[z_index][M_index][segment2].data[jj];
+                    double t2 = tb2[segment2].data[jj];
                     // t2 is monotonically decreasing with jj
 
                     // check if we can form a triangle
@@ -314,8 +404,8 @@ tp_segmentsum(hmpdf_obj *d, int z_index, int M_index, double phi, twopoint_works
 
                     double Delta = triang_A(phi, t1, t2);
                     double temp = 0.25 * n * Delta
-                                  * d->tp->dtsq[z_index][M_index][segment1].data[ii]
-                                  * d->tp->dtsq[z_index][M_index][segment2].data[jj]
+                                  * dtsqb1[segment1].data[ii]
+                                  * dtsqb2[segment2].data[jj]
                                   * d->n->Mweights[M_index];
 
                     // add to clustered term
@@ -334,6 +424,54 @@ tp_segmentsum(hmpdf_obj *d, int z_index, int M_index, double phi, twopoint_works
     ENDFCT
 }//}}}
 
+static int
+tp_linesum(hmpdf_obj *d, int z_index, int M_index, twopoint_workspace *ws)
+// zero separation with the pixels in different source bins,
+//     where each halo contributes to the line signal2 = bin2_scale * signal1
+//     (deposited linearly onto the signal grid)
+{//{{{
+    STARTFCT
+
+    double n = d->h->hmf[z_index][M_index];
+    double b = d->h->bias[z_index][M_index];
+    double r = bin2_scale(d, z_index);
+    double dsignal = d->n->signalgrid[1] - d->n->signalgrid[0];
+
+    for (int segment=0;
+         segment<d->p->segment_boundaries[z_index][M_index][0];
+         segment++)
+    {
+        batch_t *tb = d->tp->t[z_index][M_index] + segment;
+        batch_t *dtsqb = d->tp->dtsq[z_index][M_index] + segment;
+
+        for (long signalindex1 = tb->start, ii=0;
+             ii < tb->len;
+             signalindex1 += tb->incr, ii++)
+        {
+            double x = (r * d->n->signalgrid[signalindex1] - d->n->signalgrid[0])
+                       / dsignal;
+            if (x < 0.0 || x >= (double)(d->n->Nsignal-1)) { continue; }
+            long signalindex2 = (long)x;
+            double w = x - (double)signalindex2;
+
+            double temp = M_PI * n * dtsqb->data[ii] * d->n->Mweights[M_index];
+            long idx = signalindex1*(d->n->Nsignal+2)+signalindex2;
+
+            // add to clustered term
+            ws->tempc_real[idx]   += (1.0 - w) * temp * b;
+            ws->tempc_real[idx+1] += w * temp * b;
+
+            // add to unclustered term
+            temp *= gsl_pow_2(d->c->comoving[z_index])
+                    / d->c->hubble[z_index] * d->n->zweights[z_index];
+            ws->pdf_real[idx]   += (1.0 - w) * temp;
+            ws->pdf_real[idx+1] += w * temp;
+        }
+    }
+
+    ENDFCT
+}//}}}
+
 static int
 tp_Mint(hmpdf_obj *d, int z_index, double phi, twopoint_workspace *ws)
 // adds to pdf_real, with the required zweight * Mweight, including the unclustered 1pt PDF contributions
@@ -347,7 +485,14 @@ tp_Mint(hmpdf_obj *d, int z_index, double phi, twopoint_workspace *ws)
 
     for (int M_index=0; M_index<d->n->NM; M_index++)
     {
-        SAFEHMPDF(tp_segmentsum(d, z_index, M_index, phi, ws));
+        if (phi > 0.0)
+        {
+            SAFEHMPDF(tp_segmentsum(d, z_index, M_index, phi, ws));
+        }
+        else
+        {
+            SAFEHMPDF(tp_linesum(d, z_index, M_index, ws));
+        }
     }
 
     ENDFCT
@@ -381,7 +526,7 @@ clustered_term(hmpdf_obj *d, int z_index, double corr_phi_2, double corr_phi,
     STARTFCT
 
     double complex a1 = redundant(d->n->Nsignal, d->tp->ac[z_index], i1);
-    double complex a2 = d->tp->ac[z_index][i2];
+    double complex a2 = d->tp->ac2[z_index][i2];
     double complex b = b12[i1*(d->n->Nsignal/2+1)+i2]
                        - b12[i1*(d->n->Nsignal/2+1)]
                        - b12[i2] + b12[0];
@@ -429,7 +574,10 @@ tp_zint(hmpdf_obj *d, double phi, twopoint_workspace *ws)
         SAFEHMPDF(tp_Mint(d, z_index, phi, ws));
 
         // symmetrize the clustered beta matrix
-        SAFEHMPDF(symmetrize(d, ws->tempc_real));
+        if (d->tp->bin2 < 0)
+        {
+            SAFEHMPDF(symmetrize(d, ws->tempc_real));
+        }
 
         // perform the FFT on the clustered part tempc_real -> tempc_comp
         fftw_execute(ws->pc_r2c);
@@ -438,8 +586,15 @@ tp_zint(hmpdf_obj *d, double phi, twopoint_workspace *ws)
 
         // compute the correlation function interpolator
         double corr_phi_2, corr_phi;
-        SAFEHMPDF(corr(d, z_index, 0.5*phi, &corr_phi_2));
-        SAFEHMPDF(corr(d, z_index, phi, &corr_phi));
+        if (phi > 0.0)
+        {
+            SAFEHMPDF(corr(d, z_index, 0.5*phi, &corr_phi_2));
+            SAFEHMPDF(corr(d, z_index, phi, &corr_phi));
+        }
+        else
+        {
+            corr_phi_2 = corr_phi = d->c->Dsq[z_index] * d->pwr->autocorr;
+        }
 
         // add to the clustered output
         for (long ii=0; ii<d->n->Nsignal; ii++)
@@ -464,15 +619,23 @@ tp_zint(hmpdf_obj *d, double phi, twopoint_workspace *ws)
 
 int
 create_tp(hmpdf_obj *d, double phi, twopoint_workspace *ws)
-// computes one 2pt PDF
+// computes one 2pt PDF,
+//     phi = 0 is only allowed if the pixels are in different source bins
+//     and gives their joint PDF in a single pixel
 {//{{{
     STARTFCT
 
+    HMPDFCHECK(phi <= 0.0 && d->tp->bin2 < 0,
+               "zero pixel separation requires two different source bins.");
+
     // perform the redshift integration
     SAFEHMPDF(tp_zint(d, phi, ws));
 
     // symmetrize the unclustered part
-    SAFEHMPDF(symmetrize(d, ws->pdf_real));
+    if (d->tp->bin2 < 0)
+    {
+        SAFEHMPDF(symmetrize(d, ws->pdf_real));
+    }
     
     // perform the FFT on the unclustered part pdf_real -> pdf_comp
     fftw_execute(ws->pu_r2c);
@@ -492,7 +655,7 @@ create_tp(hmpdf_obj *d, double phi, twopoint_workspace *ws)
                 = cexp(ws->pdf_comp[ii*(d->n->Nsignal/2+1)+jj]
                        - ws->pdf_comp[ii*(d->n->Nsignal/2+1)]
                        - ws->pdf_comp[jj] + ws->pdf_comp[0]
-                       + d->tp->au[jj] + redundant(d->n->Nsignal, d->tp->au, ii)
+                       + d->tp->au2[jj] + redundant(d->n->Nsignal, d->tp->au, ii)
                        + ws->bc[ii*(d->n->Nsignal/2+1)+jj])
                   / gsl_pow_2((double)(d->n->Nsignal));
         }
@@ -577,6 +740,41 @@ new_tp_ws(long N, twopoint_workspace **out)
 
 #undef NEWTPWS_SAFEALLOC
 
+int
+select_tp_bin2(hmpdf_obj *d, int bin2)
+// sets the source bin of the second pixel for the two-point PDF and the covariance
+//     (-1 for the selected one), everything depending on it is discarded if it changes
+{//{{{
+    STARTFCT
+
+    if (bin2 == d->n->source_bin) { bin2 = -1; }
+
+    if (bin2 == d->tp->bin2) { return 0; }
+
+    HMPDFPRINT(2, "\tselect_tp_bin2\n");
+
+    SAFEHMPDF(reset_twopoint(d));
+    SAFEHMPDF(reset_covariance(d));
+    SAFEHMPDF(null_twopoint(d));
+    SAFEHMPDF(null_covariance(d));
+
+    d->tp->bin2 = bin2;
+
+    ENDFCT
+}//}}}
+
+static int
+tp_phi_changed(hmpdf_obj *d, double phi)
+// whether phi differs from the one the current two-point PDF was computed for,
+//     without dividing by zero (-ffast-math assumes finite arithmetic)
+{//{{{
+    if (d->tp->last_phi == phi)
+        return 0;
+    if (phi == 0.0)
+        return 1;
+    return fabs(1.0 - d->tp->last_phi/phi) > TP_PHI_EQ_TOL;
+}//}}}
+
 static int
 prepare_tp(hmpdf_obj *d, double phi)
 {//{{{
@@ -617,7 +815,8 @@ prepare_tp(hmpdf_obj *d, double phi)
                d->n->Nsignal * sizeof(double));
     }
 
-    if (d->ns->have_noise)
+    // the noise is only defined for a single source population
+    if (d->ns->have_noise && d->tp->bin2 < 0)
     {
         SAFEHMPDF(create_noise_matr_conv(d, 1/*need only one buffer*/));
         SAFEHMPDF(create_noisy_tp(d, phi));
@@ -635,8 +834,10 @@ hmpdf_get_tp(hmpdf_obj *d, double phi, int Nbins, double binedges[Nbins+1], doub
 
     SAFEHMPDF(pdf_check_user_input(d, Nbins, binedges, noisy));
 
+    SAFEHMPDF(select_tp_bin2(d, -1));
+
     // perform computation if necessary
-    if (fabs(1.0 - d->tp->last_phi/phi) > TP_PHI_EQ_TOL)
+    if (tp_phi_changed(d, phi))
     {
         SAFEHMPDF(prepare_tp(d, phi));
     }
@@ -654,3 +855,39 @@ hmpdf_get_tp(hmpdf_obj *d, double phi, int Nbins, double binedges[Nbins+1], doub
     ENDFCT
 }//}}}
 
+int
+hmpdf_get_tp_cross(hmpdf_obj *d, double phi, int bin2, int Nbins, double binedges[Nbins+1], double tp[Nbins*Nbins])
+{//{{{
+    STARTFCT
+
+    CHECKINIT;
+
+    HMPDFCHECK(d->n->source_N == 0,
+               "hmpdf_get_tp_cross requires hmpdf_source_N to be passed");
+    HMPDFCHECK(bin2 < 0 || bin2 >= d->n->source_N,
+               "source bin %d out of range [0, %d)", bin2, d->n->source_N);
+
+    SAFEHMPDF(pdf_check_user_input(d, Nbins, binedges, 0));
+
+    SAFEHMPDF(select_tp_bin2(d, bin2));
+
+    // perform computation if necessary
+    if (tp_phi_changed(d, phi))
+    {
+        SAFEHMPDF(prepare_tp(d, phi));
+    }
+    d->tp->last_phi = phi;
+
+    double _binedges1[Nbins+1];
+    double _binedges2[Nbins+1];
+    SAFEHMPDF(pdf_adjust_binedges(d, Nbins, binedges, _binedges1, d->op->signalmeanc));
+    SAFEHMPDF(pdf_adjust_binedges(d, Nbins, binedges, _binedges2,
+                                  (d->tp->bin2 < 0) ? d->op->signalmeanc
+                                                    : d->tp->signalmeanc2));
+
+    HMPDFPRINT(3, "\t\tbinning the twopoint pdf\n");
+    SAFEHMPDF(bin_2d_asym(d->n->Nsignal, d->n->signalgrid, d->tp->pdf,
+                          TPINTEGR_N, Nbins, _binedges1, _binedges2, tp, TPINTERP_TYPE));
+
+    ENDFCT
+}//}}}
@@ -443,6 +443,19 @@ isfile(char *fname)
     }
 }//}}}
 
+uint64_t
+hash_bytes(uint64_t h, const void *data, size_t len)
+// 64bit FNV-1a
+{//{{{
+    const unsigned char *c = (const unsigned char *)data;
+    for (size_t ii=0; ii<len; ii++)
+    {
+        h ^= (uint64_t)c[ii];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}//}}}
+
 struct
 interp1d_s
 {//{{{
@@ -744,6 +757,20 @@ bin_2d(int N, double *x, double *z, int Nsample,
 {//{{{
     STARTFCT
 
+    SAFEHMPDF(bin_2d_asym(N, x, z, Nsample, Nbins, binedges, binedges, out, m));
+
+    ENDFCT
+}//}}}
+
+int
+bin_2d_asym(int N, double *x, double *z, int Nsample,
+            int Nbins, double *binedges1, double *binedges2,
+            double *out, interp2d_mode m)
+// z need not be symmetric, binedges1 are for its first (slow) index,
+//     binedges2 for its second (fast) index
+{//{{{
+    STARTFCT
+
     interp2d *interp;
     SAFEHMPDF(new_interp2d(N, x, z, 0.0, 0.0, m, NULL, &interp));
     gsl_integration_glfixed_table *t;
@@ -759,16 +786,17 @@ bin_2d(int N, double *x, double *z, int Nsample,
             for (int kk=0; kk<Nsample; kk++)
             {
                 double node_i, weight_i;
-                gsl_integration_glfixed_point(binedges[ii], binedges[ii+1],
+                gsl_integration_glfixed_point(binedges1[ii], binedges1[ii+1],
                                               kk, &node_i, &weight_i, t);
 
                 for (int ll=0; ll<Nsample; ll++)
                 {
                     double node_j, weight_j, temp;
-                    SAFEGSL(gsl_integration_glfixed_point(binedges[jj], binedges[jj+1],
+                    SAFEGSL(gsl_integration_glfixed_point(binedges2[jj], binedges2[jj+1],
                                                           ll, &node_j, &weight_j, t));
 
-                    SAFEHMPDF(interp2d_eval(interp, node_i, node_j, &temp));
+                    // the interpolator's x runs along the fast index
+                    SAFEHMPDF(interp2d_eval(interp, node_j, node_i, &temp));
                     *res += weight_i * weight_j * temp
                             / gsl_pow_2(x[1] - x[0]);
                 }